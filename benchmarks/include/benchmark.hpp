@@ -0,0 +1,55 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+using benchmark_clock = std::chrono::steady_clock;
+using seconds_d = std::chrono::duration<double>;
+
+inline double mib_per_second(size_t bytes, seconds_d elapsed)
+{
+    return elapsed.count() > 0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / elapsed.count() : 0.0;
+}
+
+// sorts the samples; p is in [0, 1]
+inline seconds_d percentile(std::vector<seconds_d> &samples, double p)
+{
+    if (samples.empty())
+    {
+        return seconds_d::zero();
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t index = static_cast<size_t>(p * static_cast<double>(samples.size() - 1) + 0.5);
+    return samples[std::min(index, samples.size() - 1)];
+}
+
+// compressible text shaped like a service log, the same every run
+inline std::vector<char> make_log_payload(size_t size)
+{
+    static const char *levels[] = {"INFO", "DEBUG", "WARN", "INFO", "ERROR"};
+    static const char *messages[] = {"request completed", "cache miss for key", "connection reset by peer",
+                                     "retrying upstream call", "flushed segment to disk"};
+
+    std::vector<char> payload;
+    payload.reserve(size);
+    for (size_t i = 0; payload.size() < size; i++)
+    {
+        std::string line = "2024-05-01T12:" + std::to_string(10 + i / 6000 % 50) + ":" + std::to_string(10 + i / 100 % 50) +
+                           " " + levels[i % 5] + " worker-" + std::to_string(i % 16) + " " + messages[(i * 7) % 5] +
+                           " id=" + std::to_string(i * 2654435761u % 1000003) + "\n";
+        payload.insert(payload.end(), line.begin(), line.end());
+    }
+    payload.resize(size);
+    return payload;
+}
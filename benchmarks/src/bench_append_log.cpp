@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+// Group commit throughput and append latency percentiles for 1 to 64 concurrent appenders, each appending 256 byte
+// records back to back for a fixed time. Usage: bench_append_log [directory], the current one by default.
+
+#include "benchmark.hpp"
+#include <webcraft/async/async.hpp>
+#include <webcraft/async/io/append_log.hpp>
+#include <filesystem>
+
+using namespace webcraft::async;
+using namespace webcraft::async::io;
+using namespace webcraft::async::io::fs;
+
+constexpr size_t record_size = 256;
+constexpr auto run_time = 3s;
+
+struct run_result
+{
+    size_t records{0};
+    std::vector<seconds_d> latencies;
+};
+
+static task<void> append_until(append_log &log, benchmark_clock::time_point deadline, std::vector<seconds_d> &latencies)
+{
+    const std::vector<char> record(record_size, 'r');
+    while (benchmark_clock::now() < deadline)
+    {
+        auto started = benchmark_clock::now();
+        co_await log.append(record);
+        latencies.push_back(benchmark_clock::now() - started);
+    }
+}
+
+static task<run_result> run(const std::filesystem::path &directory, int appenders)
+{
+    auto log = co_await append_log::open(directory);
+
+    std::vector<std::vector<seconds_d>> latencies(appenders);
+    auto deadline = benchmark_clock::now() + run_time;
+
+    // tasks start eagerly, so every appender is running before the first one is awaited
+    std::vector<task<void>> tasks;
+    for (int i = 0; i < appenders; i++)
+    {
+        tasks.emplace_back(append_until(log, deadline, latencies[i]));
+    }
+    co_await when_all(tasks);
+    co_await log.close();
+
+    run_result result;
+    for (auto &samples : latencies)
+    {
+        result.records += samples.size();
+        result.latencies.insert(result.latencies.end(), samples.begin(), samples.end());
+    }
+    co_return result;
+}
+
+int main(int argc, char **argv)
+{
+    runtime_context context;
+
+    const std::filesystem::path directory = std::filesystem::path(argc > 1 ? argv[1] : ".") / "webcraft_bench_append_log";
+
+    std::printf("%-10s %12s %10s %10s %10s\n", "appenders", "records/s", "MiB/s", "p50 us", "p99 us");
+    for (int appenders : {1, 2, 4, 8, 16, 32, 64})
+    {
+        std::filesystem::remove_all(directory);
+        auto started = benchmark_clock::now();
+        run_result result = sync_wait(run(directory, appenders));
+        seconds_d elapsed = benchmark_clock::now() - started;
+
+        std::printf("%-10d %12.0f %10.1f %10.0f %10.0f\n", appenders, static_cast<double>(result.records) / elapsed.count(),
+                    mib_per_second(result.records * record_size, elapsed),
+                    std::chrono::duration<double, std::micro>(percentile(result.latencies, 0.50)).count(),
+                    std::chrono::duration<double, std::micro>(percentile(result.latencies, 0.99)).count());
+    }
+    std::filesystem::remove_all(directory);
+    return 0;
+}
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+// Throughput of the compress and decompress adaptors for each codec and level, on log-like text fed as 64 KiB chunks.
+
+#include "benchmark.hpp"
+#include <webcraft/async/async.hpp>
+#include <webcraft/async/io/adaptors.hpp>
+#include <webcraft/async/io/compression.hpp>
+#include <optional>
+
+using namespace webcraft::async;
+using namespace webcraft::async::io;
+using namespace webcraft::async::io::adaptors;
+using namespace webcraft::async::io::compression;
+
+constexpr size_t payload_size = 64 * 1024 * 1024;
+constexpr size_t chunk_size = 64 * 1024;
+constexpr int repetitions = 3;
+
+class chunk_source
+{
+private:
+    const std::vector<std::vector<char>> &chunks;
+    size_t next{0};
+
+public:
+    explicit chunk_source(const std::vector<std::vector<char>> &chunks) : chunks(chunks) {}
+
+    task<std::optional<std::vector<char>>> recv()
+    {
+        if (next == chunks.size())
+        {
+            co_return std::nullopt;
+        }
+        co_return std::make_optional(chunks[next++]);
+    }
+};
+
+static std::vector<std::vector<char>> split(const std::vector<char> &data, size_t size)
+{
+    std::vector<std::vector<char>> chunks;
+    for (size_t i = 0; i < data.size(); i += size)
+    {
+        chunks.emplace_back(data.begin() + i, data.begin() + std::min(i + size, data.size()));
+    }
+    return chunks;
+}
+
+template <typename Adaptor>
+static task<std::vector<char>> run_pipeline(const std::vector<std::vector<char>> &chunks, Adaptor adaptor)
+{
+    chunk_source source(chunks);
+    auto stream = source | std::move(adaptor);
+
+    std::vector<char> result;
+    while (auto chunk = co_await stream.recv())
+    {
+        result.insert(result.end(), chunk->begin(), chunk->end());
+    }
+    co_return result;
+}
+
+struct codec_levels
+{
+    codec c;
+    const char *name;
+    std::vector<int> levels;
+};
+
+int main()
+{
+    runtime_context context;
+
+    const auto payload = make_log_payload(payload_size);
+    const auto chunks = split(payload, chunk_size);
+
+    const codec_levels cases[] = {
+        {codec::deflate, "deflate", {1, 6, 9}},
+        {codec::gzip, "gzip", {1, 6, 9}},
+        {codec::zstd, "zstd", {1, 3, 9, 19}},
+        {codec::lz4, "lz4", {0, 3, 9}},
+    };
+
+    std::printf("%-8s %6s %8s %16s %16s\n", "codec", "level", "ratio", "compress MiB/s", "decompress MiB/s");
+    for (const auto &entry : cases)
+    {
+        if (!is_supported(entry.c))
+        {
+            std::printf("%-8s not compiled into this build\n", entry.name);
+            continue;
+        }
+
+        for (int level : entry.levels)
+        {
+            compression_options options;
+            options.level = level;
+
+            seconds_d best_compress = seconds_d::max();
+            seconds_d best_decompress = seconds_d::max();
+            size_t compressed_size = 0;
+            for (int i = 0; i < repetitions; i++)
+            {
+                auto started = benchmark_clock::now();
+                auto compressed = sync_wait(run_pipeline(chunks, compress(entry.c, options)));
+                best_compress = std::min<seconds_d>(best_compress, benchmark_clock::now() - started);
+                compressed_size = compressed.size();
+
+                auto compressed_chunks = split(compressed, chunk_size);
+                started = benchmark_clock::now();
+                auto restored = sync_wait(run_pipeline(compressed_chunks, decompress(entry.c)));
+                best_decompress = std::min<seconds_d>(best_decompress, benchmark_clock::now() - started);
+
+                if (restored != payload)
+                {
+                    std::fprintf(stderr, "%s level %d did not round trip\n", entry.name, level);
+                    return 1;
+                }
+            }
+
+            std::printf("%-8s %6d %8.2f %16.1f %16.1f\n", entry.name, level,
+                        static_cast<double>(payload.size()) / static_cast<double>(compressed_size),
+                        mib_per_second(payload.size(), best_compress), mib_per_second(payload.size(), best_decompress));
+        }
+    }
+    return 0;
+}
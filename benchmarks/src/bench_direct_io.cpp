@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+// Sequential write and read of one large file through the direct streams and through the buffered file streams.
+// Usage: bench_direct_io [directory] [size in MiB]. The directory must be on a file system that supports O_DIRECT,
+// which tmpfs does not; it defaults to the current one. Buffered reads start from a dropped page cache on Linux only,
+// elsewhere they may be served from memory.
+
+#include "benchmark.hpp"
+#include <webcraft/async/async.hpp>
+#include <webcraft/async/io/direct_io.hpp>
+#include <webcraft/async/io/fs.hpp>
+#include <cstdlib>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace webcraft::async;
+using namespace webcraft::async::io;
+using namespace webcraft::async::io::fs;
+
+constexpr size_t write_size = 1024 * 1024;
+
+// the page cache would otherwise hand the buffered read back the pages the write just left there
+static void drop_cached_pages(const std::filesystem::path &path)
+{
+#if defined(__linux__)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#endif
+}
+
+template <typename Stream>
+static task<void> write_stream(Stream stream, size_t size)
+{
+    std::vector<char> buffer(write_size, 'd');
+    size_t written = 0;
+    while (written < size)
+    {
+        size_t sent = co_await stream.send(std::span<char>(buffer.data(), std::min(buffer.size(), size - written)));
+        if (sent == 0)
+        {
+            break;
+        }
+        written += sent;
+    }
+    co_await stream.close();
+}
+
+template <typename Stream>
+static task<size_t> read_stream(Stream stream)
+{
+    std::vector<char> buffer(write_size);
+    size_t total = 0;
+    while (true)
+    {
+        size_t received = co_await stream.recv(buffer);
+        if (received == 0)
+        {
+            break;
+        }
+        total += received;
+    }
+    co_await stream.close();
+    co_return total;
+}
+
+static task<void> write_buffered(const std::filesystem::path &path, size_t size)
+{
+    auto stream = co_await make_file(path).open_writable_stream();
+    std::vector<char> buffer(write_size, 'b');
+    size_t written = 0;
+    while (written < size)
+    {
+        size_t sent = co_await stream.send(std::span<char>(buffer.data(), std::min(buffer.size(), size - written)));
+        if (sent == 0)
+        {
+            break;
+        }
+        written += sent;
+    }
+    co_await stream.sync(); // direct writes skip the page cache, so the buffered ones are timed until they are written back
+    co_await stream.close();
+}
+
+int main(int argc, char **argv)
+{
+    runtime_context context;
+
+    const std::filesystem::path path = std::filesystem::path(argc > 1 ? argv[1] : ".") / "webcraft_bench_direct_io.dat";
+    const size_t size = (argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2048) * 1024 * 1024;
+
+    std::printf("%-10s %14s %14s\n", "mode", "write MiB/s", "read MiB/s");
+
+    auto started = benchmark_clock::now();
+    sync_wait(write_stream(sync_wait(open_direct_writable_stream(make_file(path))), size));
+    seconds_d direct_write = benchmark_clock::now() - started;
+
+    started = benchmark_clock::now();
+    size_t direct_read_size = sync_wait(read_stream(sync_wait(open_direct_readable_stream(make_file(path)))));
+    seconds_d direct_read = benchmark_clock::now() - started;
+
+    started = benchmark_clock::now();
+    sync_wait(write_buffered(path, size));
+    seconds_d buffered_write = benchmark_clock::now() - started;
+
+    drop_cached_pages(path);
+    started = benchmark_clock::now();
+    size_t buffered_read_size = sync_wait(read_stream(sync_wait(make_file(path).open_readable_stream())));
+    seconds_d buffered_read = benchmark_clock::now() - started;
+
+    std::filesystem::remove(path);
+
+    if (direct_read_size != size || buffered_read_size != size)
+    {
+        std::fprintf(stderr, "read back %zu (direct) and %zu (buffered) of %zu bytes\n", direct_read_size, buffered_read_size, size);
+        return 1;
+    }
+
+    std::printf("%-10s %14.1f %14.1f\n", "direct", mib_per_second(size, direct_write), mib_per_second(size, direct_read));
+    std::printf("%-10s %14.1f %14.1f\n", "buffered", mib_per_second(size, buffered_write), mib_per_second(size, buffered_read));
+    return 0;
+}
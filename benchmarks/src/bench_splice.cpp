@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+// A loopback relay moving one large stream, through bidirectional_splice and through a user-space copy loop, with the
+// process CPU time each one costs. The CPU time includes the two clients, which do the same work in both modes.
+
+#include "benchmark.hpp"
+#include <webcraft/async/async.hpp>
+#include <webcraft/async/io/socket.hpp>
+#include <webcraft/async/io/transfer.hpp>
+#include <ctime>
+
+using namespace webcraft::async;
+using namespace webcraft::async::io;
+using namespace webcraft::async::io::socket;
+
+constexpr size_t stream_size = 1024ull * 1024 * 1024;
+constexpr size_t buffer_size = 64 * 1024;
+constexpr uint16_t first_port = 12480;
+constexpr int repetitions = 3;
+
+// the relay loop the splice mode replaces
+static task<void> copy_half(tcp_socket &from, tcp_socket &to)
+{
+    std::vector<char> buffer(buffer_size);
+    while (true)
+    {
+        size_t received = co_await from.get_readable_stream().recv(buffer);
+        if (received == 0)
+        {
+            break;
+        }
+        size_t sent = 0;
+        while (sent < received)
+        {
+            size_t written = co_await to.get_writable_stream().send(std::span<const char>(buffer.data() + sent, received - sent));
+            if (written == 0)
+            {
+                co_return;
+            }
+            sent += written;
+        }
+    }
+    to.shutdown_channel(socket_stream_mode::WRITE);
+}
+
+static task<void> relay(tcp_listener &listener, bool splice)
+{
+    tcp_socket a = co_await listener.accept();
+    tcp_socket b = co_await listener.accept();
+    if (splice)
+    {
+        co_await bidirectional_splice(a, b);
+    }
+    else
+    {
+        auto forward = copy_half(a, b);
+        auto backward = copy_half(b, a);
+        co_await forward;
+        co_await backward;
+    }
+    co_await a.close();
+    co_await b.close();
+}
+
+static task<void> produce(tcp_socket &sender)
+{
+    std::vector<char> buffer(buffer_size, 'x');
+    size_t sent = 0;
+    while (sent < stream_size)
+    {
+        size_t written = co_await sender.get_writable_stream().send(std::span<const char>(buffer.data(), std::min(buffer.size(), stream_size - sent)));
+        if (written == 0)
+        {
+            break;
+        }
+        sent += written;
+    }
+    sender.shutdown_channel(socket_stream_mode::WRITE);
+}
+
+static task<size_t> consume(tcp_socket &receiver)
+{
+    std::vector<char> buffer(buffer_size);
+    size_t total = 0;
+    while (true)
+    {
+        size_t received = co_await receiver.get_readable_stream().recv(buffer);
+        if (received == 0)
+        {
+            break;
+        }
+        total += received;
+    }
+    receiver.shutdown_channel(socket_stream_mode::WRITE);
+    co_return total;
+}
+
+static task<size_t> run_clients(const connection_info &address)
+{
+    tcp_socket sender = make_tcp_socket();
+    co_await sender.connect(address);
+    tcp_socket receiver = make_tcp_socket();
+    co_await receiver.connect(address);
+
+    auto producing = produce(sender);
+    auto consuming = consume(receiver);
+    co_await producing;
+    size_t total = co_await consuming;
+
+    co_await sender.close();
+    co_await receiver.close();
+    co_return total;
+}
+
+int main()
+{
+    runtime_context context;
+
+    std::printf("%-8s %10s %16s\n", "mode", "MiB/s", "CPU s per GiB");
+    uint16_t port = first_port;
+    for (bool splice : {true, false})
+    {
+        seconds_d best_wall = seconds_d::max();
+        double best_cpu = 0;
+        for (int i = 0; i < repetitions; i++)
+        {
+            const connection_info address{"127.0.0.1", port++};
+            tcp_listener listener = make_tcp_listener();
+            listener.bind(address);
+            listener.listen(2);
+
+            auto wall_started = benchmark_clock::now();
+            std::clock_t cpu_started = std::clock();
+
+            auto relaying = relay(listener, splice);
+            size_t total = sync_wait(run_clients(address));
+            sync_wait(relaying);
+
+            seconds_d wall = benchmark_clock::now() - wall_started;
+            double cpu = static_cast<double>(std::clock() - cpu_started) / CLOCKS_PER_SEC;
+            sync_wait(listener.close());
+
+            if (total != stream_size)
+            {
+                std::fprintf(stderr, "relay delivered %zu of %zu bytes\n", total, stream_size);
+                return 1;
+            }
+            if (wall < best_wall)
+            {
+                best_wall = wall;
+                best_cpu = cpu;
+            }
+        }
+
+        std::printf("%-8s %10.1f %16.3f\n", splice ? "splice" : "copy", mib_per_second(stream_size, best_wall),
+                    best_cpu / (static_cast<double>(stream_size) / (1024.0 * 1024.0 * 1024.0)));
+    }
+    return 0;
+}
@@ -13,6 +13,14 @@
 #include <string>
 #include <sstream>
 #include <functional>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include <array>
+#include <deque>
+#include <exception>
+#include <utility>
 #include "core.hpp"
 
 namespace webcraft::async::io::adaptors
@@ -67,6 +75,56 @@ namespace webcraft::async::io::adaptors
         return detail::transform_stream_adaptor<InType, Func>(std::move(fn));
     }
 
+    namespace detail
+    {
+        // RStream is a reference for a borrowed lvalue stream, otherwise the stream is moved into the generator frame
+        template <typename T, typename RStream>
+        async_generator<std::vector<T>> read_chunks(RStream stream, size_t chunk_size)
+        {
+            while (true)
+            {
+                std::vector<T> chunk(chunk_size);
+                size_t received = co_await stream.recv(std::span<T>(chunk));
+                if (received == 0)
+                {
+                    break;
+                }
+                chunk.resize(received);
+                co_yield std::move(chunk);
+            }
+        }
+
+        template <typename T>
+        class chunks_stream_adaptor : public async_readable_stream_adaptor<chunks_stream_adaptor<T>, T>
+        {
+        private:
+            size_t chunk_size;
+
+        public:
+            explicit chunks_stream_adaptor(size_t chunk_size) : chunk_size(chunk_size)
+            {
+                if (chunk_size == 0)
+                {
+                    throw std::invalid_argument("chunk size must be greater than zero");
+                }
+            }
+
+            template <typename RStream>
+                requires async_buffered_readable_stream<std::remove_cvref_t<RStream>, T>
+            async_readable_stream<std::vector<T>> auto operator()(RStream &&stream) const
+            {
+                return to_readable_stream<std::vector<T>>(read_chunks<T, RStream>(std::forward<RStream>(stream), chunk_size));
+            }
+        };
+    }
+
+    // reads a buffered stream a whole chunk of up to chunk_size elements per call instead of one element at a time
+    template <typename T = char>
+    auto chunks(size_t chunk_size)
+    {
+        return detail::chunks_stream_adaptor<T>(chunk_size);
+    }
+
     template <typename InType, typename Func, typename OutType = std::invoke_result_t<Func, InType>>
     auto map(Func &&fn)
     {
@@ -89,6 +147,714 @@ namespace webcraft::async::io::adaptors
                                              }); });
     }
 
+    /// @brief What a broadcast does when its shared buffer is full and a consumer asks for a new element.
+    enum class lag_policy
+    {
+        block,       ///< the consumer waits until the slowest consumer frees a slot
+        drop_oldest, ///< the oldest element is discarded for every consumer that has not read it yet
+        disconnect   ///< consumers still holding the oldest element are disconnected and see the end of the stream
+    };
+
+    namespace detail
+    {
+        /// @brief List of suspended coroutines waiting for shared stream state to change.
+        /// Waiters re-check their condition after being resumed. A waiter destroyed while suspended, like the loser of
+        /// a select, takes itself off the list so it is never resumed.
+        class stream_wait_list
+        {
+        private:
+            std::vector<std::coroutine_handle<>> handles;
+            std::deque<std::coroutine_handle<>> resuming; // taken by notify_all() but not resumed yet
+
+        public:
+            auto wait()
+            {
+                struct awaitable
+                {
+                    stream_wait_list &list;
+                    std::coroutine_handle<> waiter{};
+
+                    explicit awaitable(stream_wait_list &list) : list(list) {}
+                    awaitable(const awaitable &) = delete;
+                    awaitable &operator=(const awaitable &) = delete;
+
+                    ~awaitable()
+                    {
+                        if (waiter)
+                        {
+                            std::erase(list.handles, waiter);
+                            std::erase(list.resuming, waiter);
+                        }
+                    }
+
+                    constexpr bool await_ready() const noexcept { return false; }
+
+                    void await_suspend(std::coroutine_handle<> h)
+                    {
+                        list.handles.push_back(h);
+                        waiter = h;
+                    }
+
+                    void await_resume() noexcept
+                    {
+                        waiter = {};
+                    }
+                };
+
+                return awaitable(*this);
+            }
+
+            // one waiter at a time, so a waiter destroyed by an earlier one's resumption is already off the queue
+            void notify_all()
+            {
+                resuming.insert(resuming.end(), handles.begin(), handles.end());
+                handles.clear();
+                while (!resuming.empty())
+                {
+                    auto h = resuming.front();
+                    resuming.pop_front();
+                    h.resume();
+                }
+            }
+        };
+
+        template <typename T>
+        class broadcast_state
+        {
+        private:
+            struct consumer
+            {
+                size_t cursor{0};
+                bool connected{true};
+            };
+
+            async_generator<T> source;
+            std::optional<typename async_generator<T>::iterator> it;
+            std::optional<T> staged; // pulled from the source but not yet given a slot
+            std::vector<std::optional<T>> ring;
+            std::vector<size_t> pending_reads; // live consumers that still have to read each slot
+            std::vector<consumer> consumers;
+            size_t head{0}; // sequence number of the next element pulled from the source
+            size_t tail{0}; // sequence number of the oldest element still buffered
+            lag_policy policy;
+            bool fetching{false};
+            bool finished{false};
+            std::exception_ptr error; // what the source threw, rethrown to every consumer once it has drained the buffer
+            stream_wait_list waiters;
+
+            // clears `fetching` however the fetch ends; one that did not finish, because the source threw or the
+            // fetching recv was destroyed mid-await, leaves nothing the other consumers could carry on from
+            struct fetch_guard
+            {
+                broadcast_state &state;
+                bool fetched{false};
+
+                ~fetch_guard()
+                {
+                    state.fetching = false;
+                    if (!fetched)
+                    {
+                        state.finished = true;
+                        state.waiters.notify_all();
+                    }
+                }
+            };
+
+            void release_slot(size_t seq)
+            {
+                size_t slot = seq % ring.size();
+                if (--pending_reads[slot] == 0)
+                {
+                    ring[slot].reset();
+                }
+            }
+
+            void advance_tail()
+            {
+                size_t oldest = head;
+                for (auto &c : consumers)
+                {
+                    if (c.connected)
+                    {
+                        oldest = std::min(oldest, c.cursor);
+                    }
+                }
+                tail = oldest;
+            }
+
+            T take(size_t id)
+            {
+                auto &c = consumers[id];
+                size_t slot = c.cursor % ring.size();
+                c.cursor++;
+
+                // the last consumer to read a slot gets to move the value out instead of copying it
+                std::optional<T> value;
+                if (--pending_reads[slot] == 0)
+                {
+                    value = std::move(ring[slot]);
+                    ring[slot].reset();
+                }
+                else
+                {
+                    value = ring[slot];
+                }
+
+                size_t previous_tail = tail;
+                advance_tail();
+                if (tail != previous_tail)
+                {
+                    waiters.notify_all();
+                }
+                return std::move(value.value());
+            }
+
+            void evict_oldest()
+            {
+                for (size_t id = 0; id < consumers.size(); id++)
+                {
+                    auto &c = consumers[id];
+                    if (!c.connected || c.cursor != tail)
+                    {
+                        continue;
+                    }
+
+                    if (policy == lag_policy::drop_oldest)
+                    {
+                        release_slot(c.cursor++);
+                    }
+                    else
+                    {
+                        disconnect(id);
+                    }
+                }
+                advance_tail();
+            }
+
+        public:
+            broadcast_state(async_generator<T> &&source, size_t consumer_count, size_t capacity, lag_policy policy)
+                : source(std::move(source)), ring(capacity), pending_reads(capacity, 0), consumers(consumer_count), policy(policy)
+            {
+                if (capacity == 0)
+                {
+                    throw std::invalid_argument("Broadcast capacity must be at least 1");
+                }
+            }
+
+            static task<std::optional<T>> recv(std::shared_ptr<broadcast_state> self, size_t id)
+            {
+                if (!self)
+                {
+                    co_return std::nullopt; // the consumer was closed or moved from
+                }
+
+                while (true)
+                {
+                    auto &c = self->consumers[id];
+                    if (!c.connected)
+                    {
+                        co_return std::nullopt;
+                    }
+
+                    if (c.cursor < self->head)
+                    {
+                        co_return self->take(id);
+                    }
+
+                    if (self->finished)
+                    {
+                        if (self->error)
+                        {
+                            std::rethrow_exception(self->error);
+                        }
+                        co_return std::nullopt;
+                    }
+
+                    if (!self->staged.has_value())
+                    {
+                        // another consumer is already pulling the next element from the source
+                        if (self->fetching)
+                        {
+                            co_await self->waiters.wait();
+                            continue;
+                        }
+
+                        self->fetching = true;
+                        {
+                            fetch_guard guard{*self};
+                            try
+                            {
+                                if (!self->it.has_value())
+                                {
+                                    self->it = co_await self->source.begin();
+                                }
+                                else
+                                {
+                                    co_await ++(*self->it);
+                                }
+                            }
+                            catch (...)
+                            {
+                                self->error = std::current_exception();
+                                throw;
+                            }
+                            guard.fetched = true;
+                        }
+
+                        if (*self->it == self->source.end())
+                        {
+                            self->finished = true;
+                            self->waiters.notify_all();
+                            continue;
+                        }
+                        self->staged = std::move(**self->it);
+                    }
+
+                    // the lag policy only applies once there is an element that needs a slot
+                    if (self->head - self->tail == self->ring.size())
+                    {
+                        if (self->policy == lag_policy::block)
+                        {
+                            co_await self->waiters.wait();
+                        }
+                        else
+                        {
+                            self->evict_oldest();
+                        }
+                        continue;
+                    }
+
+                    size_t slot = self->head % self->ring.size();
+                    self->ring[slot] = std::exchange(self->staged, std::nullopt);
+                    self->pending_reads[slot] = std::ranges::count_if(self->consumers, [](const consumer &c)
+                                                                      { return c.connected; });
+                    self->head++;
+
+                    self->waiters.notify_all();
+                }
+            }
+
+            void disconnect(size_t id)
+            {
+                auto &c = consumers[id];
+                if (!c.connected)
+                {
+                    return;
+                }
+
+                for (size_t seq = c.cursor; seq < head; seq++)
+                {
+                    release_slot(seq);
+                }
+                c.connected = false;
+
+                advance_tail();
+                waiters.notify_all();
+            }
+        };
+    }
+
+    /// @brief One of the readable streams handed out by broadcast() or tee(). Every consumer has its own
+    /// cursor into a buffer shared with its siblings; closing or destroying it stops it from holding the others back.
+    template <typename T>
+    class broadcast_rstream
+    {
+    private:
+        std::shared_ptr<detail::broadcast_state<T>> state;
+        size_t id;
+
+    public:
+        broadcast_rstream(std::shared_ptr<detail::broadcast_state<T>> state, size_t id) : state(std::move(state)), id(id) {}
+        ~broadcast_rstream()
+        {
+            if (state)
+            {
+                state->disconnect(id);
+            }
+        }
+
+        broadcast_rstream(const broadcast_rstream &) = delete;
+        broadcast_rstream &operator=(const broadcast_rstream &) = delete;
+        broadcast_rstream(broadcast_rstream &&other) noexcept : state(std::exchange(other.state, nullptr)), id(other.id) {}
+        broadcast_rstream &operator=(broadcast_rstream &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (state)
+                {
+                    state->disconnect(id);
+                }
+                state = std::exchange(other.state, nullptr);
+                id = other.id;
+            }
+            return *this;
+        }
+
+        task<std::optional<T>> recv()
+        {
+            return detail::broadcast_state<T>::recv(state, id);
+        }
+
+        task<void> close()
+        {
+            if (state)
+            {
+                state->disconnect(id);
+                state.reset();
+            }
+            co_return;
+        }
+    };
+
+    static_assert(async_readable_stream<broadcast_rstream<int>, int>, "broadcast_rstream should be an async readable stream");
+    static_assert(async_closeable_stream<broadcast_rstream<int>, int>, "broadcast_rstream should be a closeable stream");
+
+    namespace detail
+    {
+        template <typename T>
+        class broadcast_stream_adaptor : public async_readable_stream_adaptor<broadcast_stream_adaptor<T>, T>
+        {
+        private:
+            size_t consumers;
+            size_t capacity;
+            lag_policy policy;
+
+        public:
+            broadcast_stream_adaptor(size_t consumers, size_t capacity, lag_policy policy)
+                : consumers(consumers), capacity(capacity), policy(policy) {}
+
+            std::vector<broadcast_rstream<T>> operator()(async_readable_stream<T> auto &&stream) const
+            {
+                auto state = std::make_shared<broadcast_state<T>>(to_async_generator<T>(std::move(stream)), consumers, capacity, policy);
+
+                std::vector<broadcast_rstream<T>> streams;
+                streams.reserve(consumers);
+                for (size_t id = 0; id < consumers; id++)
+                {
+                    streams.emplace_back(state, id);
+                }
+                return streams;
+            }
+        };
+    }
+
+    /// @brief Splits a stream into `consumers` independent readable streams backed by one shared ring buffer
+    /// of `capacity` elements. Elements are pulled from the source once and only copied for consumers that
+    /// are not the last to read them.
+    template <typename T>
+        requires std::copy_constructible<T>
+    auto broadcast(size_t consumers, size_t capacity = 64, lag_policy policy = lag_policy::block)
+    {
+        return detail::broadcast_stream_adaptor<T>(consumers, capacity, policy);
+    }
+
+    /// @brief Shorthand for a broadcast where the fastest consumer waits for the slowest one.
+    template <typename T>
+        requires std::copy_constructible<T>
+    auto tee(size_t consumers, size_t capacity = 64)
+    {
+        return broadcast<T>(consumers, capacity, lag_policy::block);
+    }
+
+    namespace detail
+    {
+        template <typename T, typename>
+        using repeat_type = T;
+
+        /// @brief Shared state behind merge(), select() and zip(). Every source gets a pump that keeps exactly one
+        /// read outstanding and parks the result in a single slot until the consumer takes it, so nothing is polled
+        /// and a ready source never waits behind a slow one. Sources are queued in the order their values arrive.
+        template <typename Values, typename... Streams>
+        class stream_multiplexer;
+
+        template <typename... Ts, typename... Streams>
+        class stream_multiplexer<std::tuple<Ts...>, Streams...>
+        {
+            static_assert(sizeof...(Ts) == sizeof...(Streams), "one value type is required per stream");
+
+        private:
+            static constexpr size_t count = sizeof...(Streams);
+
+            std::tuple<Streams...> sources; // lvalue streams are referenced, rvalue streams are owned
+            std::tuple<std::optional<Ts>...> slots;
+            std::array<stream_wait_list, count> slot_waiters;
+            std::array<bool, count> finished{};
+            std::deque<size_t> ready;
+            std::exception_ptr error;
+            stream_wait_list waiters;
+            std::vector<task<void>> pumps; // declared last so the pumps are torn down before the state they touch
+
+            template <size_t I>
+            static task<void> pump(stream_multiplexer *self)
+            {
+                auto &stream = std::get<I>(self->sources);
+                auto &slot = std::get<I>(self->slots);
+
+                try
+                {
+                    while (true)
+                    {
+                        auto value = co_await stream.recv();
+                        if (!value.has_value())
+                        {
+                            break;
+                        }
+
+                        slot = std::move(value);
+                        self->ready.push_back(I);
+                        self->waiters.notify_all();
+
+                        while (slot.has_value())
+                        {
+                            co_await self->slot_waiters[I].wait();
+                        }
+                    }
+                }
+                catch (...)
+                {
+                    if (!self->error)
+                    {
+                        self->error = std::current_exception();
+                    }
+                }
+
+                self->finished[I] = true;
+                self->waiters.notify_all();
+            }
+
+            void rethrow_if_failed()
+            {
+                if (error)
+                {
+                    std::rethrow_exception(std::exchange(error, nullptr));
+                }
+            }
+
+            std::array<bool, count> filled_slots() const
+            {
+                return std::apply([](const auto &...slot)
+                                  { return std::array<bool, count>{slot.has_value()...}; }, slots);
+            }
+
+            bool all_finished() const
+            {
+                return std::ranges::all_of(finished, [](bool f)
+                                           { return f; });
+            }
+
+        public:
+            explicit stream_multiplexer(Streams &&...streams) : sources(std::forward<Streams>(streams)...) {}
+
+            stream_multiplexer(const stream_multiplexer &) = delete;
+            stream_multiplexer &operator=(const stream_multiplexer &) = delete;
+
+            void start()
+            {
+                [this]<size_t... I>(std::index_sequence<I...>)
+                {
+                    pumps.reserve(count);
+                    (pumps.push_back(pump<I>(this)), ...);
+                }(std::index_sequence_for<Streams...>{});
+            }
+
+            /// @brief Waits for the next source with a value, returning its index, or nullopt once every source has ended.
+            task<std::optional<size_t>> next_ready()
+            {
+                while (ready.empty())
+                {
+                    rethrow_if_failed();
+                    if (all_finished())
+                    {
+                        co_return std::nullopt;
+                    }
+                    co_await waiters.wait();
+                }
+
+                size_t index = ready.front();
+                ready.pop_front();
+                co_return index;
+            }
+
+            /// @brief Waits until every source has a value (true) or until one of them ends without one (false).
+            task<bool> all_ready()
+            {
+                while (true)
+                {
+                    rethrow_if_failed();
+
+                    auto filled = filled_slots();
+                    if (std::ranges::all_of(filled, [](bool f)
+                                            { return f; }))
+                    {
+                        ready.clear();
+                        co_return true;
+                    }
+
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        if (!filled[i] && finished[i])
+                        {
+                            co_return false;
+                        }
+                    }
+                    co_await waiters.wait();
+                }
+            }
+
+            /// @brief Moves the value out of the slot of source I and lets its pump issue the next read.
+            template <size_t I>
+            auto take()
+            {
+                auto value = std::move(*std::get<I>(slots));
+                std::get<I>(slots).reset();
+                slot_waiters[I].notify_all();
+                return value;
+            }
+
+            template <typename T>
+                requires(std::same_as<T, Ts> && ...)
+            T take(size_t index)
+            {
+                std::optional<T> value;
+                [&]<size_t... I>(std::index_sequence<I...>)
+                {
+                    ((I == index ? (void)value.emplace(take<I>()) : void()), ...);
+                }(std::index_sequence_for<Streams...>{});
+                return std::move(*value);
+            }
+        };
+
+        template <typename T, typename... Streams>
+        using same_type_multiplexer = stream_multiplexer<std::tuple<repeat_type<T, Streams>...>, Streams...>;
+
+        template <typename Values, typename... Streams>
+        std::unique_ptr<stream_multiplexer<Values, Streams...>> make_multiplexer(Streams &&...streams)
+        {
+            auto state = std::make_unique<stream_multiplexer<Values, Streams...>>(std::forward<Streams>(streams)...);
+            state->start();
+            return state;
+        }
+    }
+
+    /// @brief Readable stream returned by merge(). Yields values from all sources in the order they become available.
+    template <typename T, typename... Streams>
+    class merge_rstream
+    {
+    private:
+        using state_type = detail::same_type_multiplexer<T, Streams...>;
+        std::unique_ptr<state_type> state;
+
+        static task<std::optional<T>> recv(state_type *state)
+        {
+            auto index = co_await state->next_ready();
+            if (!index.has_value())
+            {
+                co_return std::nullopt;
+            }
+            co_return state->template take<T>(*index);
+        }
+
+    public:
+        explicit merge_rstream(std::unique_ptr<state_type> state) : state(std::move(state)) {}
+
+        task<std::optional<T>> recv()
+        {
+            return recv(state.get());
+        }
+    };
+
+    /// @brief Readable stream returned by select(). Like merge_rstream, but each value is tagged with the index of its source.
+    template <typename T, typename... Streams>
+    class select_rstream
+    {
+    private:
+        using state_type = detail::same_type_multiplexer<T, Streams...>;
+        std::unique_ptr<state_type> state;
+
+        static task<std::optional<std::pair<size_t, T>>> recv(state_type *state)
+        {
+            auto index = co_await state->next_ready();
+            if (!index.has_value())
+            {
+                co_return std::nullopt;
+            }
+            co_return std::pair<size_t, T>{*index, state->template take<T>(*index)};
+        }
+
+    public:
+        explicit select_rstream(std::unique_ptr<state_type> state) : state(std::move(state)) {}
+
+        task<std::optional<std::pair<size_t, T>>> recv()
+        {
+            return recv(state.get());
+        }
+    };
+
+    /// @brief Readable stream returned by zip(). Yields one tuple per round and ends with the shortest source.
+    template <typename Values, typename... Streams>
+    class zip_rstream
+    {
+    private:
+        using state_type = detail::stream_multiplexer<Values, Streams...>;
+        std::unique_ptr<state_type> state;
+
+        static task<std::optional<Values>> recv(state_type *state)
+        {
+            bool complete = co_await state->all_ready();
+            if (!complete)
+            {
+                co_return std::nullopt;
+            }
+
+            co_return take_all(state, std::index_sequence_for<Streams...>{});
+        }
+
+        template <size_t... I>
+        static Values take_all(state_type *state, std::index_sequence<I...>)
+        {
+            return Values{state->template take<I>()...};
+        }
+
+    public:
+        explicit zip_rstream(std::unique_ptr<state_type> state) : state(std::move(state)) {}
+
+        task<std::optional<Values>> recv()
+        {
+            return recv(state.get());
+        }
+    };
+
+    static_assert(async_readable_stream<merge_rstream<int, broadcast_rstream<int>>, int>, "merge_rstream should be an async readable stream");
+
+    /// @brief Combines several streams of the same element type into one that yields values as soon as any source has one.
+    /// Streams passed as lvalues are borrowed and must outlive the result; rvalue streams are moved into it.
+    template <typename T, typename... Streams>
+        requires(sizeof...(Streams) > 0 && (async_readable_stream<std::remove_cvref_t<Streams>, T> && ...))
+    auto merge(Streams &&...streams)
+    {
+        return merge_rstream<T, Streams...>(
+            detail::make_multiplexer<std::tuple<detail::repeat_type<T, Streams>...>>(std::forward<Streams>(streams)...));
+    }
+
+    /// @brief Same as merge(), but yields `std::pair<size_t, T>` so the consumer knows which source produced each value.
+    template <typename T, typename... Streams>
+        requires(sizeof...(Streams) > 0 && (async_readable_stream<std::remove_cvref_t<Streams>, T> && ...))
+    auto select(Streams &&...streams)
+    {
+        return select_rstream<T, Streams...>(
+            detail::make_multiplexer<std::tuple<detail::repeat_type<T, Streams>...>>(std::forward<Streams>(streams)...));
+    }
+
+    /// @brief Reads the sources in lockstep and yields a `std::tuple<Ts...>` per round, e.g. `zip<int, std::string>(a, b)`.
+    /// All sources are read concurrently; the zipped stream ends as soon as any source ends.
+    template <typename... Ts, typename... Streams>
+        requires(sizeof...(Ts) > 0 && sizeof...(Ts) == sizeof...(Streams) && (async_readable_stream<std::remove_cvref_t<Streams>, Ts> && ...))
+    auto zip(Streams &&...streams)
+    {
+        return zip_rstream<std::tuple<Ts...>, Streams...>(
+            detail::make_multiplexer<std::tuple<Ts...>>(std::forward<Streams>(streams)...));
+    }
+
     template <typename Derived, typename ToType, typename StreamType>
     concept collector = std::is_invocable_r_v<task<ToType>, Derived, async_generator<StreamType>>;
 
@@ -132,6 +898,35 @@ namespace webcraft::async::io::adaptors
         return collect<void, T>(std::move(collector_func));
     }
 
+    // resumes partial writes; the count falls short only if the stream stopped accepting data
+    template <typename T>
+    auto forward_chunks_to(async_buffered_writable_stream<T> auto &stream)
+    {
+        auto collector_func = [&stream](async_generator<std::vector<T>> gen) -> task<size_t>
+        {
+            size_t total = 0;
+            auto it = co_await gen.begin();
+            while (it != gen.end())
+            {
+                std::span<T> remaining(*it);
+                while (!remaining.empty())
+                {
+                    size_t sent = co_await stream.send(remaining);
+                    if (sent == 0)
+                    {
+                        co_return total; // the stream stopped accepting data
+                    }
+                    total += sent;
+                    remaining = remaining.subspan(sent);
+                }
+                co_await ++it;
+            }
+            co_return total;
+        };
+
+        return collect<size_t, std::vector<T>>(std::move(collector_func));
+    }
+
     template <typename T, typename Func>
     auto filter(Func &&predicate)
     {
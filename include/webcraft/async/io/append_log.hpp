@@ -0,0 +1,70 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <compare>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+#include "core.hpp"
+#include "fs.hpp"
+
+namespace webcraft::async::io::fs
+{
+    struct append_log_options
+    {
+        // preallocated per segment, rounded up to block_size; no record spans two segments, so it caps the record size
+        uint64_t segment_size = 64 * 1024 * 1024;
+        size_t max_batch_bytes = 1024 * 1024;
+        size_t block_size = 4096; // every write starts and ends on a multiple of this, 1 packs records without padding
+        bool data_sync = true;    // fdatasync rather than fsync after each batch
+        bool direct = false;      // block_size is raised to the file's direct I/O alignment if that is larger
+    };
+
+    // the segment number and the byte offset of the record's header in that segment
+    struct log_position
+    {
+        uint64_t segment;
+        uint64_t offset;
+
+        auto operator<=>(const log_position &) const = default;
+    };
+
+    namespace detail
+    {
+        struct append_log_state;
+    }
+
+    // a write-ahead log of numbered segment files; concurrent appends are gathered into one aligned write and one sync
+    // records are framed as a little-endian 32-bit length, a CRC32C of length and payload, then the payload
+    class append_log
+    {
+    private:
+        std::shared_ptr<detail::append_log_state> state;
+
+        explicit append_log(std::shared_ptr<detail::append_log_state> state) : state(std::move(state)) {}
+
+    public:
+        append_log(append_log &&) noexcept = default;
+        append_log &operator=(append_log &&) noexcept = default;
+        append_log(const append_log &) = delete;
+        append_log &operator=(const append_log &) = delete;
+        ~append_log() = default;
+
+        // appends go to a new segment after the last one in `directory`, so existing segments are never written again
+        static task<append_log> open(std::filesystem::path directory, append_log_options options = {});
+
+        // resolves once `record` and everything before it is durable; `record` must stay valid until then
+        task<log_position> append(std::span<const char> record);
+
+        task<void> close();
+
+        // oldest first; a torn or corrupt record ends its segment, later segments are still read
+        static async_generator<std::vector<char>> replay(std::filesystem::path directory);
+    };
+}
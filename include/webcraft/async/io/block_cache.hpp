@@ -0,0 +1,151 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include "core.hpp"
+#include "fs.hpp"
+
+namespace webcraft::async::io::fs
+{
+    /// @brief Options for block_cache.
+    struct block_cache_options
+    {
+        /// @brief Files are cached in aligned blocks of this many bytes.
+        size_t block_size = 64 * 1024;
+        /// @brief Memory budget across all shards; each shard evicts once it holds more than its share.
+        size_t capacity = 256 * 1024 * 1024;
+        /// @brief Independently locked parts of the cache, 0 for one per hardware thread.
+        size_t shards = 0;
+    };
+
+    /// @brief Counters of a block_cache since it was created.
+    struct block_cache_stats
+    {
+        /// @brief Blocks that were already in memory.
+        uint64_t hits;
+        /// @brief Blocks that had to be read from the file.
+        uint64_t misses;
+        /// @brief Blocks that were being read for another caller and were waited for instead of read again.
+        uint64_t coalesced;
+        uint64_t evictions;
+        /// @brief Bytes currently held.
+        size_t bytes;
+    };
+
+    namespace detail
+    {
+        struct block_cache_state;
+    }
+
+    class cached_file;
+    class cached_rstream;
+
+    /// @brief A read cache of file blocks keyed on (file, block index), shared by every file opened through it. Hot
+    /// regions are then served from memory without a system call. Keys are spread over shards, each with its own lock
+    /// and its own share of the memory budget, and each shard evicts with the CLOCK algorithm: a block that was read
+    /// since the hand last passed it gets a second chance. Concurrent misses on the same block issue a single read and
+    /// everyone else waits for it.
+    ///
+    /// The cache does not notice writes to the files it caches; call invalidate() after changing one. Copies of a
+    /// block_cache share the same cache.
+    class block_cache
+    {
+    private:
+        std::shared_ptr<detail::block_cache_state> state;
+
+    public:
+        explicit block_cache(block_cache_options options = {});
+
+        /// @brief Opens `f` for reading through the cache. Opening the same path again shares its cached blocks.
+        task<cached_file> open(file f);
+
+        /// @brief Opens `f` for sequential reading through the cache from `offset`.
+        task<cached_rstream> open_readable_stream(file f, uint64_t offset = 0);
+
+        /// @brief Forgets the cached contents of `p` for files opened from now on, e.g. after it was rewritten. Its old
+        /// blocks are no longer reachable from new opens and are the first to be evicted.
+        void invalidate(const std::filesystem::path &p);
+
+        block_cache_stats stats() const;
+
+        size_t block_size() const noexcept;
+    };
+
+    /// @brief A file read through a block_cache. read_at() copies out of cached blocks and reads the missing ones,
+    /// all of them at once when a range spans several.
+    class cached_file
+    {
+    private:
+        random_access_file file;
+        std::shared_ptr<detail::block_cache_state> cache;
+        uint64_t id;
+
+        friend class block_cache;
+        cached_file(random_access_file file, std::shared_ptr<detail::block_cache_state> cache, uint64_t id)
+            : file(std::move(file)), cache(std::move(cache)), id(id) {}
+
+    public:
+        cached_file(cached_file &&) noexcept = default;
+        cached_file &operator=(cached_file &&) noexcept = default;
+
+        /// @brief Reads up to `buffer.size()` bytes starting at `offset`; fewer only at the end of the file.
+        task<size_t> read_at(uint64_t offset, std::span<char> buffer);
+
+        task<void> close()
+        {
+            return file.close();
+        }
+    };
+
+    /// @brief A readable stream over a cached_file that keeps its own position.
+    class cached_rstream
+    {
+    private:
+        cached_file file;
+        uint64_t position;
+
+    public:
+        cached_rstream(cached_file file, uint64_t position) : file(std::move(file)), position(position) {}
+        cached_rstream(cached_rstream &&) noexcept = default;
+        cached_rstream &operator=(cached_rstream &&) noexcept = default;
+
+        task<size_t> recv(std::span<char> buffer)
+        {
+            size_t received = co_await file.read_at(position, buffer);
+            position += received;
+            co_return received;
+        }
+
+        task<std::optional<char>> recv()
+        {
+            char value;
+            size_t received = co_await recv(std::span<char>(&value, 1));
+            if (received == 0)
+            {
+                co_return std::nullopt;
+            }
+            co_return value;
+        }
+
+        uint64_t tell() const noexcept { return position; }
+
+        void seek(uint64_t offset) noexcept { position = offset; }
+
+        task<void> close()
+        {
+            return file.close();
+        }
+    };
+
+    static_assert(async_readable_stream<cached_rstream, char>);
+    static_assert(async_buffered_readable_stream<cached_rstream, char>);
+    static_assert(async_closeable_stream<cached_rstream, char>);
+}
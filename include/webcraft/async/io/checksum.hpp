@@ -0,0 +1,137 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <ranges>
+#include <type_traits>
+#include "core.hpp"
+#include "adaptors.hpp"
+
+namespace webcraft::async::io
+{
+    /// @brief Incremental CRC-32C (Castagnoli), as used by iSCSI, ext4 and most storage formats.
+    /// Uses the SSE4.2 or ARMv8 CRC32 instructions when the CPU has them and a table driven fallback otherwise.
+    class crc32c
+    {
+    private:
+        uint32_t state{0xFFFFFFFFu};
+
+    public:
+        using value_type = uint32_t;
+
+        void update(std::span<const std::byte> data) noexcept;
+
+        value_type digest() const noexcept { return ~state; }
+
+        void reset() noexcept { state = 0xFFFFFFFFu; }
+
+        /// @brief Whether this build and CPU use the hardware CRC32C instructions.
+        static bool hardware_accelerated() noexcept;
+    };
+
+    /// @brief Incremental 64 bit xxHash (XXH64). Not a cryptographic hash, but fast enough to keep up with
+    /// memory bandwidth and well suited to detect accidental corruption.
+    class xxh64
+    {
+    private:
+        uint64_t seed;
+        std::array<uint64_t, 4> lanes;
+        std::array<std::byte, 32> buffer;
+        size_t buffered;
+        uint64_t total_length;
+
+    public:
+        using value_type = uint64_t;
+
+        explicit xxh64(uint64_t seed = 0) noexcept : seed(seed) { reset(); }
+
+        void update(std::span<const std::byte> data) noexcept;
+
+        value_type digest() const noexcept;
+
+        void reset() noexcept;
+    };
+
+    /// @brief An incremental checksum or hash usable with the checksum() and hash() adaptors.
+    template <typename A>
+    concept digest_algorithm = std::default_initializable<A> && requires(A &a, const A &ca, std::span<const std::byte> data) {
+        typename A::value_type;
+        { a.update(data) };
+        { ca.digest() } -> std::convertible_to<typename A::value_type>;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        concept byte_like = std::same_as<T, char> || std::same_as<T, unsigned char> || std::same_as<T, signed char> || std::same_as<T, std::byte>;
+
+        /// @brief Elements that can be fed to a digest: single bytes or contiguous chunks of them, such as the
+        /// `std::vector<char>` chunks produced by chunks().
+        template <typename T>
+        concept digestible = byte_like<T> || (std::ranges::contiguous_range<T> && std::ranges::sized_range<T> && byte_like<std::ranges::range_value_t<T>>);
+
+        template <digest_algorithm A, digestible T>
+        void update_digest(A &algorithm, const T &value)
+        {
+            if constexpr (byte_like<T>)
+            {
+                algorithm.update(std::as_bytes(std::span<const T, 1>(&value, 1)));
+            }
+            else
+            {
+                algorithm.update(std::as_bytes(std::span(std::ranges::data(value), std::ranges::size(value))));
+            }
+        }
+    }
+}
+
+namespace webcraft::async::io::adaptors
+{
+    namespace detail
+    {
+        template <typename T, typename A>
+        async_generator<T> digesting_generator(async_generator<T> gen, A *algorithm)
+        {
+            for_each_async(value, gen,
+                           {
+                               io::detail::update_digest(*algorithm, value);
+                               co_yield std::move(value);
+                           });
+        }
+    }
+
+    /// @brief Passes every element through unchanged while feeding it to `algorithm`, so a transfer can be
+    /// verified without reading the data a second time. Once the stream has ended `algorithm.digest()` holds the
+    /// checksum of everything that went through. `algorithm` must outlive the returned stream.
+    template <digest_algorithm A, io::detail::digestible T = std::vector<char>>
+    auto checksum(A &algorithm)
+    {
+        A *target = &algorithm;
+        return transform<T>([target](async_generator<T> gen) -> async_generator<T>
+                            { return detail::digesting_generator<T>(std::move(gen), target); });
+    }
+
+    /// @brief Consumes the stream and resolves to its digest, e.g. `co_await (file | chunks(65536) | hash<xxh64>())`.
+    template <digest_algorithm A, io::detail::digestible T = std::vector<char>>
+    auto hash(A algorithm = A{})
+    {
+        auto collector_func = [algorithm = std::move(algorithm)](async_generator<T> gen) -> task<typename A::value_type>
+        {
+            A state = algorithm;
+            for_each_async(value, gen,
+                           {
+                               io::detail::update_digest(state, value);
+                           });
+            co_return state.digest();
+        };
+
+        return collect<typename A::value_type, T>(std::move(collector_func));
+    }
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <memory>
+#include <mutex>
+#include <map>
+#include <tuple>
+#include <vector>
+#include <span>
+#include <optional>
+#include <stdexcept>
+#include <webcraft/async/runtime.hpp>
+#include <webcraft/async/thread_pool.hpp>
+#include "core.hpp"
+#include "adaptors.hpp"
+
+namespace webcraft::async::io::compression
+{
+    // which ones are available depends on the libraries WebCraft was built with, see is_supported()
+    enum class codec
+    {
+        deflate, // zlib wrapped, as used by Content-Encoding: deflate
+        gzip,    // concatenated members are decompressed as one stream
+        zstd,
+        lz4
+    };
+
+    enum class flush_mode
+    {
+        none,  // the codec may keep input buffered to compress better
+        flush, // everything passed so far can be decoded by the receiver
+        finish
+    };
+
+    // corrupt input or a failing codec
+    class compression_error : public std::runtime_error
+    {
+    public:
+        explicit compression_error(const std::string &message) : std::runtime_error(message) {}
+    };
+
+    // one stream at a time; reset() starts another with the same settings
+    class codec_context
+    {
+    public:
+        virtual ~codec_context() = default;
+
+        // consumes all of input; for a decompressor, finish also checks that the stream was complete
+        virtual void process(std::span<const char> input, std::vector<char> &output, flush_mode mode) = 0;
+        virtual void reset() = 0;
+    };
+
+    bool is_supported(codec c) noexcept;
+
+    // both throw std::invalid_argument for a codec missing from this build; level is on the codec's own scale
+    std::unique_ptr<codec_context> make_compressor(codec c, std::optional<int> level = std::nullopt);
+    std::unique_ptr<codec_context> make_decompressor(codec c);
+
+    class context_pool;
+
+    // handed back to its pool, after a reset, when destroyed
+    class pooled_context
+    {
+    private:
+        friend class context_pool;
+        using key_type = std::tuple<codec, bool, int>;
+
+        std::unique_ptr<codec_context> context;
+        context_pool *pool{nullptr};
+        key_type key;
+
+        pooled_context(std::unique_ptr<codec_context> context, context_pool *pool, key_type key)
+            : context(std::move(context)), pool(pool), key(key) {}
+
+    public:
+        pooled_context(pooled_context &&other) noexcept
+            : context(std::move(other.context)), pool(std::exchange(other.pool, nullptr)), key(other.key) {}
+        pooled_context &operator=(pooled_context &&other) noexcept;
+        pooled_context(const pooled_context &) = delete;
+        pooled_context &operator=(const pooled_context &) = delete;
+        ~pooled_context();
+
+        codec_context &operator*() const { return *context; }
+        codec_context *operator->() const { return context.get(); }
+    };
+
+    // keeps idle contexts so short streams don't allocate compressor state, several hundred KiB for deflate and zstd
+    class context_pool
+    {
+    private:
+        friend class pooled_context;
+
+        std::mutex mutex;
+        std::map<pooled_context::key_type, std::vector<std::unique_ptr<codec_context>>> idle;
+        size_t max_idle_per_kind;
+
+        void release(pooled_context::key_type key, std::unique_ptr<codec_context> context);
+
+    public:
+        explicit context_pool(size_t max_idle_per_kind = 16) : max_idle_per_kind(max_idle_per_kind) {}
+
+        context_pool(const context_pool &) = delete;
+        context_pool &operator=(const context_pool &) = delete;
+
+        pooled_context acquire_compressor(codec c, std::optional<int> level = std::nullopt);
+        pooled_context acquire_decompressor(codec c);
+
+        // what compress() and decompress() use unless given another pool
+        static context_pool &shared();
+    };
+
+    struct compression_options
+    {
+        std::optional<int> level;
+        bool flush_every_chunk{false}; // so the receiver can decode each chunk right away, at some cost in ratio
+        thread_pool *offload_pool{nullptr}; // large chunks are processed here instead of on the runtime thread
+        size_t offload_threshold{256 * 1024};
+        context_pool *contexts{nullptr}; // the shared pool if null
+    };
+
+    namespace detail
+    {
+        inline task<void> run_codec(codec_context &context, std::span<const char> input, std::vector<char> &output, flush_mode mode, const compression_options &options)
+        {
+            if (options.offload_pool && input.size() >= options.offload_threshold)
+            {
+                co_await options.offload_pool->async_submit([&]
+                                                            { context.process(input, output, mode); });
+                co_await yield(); // continue on the runtime thread
+            }
+            else
+            {
+                context.process(input, output, mode);
+            }
+        }
+
+        // the context and options are coroutine parameters so the generator owns them after the adaptor is gone
+        inline async_generator<std::vector<char>> process_chunks(async_generator<std::vector<char>> gen, pooled_context context, compression_options options)
+        {
+            const flush_mode chunk_mode = options.flush_every_chunk ? flush_mode::flush : flush_mode::none;
+
+            auto it = co_await gen.begin();
+            while (it != gen.end())
+            {
+                std::vector<char> output;
+                co_await run_codec(*context, *it, output, chunk_mode, options);
+                if (!output.empty())
+                {
+                    co_yield std::move(output);
+                }
+                co_await ++it;
+            }
+
+            std::vector<char> output;
+            co_await run_codec(*context, {}, output, flush_mode::finish, options);
+            if (!output.empty())
+            {
+                co_yield std::move(output);
+            }
+        }
+
+        inline context_pool &pool_for(const compression_options &options)
+        {
+            return options.contexts ? *options.contexts : context_pool::shared();
+        }
+    }
+}
+
+namespace webcraft::async::io::adaptors
+{
+    inline auto compress(compression::codec codec, compression::compression_options options = {})
+    {
+        return transform<std::vector<char>>([codec, options](async_generator<std::vector<char>> gen) -> async_generator<std::vector<char>>
+                                            { return compression::detail::process_chunks(std::move(gen), compression::detail::pool_for(options).acquire_compressor(codec, options.level), options); });
+    }
+
+    // fails with compression_error on corrupt or truncated input
+    inline auto decompress(compression::codec codec, compression::compression_options options = {})
+    {
+        return transform<std::vector<char>>([codec, options](async_generator<std::vector<char>> gen) -> async_generator<std::vector<char>>
+                                            { return compression::detail::process_chunks(std::move(gen), compression::detail::pool_for(options).acquire_decompressor(codec), options); });
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include "core.hpp"
+#include "socket.hpp"
+
+namespace webcraft::async::io::socket
+{
+    /// @brief Options for connection_pool.
+    struct connection_pool_options
+    {
+        /// @brief Idle connections kept per endpoint; a connection released beyond this many is closed.
+        size_t max_idle_per_endpoint = 8;
+        /// @brief Connections per endpoint, counting idle ones, ones in use and ones being connected. acquire() waits
+        /// for one to be released once it is reached; zero for no limit.
+        size_t max_per_endpoint = 64;
+        /// @brief An idle connection is closed after this long unused, zero to keep it until the peer closes it.
+        std::chrono::steady_clock::duration idle_timeout = std::chrono::seconds(60);
+        /// @brief Options for the connections the pool opens.
+        socket_options socket;
+    };
+
+    /// @brief Counters of a connection_pool since it was created.
+    struct connection_pool_stats
+    {
+        /// @brief acquire() calls served by an idle connection.
+        uint64_t hits;
+        /// @brief acquire() calls that opened a new connection.
+        uint64_t misses;
+        /// @brief Idle connections dropped on checkout because the peer had closed them or sent unrequested data.
+        uint64_t stale;
+        /// @brief Idle connections closed because they timed out or more than max_idle_per_endpoint were released.
+        uint64_t evictions;
+        /// @brief acquire() calls that had to wait for an endpoint at max_per_endpoint.
+        uint64_t waits;
+        size_t idle;
+        size_t open;
+    };
+
+    namespace detail
+    {
+        struct connection_pool_state;
+    }
+
+    /// @brief A connection checked out of a connection_pool. It belongs to the holder until release() hands it back for
+    /// reuse; dropping it without release() closes it, since a connection in an unknown state must not be reused.
+    class pooled_connection
+    {
+    private:
+        std::shared_ptr<detail::connection_pool_state> state;
+        std::string key;
+        std::optional<tcp_socket> connection;
+        bool was_reused{false};
+
+    public:
+        pooled_connection(std::shared_ptr<detail::connection_pool_state> state, std::string key, tcp_socket connection, bool reused)
+            : state(std::move(state)), key(std::move(key)), connection(std::move(connection)), was_reused(reused) {}
+        pooled_connection(pooled_connection &&other) noexcept
+            : state(std::move(other.state)), key(std::move(other.key)), connection(std::exchange(other.connection, std::nullopt)), was_reused(other.was_reused) {}
+        pooled_connection &operator=(pooled_connection &&other) noexcept
+        {
+            if (this != &other)
+            {
+                discard();
+                state = std::move(other.state);
+                key = std::move(other.key);
+                connection = std::exchange(other.connection, std::nullopt);
+                was_reused = other.was_reused;
+            }
+            return *this;
+        }
+        ~pooled_connection() { discard(); }
+
+        tcp_socket &socket() { return *connection; }
+        tcp_socket *operator->() { return &*connection; }
+
+        /// @brief True if the connection had been used before. A request on a reused connection can still fail because
+        /// the peer closed it after the checkout, so it is the one worth retrying on a fresh connection.
+        bool reused() const noexcept { return was_reused; }
+
+        /// @brief Hands the connection back for reuse. Only call it once the last exchange is complete, with nothing
+        /// left unread.
+        void release();
+
+        /// @brief Closes the connection instead of returning it, freeing its place for a new one.
+        void discard();
+    };
+
+    /// @brief Keeps connections to remote endpoints open for reuse, so that a call to a recently used endpoint skips
+    /// getaddrinfo, socket() and the handshake. Endpoints are keyed by host and port as given.
+    ///
+    /// On checkout an idle connection is checked without blocking for a close or unread data from the peer, and dropped
+    /// if it has any; the most recently released connection is tried first. Idle connections are closed once they have
+    /// been unused for idle_timeout. Copies of a connection_pool share the same pool.
+    class connection_pool
+    {
+    private:
+        std::shared_ptr<detail::connection_pool_state> state;
+
+    public:
+        explicit connection_pool(connection_pool_options options = {});
+
+        /// @brief A connection to `endpoint`: an idle one if a healthy one is left, otherwise a new one. Waits while the
+        /// endpoint has max_per_endpoint connections, until one of them is released or closed.
+        /// @throws std::system_error if a new connection cannot be made
+        task<pooled_connection> acquire(connection_info endpoint);
+
+        /// @brief Closes every idle connection. Connections in use are not affected.
+        void clear();
+
+        connection_pool_stats stats() const;
+    };
+}
@@ -0,0 +1,425 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+#include "core.hpp"
+#include "fs.hpp"
+
+namespace webcraft::async::io::fs
+{
+    namespace detail
+    {
+        struct aligned_deleter
+        {
+            size_t alignment;
+
+            void operator()(char *p) const noexcept
+            {
+                ::operator delete[](p, std::align_val_t(alignment));
+            }
+        };
+
+        using aligned_storage = std::unique_ptr<char[], aligned_deleter>;
+
+        inline aligned_storage allocate_aligned(size_t size, size_t alignment)
+        {
+            return aligned_storage(static_cast<char *>(::operator new[](size, std::align_val_t(alignment))), aligned_deleter{alignment});
+        }
+
+        struct aligned_pool_state
+        {
+            std::mutex mutex;
+            std::vector<aligned_storage> idle;
+            size_t max_idle;
+
+            explicit aligned_pool_state(size_t max_idle) : max_idle(max_idle) {}
+        };
+    }
+
+    // goes back to its aligned_buffer_pool when destroyed
+    class aligned_buffer
+    {
+    private:
+        detail::aligned_storage storage;
+        size_t length{0};
+        std::shared_ptr<detail::aligned_pool_state> pool;
+
+        void release() noexcept
+        {
+            if (storage && pool)
+            {
+                std::lock_guard lock(pool->mutex);
+                if (pool->idle.size() < pool->max_idle)
+                {
+                    pool->idle.push_back(std::move(storage));
+                }
+            }
+            storage.reset();
+            pool.reset();
+            length = 0;
+        }
+
+    public:
+        aligned_buffer() = default;
+        aligned_buffer(size_t size, size_t alignment) : storage(detail::allocate_aligned(size, alignment)), length(size) {}
+        aligned_buffer(detail::aligned_storage storage, size_t size, std::shared_ptr<detail::aligned_pool_state> pool)
+            : storage(std::move(storage)), length(size), pool(std::move(pool)) {}
+
+        aligned_buffer(aligned_buffer &&other) noexcept
+            : storage(std::move(other.storage)), length(std::exchange(other.length, 0)), pool(std::move(other.pool)) {}
+        aligned_buffer &operator=(aligned_buffer &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                storage = std::move(other.storage);
+                length = std::exchange(other.length, 0);
+                pool = std::move(other.pool);
+            }
+            return *this;
+        }
+        aligned_buffer(const aligned_buffer &) = delete;
+        aligned_buffer &operator=(const aligned_buffer &) = delete;
+
+        ~aligned_buffer() noexcept
+        {
+            release();
+        }
+
+        char *data() const noexcept { return storage.get(); }
+        size_t size() const noexcept { return length; }
+        std::span<char> span() const noexcept { return {storage.get(), length}; }
+    };
+
+    // keeps released buffers so a scan does not pay for a large aligned allocation per stream; copies share one pool
+    class aligned_buffer_pool
+    {
+    private:
+        std::shared_ptr<detail::aligned_pool_state> state;
+        direct_io_alignment buffer_alignment;
+        size_t size;
+
+    public:
+        static constexpr size_t default_buffer_size = 1024 * 1024;
+
+        // alignment is usually random_access_file::alignment(); buffer_size is rounded up to a multiple of its offset
+        explicit aligned_buffer_pool(direct_io_alignment alignment, size_t buffer_size = default_buffer_size, size_t max_idle = 16)
+            : state(std::make_shared<detail::aligned_pool_state>(max_idle))
+        {
+            if (!std::has_single_bit(alignment.memory) || !std::has_single_bit(alignment.offset))
+            {
+                throw std::invalid_argument("Direct I/O alignments must be powers of two");
+            }
+
+            buffer_alignment.memory = std::max(alignment.memory, alignof(std::max_align_t));
+            buffer_alignment.offset = alignment.offset;
+            size = std::max(buffer_size, alignment.offset);
+            size += (alignment.offset - size % alignment.offset) % alignment.offset;
+        }
+
+        aligned_buffer acquire() const
+        {
+            {
+                std::lock_guard lock(state->mutex);
+                if (!state->idle.empty())
+                {
+                    auto storage = std::move(state->idle.back());
+                    state->idle.pop_back();
+                    return aligned_buffer(std::move(storage), size, state);
+                }
+            }
+            return aligned_buffer(detail::allocate_aligned(size, buffer_alignment.memory), size, state);
+        }
+
+        direct_io_alignment alignment() const noexcept { return buffer_alignment; }
+        size_t buffer_size() const noexcept { return size; }
+
+        bool compatible_with(direct_io_alignment required) const noexcept
+        {
+            return buffer_alignment.memory % required.memory == 0 && buffer_alignment.offset % required.offset == 0;
+        }
+    };
+
+    // reads whole aligned blocks into a pooled buffer, so neither the start offset nor the caller's buffers need to be
+    // aligned
+    class direct_rstream
+    {
+    private:
+        random_access_file file;
+        aligned_buffer buffer;
+        uint64_t next_offset; // aligned offset of the next block to read
+        size_t head_skip;     // bytes before the requested start in the first block
+        size_t begin{0};
+        size_t end{0};
+        bool eof{false};
+
+        task<void> fill()
+        {
+            size_t received = co_await file.read_at(next_offset, buffer.span());
+            // a direct read only comes back short at the end of the file, past which offsets are no longer aligned
+            eof = received < buffer.size();
+            next_offset += received;
+            begin = std::min(head_skip, received);
+            end = received;
+            head_skip = 0;
+        }
+
+    public:
+        direct_rstream(random_access_file file, aligned_buffer buffer, direct_io_alignment alignment, uint64_t offset)
+            : file(std::move(file)), buffer(std::move(buffer)), next_offset(offset - offset % alignment.offset), head_skip(offset % alignment.offset) {}
+
+        direct_rstream(direct_rstream &&) noexcept = default;
+        direct_rstream &operator=(direct_rstream &&) noexcept = default;
+        direct_rstream(const direct_rstream &) = delete;
+        direct_rstream &operator=(const direct_rstream &) = delete;
+
+        task<size_t> recv(std::span<char> out)
+        {
+            if (out.empty())
+            {
+                co_return 0;
+            }
+
+            while (begin == end)
+            {
+                if (eof)
+                {
+                    co_return 0;
+                }
+                co_await fill();
+            }
+
+            size_t count = std::min(out.size(), end - begin);
+            std::memcpy(out.data(), buffer.data() + begin, count);
+            begin += count;
+            co_return count;
+        }
+
+        task<std::optional<char>> recv()
+        {
+            std::array<char, 1> buf;
+            if (co_await recv(buf))
+            {
+                co_return buf[0];
+            }
+            co_return std::nullopt;
+        }
+
+        task<void> close()
+        {
+            return file.close();
+        }
+    };
+
+    static_assert(async_readable_stream<direct_rstream, char>);
+    static_assert(async_buffered_readable_stream<direct_rstream, char>);
+    static_assert(async_closeable_stream<direct_rstream, char>);
+
+    // Writes a full pooled buffer at a time. An unaligned start rewrites the partial last block, and an unaligned end
+    // is padded to a whole block on close() and truncated afterwards. Destroying the stream without close() drops
+    // whatever is still buffered.
+    class direct_wstream
+    {
+    private:
+        random_access_file file;
+        aligned_buffer buffer;
+        direct_io_alignment alignment;
+        uint64_t block_offset; // file offset of buffer[0], always aligned
+        size_t filled;
+        bool closed{false};
+
+        task<void> write_buffer(size_t length)
+        {
+            size_t written = 0;
+            while (written < length)
+            {
+                size_t count = co_await file.write_at(block_offset + written, std::span<const char>(buffer.data() + written, length - written));
+                if (count == 0)
+                {
+                    throw std::system_error(std::make_error_code(std::errc::io_error), "Direct write made no progress");
+                }
+                written += count;
+            }
+        }
+
+    public:
+        direct_wstream(random_access_file file, aligned_buffer buffer, direct_io_alignment alignment, uint64_t block_offset, size_t filled)
+            : file(std::move(file)), buffer(std::move(buffer)), alignment(alignment), block_offset(block_offset), filled(filled) {}
+
+        direct_wstream(direct_wstream &&other) noexcept
+            : file(std::move(other.file)), buffer(std::move(other.buffer)), alignment(other.alignment), block_offset(other.block_offset),
+              filled(std::exchange(other.filled, 0)), closed(std::exchange(other.closed, true)) {}
+        direct_wstream &operator=(direct_wstream &&other) noexcept
+        {
+            if (this != &other)
+            {
+                file = std::move(other.file);
+                buffer = std::move(other.buffer);
+                alignment = other.alignment;
+                block_offset = other.block_offset;
+                filled = std::exchange(other.filled, 0);
+                closed = std::exchange(other.closed, true);
+            }
+            return *this;
+        }
+        direct_wstream(const direct_wstream &) = delete;
+        direct_wstream &operator=(const direct_wstream &) = delete;
+
+        task<size_t> send(std::span<char> data)
+        {
+            size_t consumed = 0;
+            while (consumed < data.size())
+            {
+                size_t count = std::min(data.size() - consumed, buffer.size() - filled);
+                std::memcpy(buffer.data() + filled, data.data() + consumed, count);
+                filled += count;
+                consumed += count;
+
+                if (filled == buffer.size())
+                {
+                    co_await write_buffer(filled);
+                    block_offset += filled;
+                    filled = 0;
+                }
+            }
+            co_return consumed;
+        }
+
+        task<bool> send(char b)
+        {
+            std::array<char, 1> buf;
+            buf[0] = b;
+            if (co_await send(buf))
+            {
+                co_return true;
+            }
+            co_return false;
+        }
+
+        // a trailing partial block stays buffered until more data completes it or the stream is closed
+        task<void> flush()
+        {
+            size_t whole = filled - filled % alignment.offset;
+            if (whole == 0)
+            {
+                co_return;
+            }
+
+            co_await write_buffer(whole);
+            std::memmove(buffer.data(), buffer.data() + whole, filled - whole);
+            block_offset += whole;
+            filled -= whole;
+        }
+
+        task<void> close()
+        {
+            if (closed)
+            {
+                co_return;
+            }
+            closed = true;
+
+            if (filled > 0)
+            {
+                size_t padded = filled + (alignment.offset - filled % alignment.offset) % alignment.offset;
+                std::memset(buffer.data() + filled, 0, padded - filled);
+                co_await write_buffer(padded);
+                if (padded != filled)
+                {
+                    co_await file.truncate(block_offset + filled);
+                }
+            }
+            co_await file.close();
+        }
+    };
+
+    static_assert(async_writable_stream<direct_wstream, char>);
+    static_assert(async_buffered_writable_stream<direct_wstream, char>);
+    static_assert(async_closeable_stream<direct_wstream, char>);
+
+    namespace detail
+    {
+        inline void require_compatible(const aligned_buffer_pool &pool, direct_io_alignment required)
+        {
+            if (!pool.compatible_with(required))
+            {
+                throw std::invalid_argument("The buffer pool's alignment is too small for direct I/O on this file");
+            }
+        }
+
+        inline direct_rstream make_direct_rstream(random_access_file file, const aligned_buffer_pool &pool, uint64_t offset)
+        {
+            require_compatible(pool, file.alignment());
+            return direct_rstream(std::move(file), pool.acquire(), pool.alignment(), offset);
+        }
+
+        inline task<direct_wstream> make_direct_wstream(random_access_file file, aligned_buffer_pool pool, std::filesystem::path path, bool append)
+        {
+            require_compatible(pool, file.alignment());
+            auto buffer = pool.acquire();
+            direct_io_alignment alignment = pool.alignment();
+
+            uint64_t start = 0;
+            if (append)
+            {
+                file_status status = co_await stat_descriptor(file.get_descriptor(), path);
+                start = status.size;
+            }
+            else
+            {
+                co_await file.truncate(0);
+            }
+
+            uint64_t block = start - start % alignment.offset;
+            size_t head = static_cast<size_t>(start - block);
+            if (head > 0)
+            {
+                // the partial last block is read back so that the first write can rewrite it whole
+                co_await file.read_at(block, buffer.span().first(alignment.offset));
+            }
+            co_return direct_wstream(std::move(file), std::move(buffer), alignment, block, head);
+        }
+    }
+
+    // the overloads taking a pool throw std::invalid_argument if its alignment does not satisfy the file's
+    inline task<direct_rstream> open_direct_readable_stream(file f, aligned_buffer_pool pool, uint64_t offset = 0)
+    {
+        auto opened = co_await f.open_random_access(false, open_options{.direct = true});
+        co_return detail::make_direct_rstream(std::move(opened), pool, offset);
+    }
+
+    inline task<direct_rstream> open_direct_readable_stream(file f, uint64_t offset = 0)
+    {
+        auto opened = co_await f.open_random_access(false, open_options{.direct = true});
+        aligned_buffer_pool pool(opened.alignment());
+        co_return detail::make_direct_rstream(std::move(opened), pool, offset);
+    }
+
+    inline task<direct_wstream> open_direct_writable_stream(file f, aligned_buffer_pool pool, bool append = false)
+    {
+        auto opened = co_await f.open_random_access(true, open_options{.direct = true});
+        auto stream = co_await detail::make_direct_wstream(std::move(opened), std::move(pool), f.get_path(), append);
+        co_return stream;
+    }
+
+    inline task<direct_wstream> open_direct_writable_stream(file f, bool append = false)
+    {
+        auto opened = co_await f.open_random_access(true, open_options{.direct = true});
+        aligned_buffer_pool pool(opened.alignment());
+        auto stream = co_await detail::make_direct_wstream(std::move(opened), std::move(pool), f.get_path(), append);
+        co_return stream;
+    }
+}
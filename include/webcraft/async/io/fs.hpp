@@ -8,11 +8,43 @@
 #include "core.hpp"
 #include <fstream>
 #include <filesystem>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <vector>
 #include <webcraft/async/fire_and_forget_task.hpp>
+#include <webcraft/async/io_priority.hpp>
 
 namespace webcraft::async::io::fs
 {
+    struct open_options
+    {
+        // bypasses the page cache; a file system that cannot do direct I/O opens the file buffered, with alignment 1
+        bool direct = false;
+    };
+
+    // a direct transfer's buffer must start at a multiple of `memory`, its file offset and length be multiples of `offset`
+    struct direct_io_alignment
+    {
+        size_t memory = 1;
+        size_t offset = 1;
+    };
+
+    /// @brief How a file is going to be read, passed to the kernel as an madvise() or posix_fadvise() hint.
+    enum class access_pattern
+    {
+        normal,
+        sequential, // aggressive read-ahead, pages behind the cursor may be dropped early
+        random      // no read-ahead
+    };
+
     namespace detail
     {
 
@@ -20,18 +52,65 @@ namespace webcraft::async::io::fs
         {
         protected:
             std::ios_base::openmode mode;
+            io_priority priority;
 
         public:
             file_descriptor(std::ios_base::openmode mode) : mode(mode) {}
             virtual ~file_descriptor() = default;
 
+            // the priority of the reads, writes and syncs issued from now on; implementations without one ignore it
+            void set_priority(io_priority priority) noexcept { this->priority = priority; }
+            io_priority get_priority() const noexcept { return priority; }
+
             // virtual because we want to allow platform specific implementation
             virtual task<size_t> read(std::span<char> buffer) = 0;  // internally should check if openmode is for read
             virtual task<size_t> write(std::span<char> buffer) = 0; // internally should check if openmode is for write or append
             virtual task<void> close() = 0;                         // will spawn a fire and forget task (essentially use async apis but provide null callback)
+
+            // positional variants: they neither use nor move the file position, so any number may be in flight at once
+            virtual task<size_t> read_at(uint64_t offset, std::span<char> buffer) = 0;
+            virtual task<size_t> write_at(uint64_t offset, std::span<const char> buffer) = 0;
+
+            // cuts or extends the file to exactly `size` bytes
+            virtual task<void> truncate(uint64_t size) = 0;
+
+            // what direct I/O demands of buffers and offsets, {1, 1} if the descriptor goes through the page cache
+            virtual direct_io_alignment alignment() const noexcept { return {}; }
+
+            // page cache hints that platforms without them ignore: the access pattern of a range (length 0 runs to the
+            // end of the file) and a background read of a range into the cache
+            virtual task<void> advise(uint64_t offset, uint64_t length, access_pattern pattern) { co_return; }
+            virtual task<void> prefetch(uint64_t offset, uint64_t length) { co_return; }
+
+            // durability and space management: fsync (fdatasync if data_only), write-back of a range (length 0 runs to
+            // the end of the file) and reserving the blocks of a range, extending the file if needed
+            virtual task<void> sync(bool data_only) = 0;
+            virtual task<void> sync_range(uint64_t offset, uint64_t length) = 0;
+            virtual task<void> allocate(uint64_t offset, uint64_t length) = 0;
+
+            // a write (at the file position for nullopt) followed by sync(data_only), overridden where the platform can
+            // hand both to the kernel at once
+            virtual task<size_t> write_and_sync(std::optional<uint64_t> offset, std::span<const char> buffer, bool data_only)
+            {
+                size_t written;
+                if (offset)
+                {
+                    written = co_await write_at(*offset, buffer);
+                }
+                else
+                {
+                    // write() only reads from the buffer
+                    written = co_await write(std::span<char>(const_cast<char *>(buffer.data()), buffer.size()));
+                }
+                co_await sync(data_only);
+                co_return written;
+            }
+
+            // OS file descriptor used by the zero-copy transfer paths, -1 if there is none (mocks, non-posix platforms)
+            virtual int native_handle() const noexcept { return -1; }
         };
 
-        task<std::shared_ptr<file_descriptor>> make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode);
+        task<std::shared_ptr<file_descriptor>> make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode, open_options options = {});
 
         class file_stream
         {
@@ -65,6 +144,23 @@ namespace webcraft::async::io::fs
                     co_await fd->close();
                 }
             }
+
+            const std::shared_ptr<file_descriptor> &get_descriptor() const noexcept
+            {
+                return fd;
+            }
+
+            /// @brief Sets the I/O priority of the operations this stream issues from now on, e.g. io_priority::idle()
+            /// for a background compaction pass so that it does not slow down reads serving requests.
+            void set_priority(io_priority priority) noexcept
+            {
+                fd->set_priority(priority);
+            }
+
+            io_priority get_priority() const noexcept
+            {
+                return fd->get_priority();
+            }
         };
     }
 
@@ -125,12 +221,317 @@ namespace webcraft::async::io::fs
             }
             co_return false;
         }
+
+        /// @brief Flushes the written data and the file's metadata to stable storage (fsync).
+        task<void> sync()
+        {
+            return fd->sync(false);
+        }
+
+        /// @brief Like sync() but skips metadata that is not needed to read the data back, such as timestamps (fdatasync).
+        task<void> data_sync()
+        {
+            return fd->sync(true);
+        }
+
+        /// @brief Writes back a range and waits for it, without flushing metadata or the device cache
+        /// (sync_file_range on Linux, a data sync elsewhere). A length of 0 runs to the end of the file.
+        task<void> sync_range(uint64_t offset, uint64_t length)
+        {
+            return fd->sync_range(offset, length);
+        }
+
+        /// @brief Reserves the blocks of a range so later writes into it cannot fail for lack of space, extending the
+        /// file if the range ends past it (fallocate).
+        task<void> allocate(uint64_t offset, uint64_t length)
+        {
+            return fd->allocate(offset, length);
+        }
+
+        /// @brief send() followed by sync(), or data_sync() if `data_only`. On Linux both are linked and go out in one
+        /// submission, saving a round trip through the ring.
+        /// @return the number of bytes written
+        task<size_t> send_and_sync(std::span<const char> buffer, bool data_only = false)
+        {
+            return fd->write_and_sync(std::nullopt, buffer, data_only);
+        }
     };
 
     static_assert(async_writable_stream<file_wstream, char>);
     static_assert(async_buffered_writable_stream<file_wstream, char>);
     static_assert(async_closeable_stream<file_wstream, char>);
 
+    /// @brief One range of a random_access_file::read_at_many() batch.
+    struct read_range
+    {
+        uint64_t offset;
+        std::span<char> buffer;
+    };
+
+    /// @brief A file accessed by offset instead of through a cursor. Every read_at()/write_at() names its own offset,
+    /// so any number of them can be in flight on one descriptor at the same time, e.g. scattered index lookups.
+    class random_access_file
+    {
+    private:
+        std::shared_ptr<detail::file_descriptor> fd;
+        std::atomic<bool> closed{false};
+
+    public:
+        explicit random_access_file(std::shared_ptr<detail::file_descriptor> fd) : fd(std::move(fd)) {}
+        random_access_file(random_access_file &&other) noexcept : fd(std::exchange(other.fd, nullptr)), closed(other.closed.exchange(true)) {}
+        random_access_file &operator=(random_access_file &&other) noexcept
+        {
+            if (this != &other)
+            {
+                fd = std::exchange(other.fd, nullptr);
+                closed = other.closed.exchange(true);
+            }
+            return *this;
+        }
+        random_access_file(const random_access_file &) = delete;
+        random_access_file &operator=(const random_access_file &) = delete;
+
+        ~random_access_file() noexcept
+        {
+            if (fd)
+                fire_and_forget(close());
+        }
+
+        /// @brief Reads up to `buffer.size()` bytes starting at `offset`; fewer only at the end of the file.
+        task<size_t> read_at(uint64_t offset, std::span<char> buffer)
+        {
+            return fd->read_at(offset, buffer);
+        }
+
+        task<size_t> write_at(uint64_t offset, std::span<const char> buffer)
+        {
+            return fd->write_at(offset, buffer);
+        }
+
+        task<void> truncate(uint64_t size)
+        {
+            return fd->truncate(size);
+        }
+
+        task<void> sync()
+        {
+            return fd->sync(false);
+        }
+
+        task<void> data_sync()
+        {
+            return fd->sync(true);
+        }
+
+        task<void> allocate(uint64_t offset, uint64_t length)
+        {
+            return fd->allocate(offset, length);
+        }
+
+        /// @brief write_at() followed by sync(), or data_sync() if `data_only`, linked into one submission on Linux.
+        task<size_t> write_at_and_sync(uint64_t offset, std::span<const char> buffer, bool data_only = false)
+        {
+            return fd->write_and_sync(offset, buffer, data_only);
+        }
+
+        direct_io_alignment alignment() const noexcept
+        {
+            return fd->alignment();
+        }
+
+        /// @brief Sets the I/O priority of the operations issued from now on, see file_stream::set_priority().
+        void set_priority(io_priority priority) noexcept
+        {
+            fd->set_priority(priority);
+        }
+
+        io_priority get_priority() const noexcept
+        {
+            return fd->get_priority();
+        }
+
+        /// @brief Issues all reads before waiting for any of them, so the runtime hands them to the kernel together.
+        /// @return the number of bytes read into each range, in the order of `ranges`
+        task<std::vector<size_t>> read_at_many(std::span<const read_range> ranges)
+        {
+            std::vector<task<size_t>> reads;
+            reads.reserve(ranges.size());
+            for (const auto &range : ranges)
+            {
+                reads.push_back(fd->read_at(range.offset, range.buffer));
+            }
+
+            // every read is awaited even after one fails, so none is still in flight when `reads` goes away
+            std::vector<size_t> results;
+            results.reserve(reads.size());
+            std::exception_ptr error;
+            for (auto &read : reads)
+            {
+                try
+                {
+                    size_t result = co_await read;
+                    results.push_back(result);
+                }
+                catch (...)
+                {
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+            }
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+            co_return results;
+        }
+
+        task<void> close() noexcept
+        {
+            bool expected = false;
+            if (closed.compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            {
+                co_await fd->close();
+            }
+        }
+
+        const std::shared_ptr<detail::file_descriptor> &get_descriptor() const noexcept
+        {
+            return fd;
+        }
+    };
+
+    /// @brief Options for file::open_mapped().
+    struct mapped_options
+    {
+        access_pattern pattern = access_pattern::sequential;
+        /// @brief Largest span handed out by one mapped_rstream::recv().
+        size_t window_size = 64 * 1024;
+        /// @brief How far ahead of the cursor MADV_WILLNEED asks the kernel to start reading, 0 to disable.
+        /// Only used for sequential access.
+        size_t prefetch_distance = 4 * 1024 * 1024;
+    };
+
+    namespace detail
+    {
+        /// @brief A read-only mapping of a whole file, unmapped on destruction.
+        class file_mapping
+        {
+        private:
+            const char *base{nullptr};
+            size_t length{0};
+
+        public:
+            /// @throws std::system_error if the file cannot be opened or mapped
+            explicit file_mapping(const std::filesystem::path &p);
+#if !defined(_WIN32)
+            // maps the first `length` bytes of a descriptor that stays open and stays the caller's to close
+            /// @throws std::system_error if the file cannot be mapped
+            file_mapping(int fd, size_t length);
+#endif
+            ~file_mapping();
+
+            file_mapping(const file_mapping &) = delete;
+            file_mapping &operator=(const file_mapping &) = delete;
+
+            std::span<const char> contents() const noexcept { return {base, length}; }
+
+            void advise(access_pattern pattern) noexcept;
+
+            // asks the kernel to start reading the range in the background, returns immediately
+            void prefetch(size_t offset, size_t size) noexcept;
+        };
+    }
+
+    /// @brief Reads a memory-mapped file as zero-copy windows over the mapping: no read calls and no copies, the
+    /// pages are faulted in from the page cache on first touch. The spans stay valid until the stream is closed or
+    /// destroyed, so they must not be kept beyond that.
+    class mapped_rstream
+    {
+    private:
+        std::shared_ptr<detail::file_mapping> mapping;
+        mapped_options options;
+        size_t position{0};
+        size_t prefetched{0}; // end of the range already handed to MADV_WILLNEED
+
+        void prefetch_ahead() noexcept
+        {
+            // nothing to prefetch once the stream is closed or moved from
+            if (!mapping || options.pattern != access_pattern::sequential || options.prefetch_distance == 0)
+            {
+                return;
+            }
+
+            // top the window up once the cursor has used half of it, so the kernel is asked once per half window
+            size_t size = mapping->contents().size();
+            if (prefetched < size && position + options.prefetch_distance / 2 >= prefetched)
+            {
+                size_t from = std::max(prefetched, position);
+                size_t until = std::min(size, position + options.prefetch_distance);
+                mapping->prefetch(from, until - from);
+                prefetched = until;
+            }
+        }
+
+    public:
+        mapped_rstream(std::shared_ptr<detail::file_mapping> mapping, mapped_options options)
+            : mapping(std::move(mapping)), options(options)
+        {
+            if (this->options.window_size == 0)
+            {
+                throw std::invalid_argument("The window size of a mapped stream must not be zero");
+            }
+            this->mapping->advise(options.pattern);
+            prefetch_ahead();
+        }
+
+        mapped_rstream(mapped_rstream &&) noexcept = default;
+        mapped_rstream &operator=(mapped_rstream &&) noexcept = default;
+        mapped_rstream(const mapped_rstream &) = delete;
+        mapped_rstream &operator=(const mapped_rstream &) = delete;
+
+        /// @brief The next window of at most `window_size` bytes, nullopt at the end of the file.
+        task<std::optional<std::span<const char>>> recv()
+        {
+            if (!mapping || position >= mapping->contents().size())
+            {
+                co_return std::nullopt;
+            }
+
+            auto window = mapping->contents().subspan(position, std::min(options.window_size, mapping->contents().size() - position));
+            position += window.size();
+            prefetch_ahead();
+            co_return window;
+        }
+
+        /// @brief Moves the cursor, e.g. to skip a header. Prefetching continues from the new position.
+        void seek(size_t offset) noexcept
+        {
+            position = offset;
+            prefetched = offset;
+            prefetch_ahead();
+        }
+
+        size_t tell() const noexcept { return position; }
+
+        /// @brief The whole file, for random lookups without going through the cursor.
+        std::span<const char> contents() const noexcept
+        {
+            return mapping ? mapping->contents() : std::span<const char>();
+        }
+
+        task<void> close()
+        {
+            mapping.reset();
+            co_return;
+        }
+    };
+
+    static_assert(async_readable_stream<mapped_rstream, std::span<const char>>);
+    static_assert(async_closeable_stream<mapped_rstream, std::span<const char>>);
+
     class file
     {
     private:
@@ -140,18 +541,32 @@ namespace webcraft::async::io::fs
         file(std::filesystem::path p) : p(std::move(p)) {}
         ~file() = default;
 
-        task<file_rstream> open_readable_stream()
+        task<file_rstream> open_readable_stream(open_options options = {})
         {
-            auto descriptor = co_await detail::make_file_descriptor(p, std::ios_base::in);
+            auto descriptor = co_await detail::make_file_descriptor(p, std::ios_base::in, options);
             co_return file_rstream(descriptor);
         }
 
-        task<file_wstream> open_writable_stream(bool append = false)
+        task<file_wstream> open_writable_stream(bool append = false, open_options options = {})
         {
-            auto descriptor = co_await detail::make_file_descriptor(p, std::ios_base::out | (append ? std::ios_base::app : std::ios_base::trunc));
+            auto descriptor = co_await detail::make_file_descriptor(p, std::ios_base::out | (append ? std::ios_base::app : std::ios_base::trunc), options);
             co_return file_wstream(descriptor);
         }
 
+        /// @brief Opens the file for positional access, read-only unless `writable` (which also creates it if missing).
+        task<random_access_file> open_random_access(bool writable = false, open_options options = {})
+        {
+            auto descriptor = co_await detail::make_file_descriptor(p, writable ? std::ios_base::in | std::ios_base::out : std::ios_base::in, options);
+            co_return random_access_file(descriptor);
+        }
+
+        /// @brief Maps the whole file read-only, see mapped_rstream.
+        task<mapped_rstream> open_mapped(mapped_options options = {})
+        {
+            auto mapping = std::make_shared<detail::file_mapping>(p);
+            co_return mapped_rstream(std::move(mapping), options);
+        }
+
         const std::filesystem::path get_path() const { return p; }
         operator const std::filesystem::path &() const { return p; }
     };
@@ -160,4 +575,258 @@ namespace webcraft::async::io::fs
     {
         return file(p);
     }
+
+    /// @brief What stat() reports about a path.
+    struct file_status
+    {
+        std::filesystem::file_type type = std::filesystem::file_type::none;
+        std::filesystem::perms permissions = std::filesystem::perms::unknown;
+        uint64_t size = 0;
+        uint64_t hard_links = 0;
+        std::chrono::system_clock::time_point last_write_time{};
+    };
+
+    // Metadata operations. On Linux they go through the ring (IORING_OP_STATX, UNLINKAT, RENAMEAT, MKDIRAT and LINKAT)
+    // instead of blocking the runtime thread; elsewhere they run std::filesystem on a thread pool. Failures throw
+    // std::filesystem::filesystem_error with the path(s) involved.
+
+    /// @brief The status of `p`, or of the link itself rather than its target if `follow_symlinks` is false.
+    task<file_status> stat(std::filesystem::path p, bool follow_symlinks = true);
+
+    namespace detail
+    {
+        // the status of an open descriptor without looking its path up again (statx with AT_EMPTY_PATH on Linux); `p`
+        // is what it was opened from, used where the descriptor has no OS handle and for errors
+        task<file_status> stat_descriptor(std::shared_ptr<file_descriptor> fd, std::filesystem::path p);
+    }
+
+    /// @brief Removes a file or symbolic link, not a directory.
+    task<void> unlink(std::filesystem::path p);
+
+    /// @brief Removes an empty directory.
+    task<void> rmdir(std::filesystem::path p);
+
+    /// @brief Renames `from` to `to`, atomically replacing `to` if it exists.
+    task<void> rename(std::filesystem::path from, std::filesystem::path to);
+
+    /// @brief Creates a single directory; the parent must exist and `p` must not.
+    task<void> mkdir(std::filesystem::path p, std::filesystem::perms permissions = std::filesystem::perms::all);
+
+    /// @brief Creates `link_path` as a hard link to `existing`.
+    task<void> link(std::filesystem::path existing, std::filesystem::path link_path);
+
+    /// @brief Stats every path, issuing them all before waiting for any, so on Linux they reach the kernel in one
+    /// submission. Paths that cannot be stat'ed, usually because they no longer exist, come back as nullopt.
+    inline task<std::vector<std::optional<file_status>>> stat_many(std::span<const std::filesystem::path> paths, bool follow_symlinks = true)
+    {
+        std::vector<task<file_status>> pending;
+        pending.reserve(paths.size());
+        for (const auto &p : paths)
+        {
+            pending.push_back(stat(p, follow_symlinks));
+        }
+
+        std::vector<std::optional<file_status>> results;
+        results.reserve(paths.size());
+        std::exception_ptr error; // anything but a failed stat is rethrown once all of them have finished
+        for (auto &status : pending)
+        {
+            try
+            {
+                file_status value = co_await status;
+                results.emplace_back(value);
+            }
+            catch (const std::system_error &)
+            {
+                results.emplace_back(std::nullopt);
+            }
+            catch (...)
+            {
+                results.emplace_back(std::nullopt);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        co_return results;
+    }
+
+    /// @brief Unlinks every path, issuing them all before waiting for any. One failure does not stop the others.
+    /// @return the error for each path in the order of `paths`, empty where the unlink succeeded
+    inline task<std::vector<std::error_code>> unlink_many(std::span<const std::filesystem::path> paths)
+    {
+        std::vector<task<void>> pending;
+        pending.reserve(paths.size());
+        for (const auto &p : paths)
+        {
+            pending.push_back(unlink(p));
+        }
+
+        std::vector<std::error_code> errors;
+        errors.reserve(paths.size());
+        for (auto &removal : pending)
+        {
+            std::error_code error;
+            try
+            {
+                co_await removal;
+            }
+            catch (const std::system_error &e)
+            {
+                error = e.code();
+            }
+            errors.push_back(error);
+        }
+        co_return errors;
+    }
+
+    /// @brief Options for read_all().
+    struct read_all_options
+    {
+        /// @brief Files of at least this size are mapped instead of read into memory.
+        uint64_t mmap_threshold = 1024 * 1024;
+        /// @brief Priority of the open, the reads and the close, see file_stream::set_priority().
+        io_priority priority{};
+    };
+
+    /// @brief The whole contents of a file loaded by read_all(): either a buffer allocated once at the size of the file,
+    /// or for large files a read-only mapping of it.
+    class file_contents
+    {
+    private:
+        std::unique_ptr<char[]> buffer;
+        size_t length{0};
+        std::shared_ptr<detail::file_mapping> mapping;
+
+    public:
+        file_contents() = default;
+        file_contents(std::unique_ptr<char[]> buffer, size_t length) : buffer(std::move(buffer)), length(length) {}
+        explicit file_contents(std::shared_ptr<detail::file_mapping> mapping) : mapping(std::move(mapping)) {}
+
+        std::span<const char> data() const noexcept
+        {
+            return mapping ? mapping->contents() : std::span<const char>(buffer.get(), length);
+        }
+
+        std::string_view view() const noexcept
+        {
+            auto contents = data();
+            return {contents.data(), contents.size()};
+        }
+
+        size_t size() const noexcept { return data().size(); }
+
+        bool mapped() const noexcept { return mapping != nullptr; }
+    };
+
+    /// @brief Loads a whole file. On Linux this takes two submissions: a statx linked to the open, then, with the buffer
+    /// allocated at the reported size, a read linked to the close. Files at or above `mmap_threshold` are mapped instead.
+    /// A file that grows between the statx and the read is read to its new end, at the cost of extra reads.
+    /// @throws std::system_error if the file cannot be opened or read
+    task<file_contents> read_all(std::filesystem::path p, read_all_options options = {});
+
+    /// @brief Loads every file, issuing them all before waiting for any, so on Linux each step of every load goes to the
+    /// kernel in one submission. Files that cannot be read come back as nullopt.
+    inline task<std::vector<std::optional<file_contents>>> read_all_many(std::span<const std::filesystem::path> paths, read_all_options options = {})
+    {
+        std::vector<task<file_contents>> pending;
+        pending.reserve(paths.size());
+        for (const auto &p : paths)
+        {
+            pending.push_back(read_all(p, options));
+        }
+
+        std::vector<std::optional<file_contents>> results;
+        results.reserve(paths.size());
+        std::exception_ptr error;
+        for (auto &load : pending)
+        {
+            try
+            {
+                file_contents contents = co_await load;
+                results.emplace_back(std::move(contents));
+            }
+            catch (const std::system_error &)
+            {
+                results.emplace_back(std::nullopt);
+            }
+            catch (...)
+            {
+                results.emplace_back(std::nullopt);
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        co_return results;
+    }
+
+    /// @brief Options for copy().
+    struct copy_options
+    {
+        /// @brief The file is split into ranges of this many bytes, each copied as one unit by one worker.
+        uint64_t range_size = 16 * 1024 * 1024;
+        /// @brief Ranges copied at the same time; 1 copies front to back.
+        size_t parallelism = 4;
+        /// @brief Called with the bytes copied so far and the size of the file each time a range is done. Calls never
+        /// overlap and the counts only grow, but the ranges behind them may finish out of order.
+        std::function<void(uint64_t copied, uint64_t total)> progress;
+        /// @brief Flushes the copy to disk before returning.
+        bool sync = false;
+    };
+
+    /// @brief Copies the file `from` to `to`, replacing its contents. The destination is sized up front, the file is
+    /// split into ranges and up to `parallelism` of them are copied at once, each at its own offset. On Linux ranges go
+    /// through copy_file_range(), which lets file systems that support it share extents (reflinks) or copy on the
+    /// server; where it is refused, e.g. across file systems, they are spliced through a pipe, and where that is refused
+    /// too they are read and written through a buffer reused for the whole range.
+    /// @return the number of bytes copied
+    /// @throws std::system_error if either file cannot be opened, or a range cannot be read or written
+    task<uint64_t> copy(std::filesystem::path from, std::filesystem::path to, copy_options options = {});
+
+    /// @brief One entry produced by walk().
+    struct dir_entry
+    {
+        std::filesystem::path path;
+        /// @brief The type of the entry itself; a symbolic link is reported as a symlink even when it is followed.
+        std::filesystem::file_type type = std::filesystem::file_type::unknown;
+        /// @brief 0 for entries directly inside the root.
+        size_t depth = 0;
+        /// @brief Filled in with walk_options::stat, unless the entry disappeared before it could be stat'ed.
+        std::optional<file_status> status;
+    };
+
+    /// @brief Options for walk().
+    struct walk_options
+    {
+        bool recursive = true;
+        /// @brief Descend into symbolic links to directories. Nothing guards against links that form a cycle.
+        bool follow_symlinks = false;
+        /// @brief Resolve a file_status for every entry, one stat_many() per batch.
+        bool stat = false;
+        /// @brief Skip subdirectories that cannot be read instead of failing the walk. The root always throws.
+        bool skip_errors = false;
+        /// @brief Directories read at the same time.
+        size_t max_parallel = 4;
+        /// @brief Entries handed over per read, so huge directories are streamed rather than loaded at once.
+        size_t batch_size = 1024;
+    };
+
+    /// @brief Lists everything below `root` without blocking the runtime thread. Directories are read in batches on a
+    /// thread pool (with getdents64 on Linux), up to `max_parallel` of them at once, so a wide tree is scanned in
+    /// parallel. Entries come out in no particular order except that a directory is yielded before its contents.
+    /// @throws std::filesystem::filesystem_error if `root`, or with `skip_errors` unset any subdirectory, cannot be read
+    async_generator<dir_entry> walk(std::filesystem::path root, walk_options options = {});
 }
\ No newline at end of file
@@ -9,6 +9,17 @@
 #include "core.hpp"
 #include "adaptors.hpp"
 #include "fs.hpp"
+#include "direct_io.hpp"
+#include "read_ahead.hpp"
 #include "socket.hpp"
+#include "rate_limiter.hpp"
+#include "compression.hpp"
+#include "checksum.hpp"
+#include "transfer.hpp"
+#include "append_log.hpp"
+#include "block_cache.hpp"
+#include "open_file_cache.hpp"
+#include "sharded_listener.hpp"
+#include "connection_pool.hpp"
 
 // #define WEBCRAFT_UDP_MOCK
\ No newline at end of file
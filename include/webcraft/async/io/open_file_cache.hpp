@@ -0,0 +1,112 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include "core.hpp"
+#include "fs.hpp"
+
+namespace webcraft::async::io::fs
+{
+    /// @brief Options for open_file_cache.
+    struct open_file_cache_options
+    {
+        /// @brief Least recently used files are closed beyond this many.
+        size_t max_entries = 1024;
+        /// @brief A file is reopened this long after it was opened, zero to keep it until it changes or is evicted.
+        std::chrono::steady_clock::duration ttl = std::chrono::seconds(30);
+        /// @brief Drops a file as soon as it is written to, replaced or removed (inotify on Linux, ignored elsewhere).
+        bool watch = true;
+    };
+
+    /// @brief Counters of an open_file_cache since it was created.
+    struct open_file_cache_stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        /// @brief Files dropped because they changed on disk, their TTL ran out or invalidate() was called.
+        uint64_t invalidations;
+        uint64_t evictions;
+        size_t entries;
+    };
+
+    namespace detail
+    {
+        struct open_file_cache_state;
+
+        struct open_file_entry
+        {
+            std::filesystem::path path;
+            std::shared_ptr<file_descriptor> fd;
+            file_status status;
+
+            open_file_entry(std::filesystem::path path, std::shared_ptr<file_descriptor> fd, file_status status)
+                : path(std::move(path)), fd(std::move(fd)), status(status) {}
+            open_file_entry(const open_file_entry &) = delete;
+            open_file_entry &operator=(const open_file_entry &) = delete;
+
+            // closes the descriptor, which only happens once the cache and every handle have let go of it
+            ~open_file_entry() noexcept;
+        };
+    }
+
+    /// @brief A read-only file handed out by an open_file_cache together with its status at the time it was opened.
+    /// Handles are reference counted: copies share the descriptor and it stays open while any of them is alive, even
+    /// after the cache has dropped it. Reads are positional, so any number of handles can use it at once.
+    class open_file_handle
+    {
+    private:
+        std::shared_ptr<detail::open_file_entry> entry;
+
+    public:
+        explicit open_file_handle(std::shared_ptr<detail::open_file_entry> entry) : entry(std::move(entry)) {}
+
+        const std::filesystem::path &path() const noexcept { return entry->path; }
+
+        const file_status &status() const noexcept { return entry->status; }
+
+        /// @brief Reads up to `buffer.size()` bytes starting at `offset`; fewer only at the end of the file.
+        task<size_t> read_at(uint64_t offset, std::span<char> buffer)
+        {
+            return entry->fd->read_at(offset, buffer);
+        }
+
+        /// @brief The shared descriptor, e.g. for io::transfer(). It must not be closed or read through its file position.
+        const std::shared_ptr<detail::file_descriptor> &get_descriptor() const noexcept { return entry->fd; }
+    };
+
+    /// @brief Keeps recently used files open together with their status, keyed by path, so that serving a file that is
+    /// already open costs no open, stat or close. Misses open the file and stat the descriptor. Entries leave the cache
+    /// when the file changes on disk (watched with inotify on Linux), when their TTL runs out, on invalidate(), or as the
+    /// least recently used once there are more than `max_entries`.
+    ///
+    /// Paths are only normalised lexically, so the same file reached through a symlink or from another working
+    /// directory is a different entry. Copies of an open_file_cache share the same cache.
+    class open_file_cache
+    {
+    private:
+        std::shared_ptr<detail::open_file_cache_state> state;
+
+    public:
+        explicit open_file_cache(open_file_cache_options options = {});
+
+        /// @brief The open file at `p`, opening it for reading if it is not cached.
+        /// @throws std::system_error if it cannot be opened
+        task<open_file_handle> acquire(std::filesystem::path p);
+
+        /// @brief Drops `p` from the cache. Handles already acquired keep working on the old descriptor.
+        void invalidate(const std::filesystem::path &p);
+
+        /// @brief Drops every entry.
+        void clear();
+
+        open_file_cache_stats stats() const;
+    };
+}
@@ -0,0 +1,311 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <mutex>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <exception>
+#include <optional>
+#include <algorithm>
+#include <webcraft/async/runtime.hpp>
+#include "core.hpp"
+#include "adaptors.hpp"
+
+namespace webcraft::async::io
+{
+    /// @brief Token bucket that can be shared between any number of streams.
+    ///
+    /// The bucket refills at `rate` tokens per second up to `burst` tokens. A request that finds enough tokens
+    /// completes without suspending. Otherwise the tokens are still taken, leaving the bucket in debt, and the
+    /// caller sleeps exactly once until the debt is paid off. Waiters are therefore served in the order they
+    /// asked, nothing is polled, and a request larger than `burst` is delayed but never rejected. A request only
+    /// takes its tokens once it is awaited, and a wait cancelled through its stop token gives them back and throws.
+    class rate_limiter
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+    private:
+        double rate;
+        double burst;
+        double tokens;
+        clock::time_point last_refill;
+        std::mutex mutex;
+
+        void refill(clock::time_point now)
+        {
+            std::chrono::duration<double> elapsed = now - last_refill;
+            tokens = std::min(burst, tokens + elapsed.count() * rate);
+            last_refill = now;
+        }
+
+        void refund(double n)
+        {
+            std::lock_guard lock(mutex);
+            refill(clock::now());
+            tokens = std::min(burst, tokens + n);
+        }
+
+    public:
+        rate_limiter(double tokens_per_second, double burst) : rate(tokens_per_second), burst(burst), tokens(burst), last_refill(clock::now())
+        {
+            if (tokens_per_second <= 0 || burst <= 0)
+            {
+                throw std::invalid_argument("rate_limiter requires a positive rate and burst");
+            }
+        }
+
+        rate_limiter(const rate_limiter &) = delete;
+        rate_limiter &operator=(const rate_limiter &) = delete;
+
+        /// @brief Takes `n` tokens, possibly going into debt.
+        /// @return how long the caller has to wait before it may proceed, zero if it may proceed immediately
+        clock::duration reserve(double n)
+        {
+            std::lock_guard lock(mutex);
+            refill(clock::now());
+            tokens -= n;
+            if (tokens >= 0)
+            {
+                return clock::duration::zero();
+            }
+            return std::chrono::ceil<clock::duration>(std::chrono::duration<double>(-tokens / rate));
+        }
+
+        /// @brief Takes `n` tokens only if they are available right now.
+        bool try_acquire(double n)
+        {
+            std::lock_guard lock(mutex);
+            refill(clock::now());
+            if (tokens < n)
+            {
+                return false;
+            }
+            tokens -= n;
+            return true;
+        }
+
+        /// @brief Number of tokens currently available, negative while the bucket is in debt.
+        double available()
+        {
+            std::lock_guard lock(mutex);
+            refill(clock::now());
+            return tokens;
+        }
+
+        /// @brief Awaitable returned by acquire(). The tokens are reserved when it is awaited, so one that is dropped
+        /// unawaited costs nothing.
+        /// @throws std::system_error with std::errc::operation_canceled if the wait is stopped through its token
+        class acquire_awaitable
+        {
+        private:
+            rate_limiter &limiter;
+            double n;
+            std::optional<std::stop_token> token;
+            clock::duration delay{};
+            bool cancelled{false};
+            std::exception_ptr error;
+
+            static fire_and_forget_task resume_after(acquire_awaitable &awaiter, std::coroutine_handle<> h, std::stop_token token)
+            {
+                auto deadline = clock::now() + awaiter.delay;
+                try
+                {
+                    co_await sleep_for(awaiter.delay, token);
+                }
+                catch (...)
+                {
+                    awaiter.error = std::current_exception();
+                }
+
+                awaiter.cancelled = token.stop_requested();
+                if ((awaiter.cancelled || awaiter.error) && clock::now() < deadline)
+                {
+                    awaiter.limiter.refund(awaiter.n); // the debt was not paid off, so the tokens were never used
+                }
+                h.resume();
+            }
+
+        public:
+            acquire_awaitable(rate_limiter &limiter, double n, std::optional<std::stop_token> token) : limiter(limiter), n(n), token(std::move(token)) {}
+
+            bool await_ready()
+            {
+                delay = limiter.reserve(n);
+                return delay <= clock::duration::zero();
+            }
+
+            void await_suspend(std::coroutine_handle<> h)
+            {
+                resume_after(*this, h, token ? *token : get_stop_token());
+            }
+
+            void await_resume() const
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+                if (cancelled)
+                {
+                    throw std::system_error(std::make_error_code(std::errc::operation_canceled), "Rate limiter wait was cancelled");
+                }
+            }
+        };
+
+        /// @brief Takes `n` tokens and waits until the bucket allows them to be used.
+        /// Does not allocate or suspend when the tokens are available.
+        acquire_awaitable acquire(double n = 1)
+        {
+            return acquire_awaitable(*this, n, std::nullopt);
+        }
+
+        acquire_awaitable acquire(double n, std::stop_token token)
+        {
+            return acquire_awaitable(*this, n, std::move(token));
+        }
+    };
+
+    /// @brief Wraps a stream so that every element read or written draws one token from a rate_limiter.
+    /// Buffered reads are charged after the read for the bytes actually received; writes are charged before sending.
+    /// Like the adaptors, an lvalue stream is borrowed and an rvalue stream is moved into the wrapper.
+    template <typename T, typename Stream>
+    class rate_limited_stream
+    {
+    private:
+        using stream_type = std::remove_cvref_t<Stream>;
+
+        Stream stream;
+        std::shared_ptr<rate_limiter> limiter;
+
+    public:
+        rate_limited_stream(Stream &&stream, std::shared_ptr<rate_limiter> limiter)
+            : stream(std::forward<Stream>(stream)), limiter(std::move(limiter))
+        {
+            if (!this->limiter)
+            {
+                throw std::invalid_argument("rate_limited_stream requires a rate limiter");
+            }
+        }
+
+        task<std::optional<T>> recv()
+            requires async_readable_stream<stream_type, T>
+        {
+            auto value = co_await stream.recv();
+            if (value.has_value())
+            {
+                co_await limiter->acquire(1);
+            }
+            co_return value;
+        }
+
+        task<size_t> recv(std::span<T> buffer)
+            requires async_buffered_readable_stream<stream_type, T>
+        {
+            size_t received = co_await stream.recv(buffer);
+            if (received > 0)
+            {
+                co_await limiter->acquire(static_cast<double>(received));
+            }
+            co_return received;
+        }
+
+        task<bool> send(T value)
+            requires async_writable_stream<stream_type, T>
+        {
+            co_await limiter->acquire(1);
+            bool sent = co_await stream.send(std::move(value));
+            co_return sent;
+        }
+
+        task<size_t> send(std::span<const T> buffer)
+            requires async_buffered_writable_stream<stream_type, T>
+        {
+            if (buffer.empty())
+            {
+                co_return 0;
+            }
+            co_await limiter->acquire(static_cast<double>(buffer.size()));
+            size_t sent = co_await stream.send(buffer);
+            co_return sent;
+        }
+
+        task<void> close()
+            requires async_closeable_stream<stream_type, T>
+        {
+            return stream.close();
+        }
+
+        const std::shared_ptr<rate_limiter> &get_limiter() const
+        {
+            return limiter;
+        }
+    };
+
+    /// @brief Limits a stream to `tokens_per_second` elements (bytes for char streams) with bursts of up to `burst`.
+    template <typename T, typename Stream>
+        requires(async_readable_stream<std::remove_cvref_t<Stream>, T> || async_writable_stream<std::remove_cvref_t<Stream>, T>)
+    auto rate_limit(Stream &&stream, double tokens_per_second, double burst)
+    {
+        return rate_limited_stream<T, Stream>(std::forward<Stream>(stream), std::make_shared<rate_limiter>(tokens_per_second, burst));
+    }
+
+    /// @brief Limits a stream with a limiter shared with other streams, e.g. to cap all connections of one tenant together.
+    template <typename T, typename Stream>
+        requires(async_readable_stream<std::remove_cvref_t<Stream>, T> || async_writable_stream<std::remove_cvref_t<Stream>, T>)
+    auto rate_limit(Stream &&stream, std::shared_ptr<rate_limiter> limiter)
+    {
+        return rate_limited_stream<T, Stream>(std::forward<Stream>(stream), std::move(limiter));
+    }
+}
+
+namespace webcraft::async::io::adaptors
+{
+    namespace detail
+    {
+        // the limiter is a coroutine parameter so the generator keeps it alive after the adaptor is gone
+        template <typename T>
+        async_generator<T> rate_limited_generator(async_generator<T> gen, std::shared_ptr<rate_limiter> limiter)
+        {
+            for_each_async(value, gen,
+                           {
+                               co_await limiter->acquire(1);
+                               co_yield std::move(value);
+                           });
+        }
+    }
+
+    /// @brief Lets elements through as long as the shared limiter has tokens for them, one token per element.
+    template <typename T>
+    auto rate_limit(std::shared_ptr<rate_limiter> limiter)
+    {
+        if (!limiter)
+        {
+            throw std::invalid_argument("rate_limit requires a rate limiter");
+        }
+
+        return transform<T>([limiter = std::move(limiter)](async_generator<T> gen) -> async_generator<T>
+                            { return detail::rate_limited_generator<T>(std::move(gen), limiter); });
+    }
+
+    /// @brief Lets through at most `tokens_per_second` elements per second, with bursts of up to `burst` elements.
+    template <typename T>
+    auto rate_limit(double tokens_per_second, double burst)
+    {
+        return rate_limit<T>(std::make_shared<rate_limiter>(tokens_per_second, burst));
+    }
+
+    /// @brief Spaces elements evenly at `items_per_second`, without bursts. Useful to replay recorded traffic at its original pace.
+    template <typename T>
+    auto pace(double items_per_second)
+    {
+        return rate_limit<T>(items_per_second, 1);
+    }
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+#include "core.hpp"
+#include "fs.hpp"
+
+namespace webcraft::async::io::fs
+{
+    /// @brief Options for open_read_ahead_stream().
+    struct read_ahead_options
+    {
+        /// @brief Size of every read, and so of every chunk the stream yields.
+        size_t chunk_size = 256 * 1024;
+        /// @brief Reads kept in flight to begin with.
+        size_t depth = 4;
+        /// @brief Upper bound for the number of reads in flight once the depth adapts.
+        size_t max_depth = 64;
+        /// @brief Doubles the depth while that still raises the observed throughput.
+        bool adaptive = true;
+        /// @brief Tells the kernel the file is read sequentially and asks it to prefetch past the reads in flight
+        /// (posix_fadvise through io_uring on Linux).
+        bool advise = true;
+    };
+
+    /// @brief Reads a file front to back with several reads at consecutive offsets in flight at once, so a single
+    /// stream is bounded by the device's bandwidth rather than by the latency of one read. Chunks come out in file
+    /// order. With `adaptive` the stream starts at `depth` reads and keeps doubling while each step gains at least
+    /// 10% throughput, then settles on the best depth it has seen.
+    class read_ahead_rstream
+    {
+    private:
+        struct pending_read
+        {
+            std::vector<char> buffer;
+            task<size_t> read;
+        };
+
+        random_access_file file;
+        read_ahead_options options;
+        std::deque<pending_read> in_flight;
+        uint64_t next_offset;
+        uint64_t known_size;     // size at open, reads past it are issued one at a time
+        uint64_t advised_until;  // end of the range already handed to prefetch()
+        std::optional<task<void>> hint;
+        bool eof{false};
+        size_t current_depth;
+
+        struct depth_tuner
+        {
+            std::chrono::steady_clock::time_point sample_start{std::chrono::steady_clock::now()};
+            uint64_t sample_bytes{0};
+            size_t sample_chunks{0};
+            double best_rate{0};
+            size_t best_depth;
+            bool settled{false};
+        } tuner;
+
+        void issue()
+        {
+            while (!eof && in_flight.size() < current_depth && (next_offset < known_size || in_flight.empty()))
+            {
+                std::vector<char> buffer(options.chunk_size);
+                auto read = file.read_at(next_offset, buffer); // the heap storage stays put when the vector moves
+                in_flight.push_back({std::move(buffer), std::move(read)});
+                next_offset += options.chunk_size;
+            }
+
+            if (options.advise && !eof && next_offset < known_size && (!hint || hint->await_ready()))
+            {
+                // keep the kernel up to one window ahead of what is already being read, topped up every half window
+                uint64_t window = static_cast<uint64_t>(current_depth) * options.chunk_size;
+                uint64_t from = std::max(advised_until, next_offset);
+                if (from < next_offset + window / 2 && from < known_size)
+                {
+                    advised_until = std::min(known_size, next_offset + window);
+                    hint = file.get_descriptor()->prefetch(from, advised_until - from);
+                }
+            }
+        }
+
+        void adapt(size_t received)
+        {
+            if (!options.adaptive || tuner.settled)
+            {
+                return;
+            }
+
+            tuner.sample_bytes += received;
+            if (++tuner.sample_chunks < current_depth * 2)
+            {
+                return; // too short to tell noise from a trend
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            double rate = static_cast<double>(tuner.sample_bytes) / std::chrono::duration<double>(now - tuner.sample_start).count();
+            if (rate > tuner.best_rate * 1.1)
+            {
+                tuner.best_rate = rate;
+                tuner.best_depth = current_depth;
+                if (current_depth < options.max_depth)
+                {
+                    current_depth = std::min(options.max_depth, current_depth * 2);
+                }
+                else
+                {
+                    tuner.settled = true;
+                }
+            }
+            else
+            {
+                current_depth = tuner.best_depth;
+                tuner.settled = true;
+            }
+
+            tuner.sample_start = now;
+            tuner.sample_bytes = 0;
+            tuner.sample_chunks = 0;
+        }
+
+        // in-flight reads point into buffers owned by this stream, so they have to finish before it goes away
+        static task<void> drain(std::deque<pending_read> &reads, std::optional<task<void>> &hint)
+        {
+            while (!reads.empty())
+            {
+                auto pending = std::move(reads.front());
+                reads.pop_front();
+                try
+                {
+                    co_await pending.read;
+                }
+                catch (...)
+                {
+                }
+            }
+
+            if (hint)
+            {
+                auto pending = std::move(*hint);
+                hint.reset();
+                co_await pending;
+            }
+        }
+
+        static task<void> abandon(random_access_file file, std::deque<pending_read> reads, std::optional<task<void>> hint)
+        {
+            co_await drain(reads, hint);
+            co_await file.close();
+        }
+
+        void release() noexcept
+        {
+            if (file.get_descriptor() && (!in_flight.empty() || (hint && !hint->await_ready())))
+            {
+                fire_and_forget(abandon(std::move(file), std::exchange(in_flight, {}), std::exchange(hint, std::nullopt)));
+            }
+        }
+
+    public:
+        read_ahead_rstream(random_access_file file, read_ahead_options options, uint64_t offset, uint64_t known_size)
+            : file(std::move(file)), options(options), next_offset(offset), known_size(known_size), advised_until(offset),
+              current_depth(options.depth)
+        {
+            tuner.best_depth = options.depth;
+            if (options.chunk_size == 0 || options.depth == 0)
+            {
+                throw std::invalid_argument("Read-ahead needs a non-zero chunk size and depth");
+            }
+            this->options.max_depth = std::max(options.max_depth, options.depth);
+        }
+
+        read_ahead_rstream(read_ahead_rstream &&) noexcept = default;
+        read_ahead_rstream &operator=(read_ahead_rstream &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                file = std::move(other.file);
+                options = other.options;
+                in_flight = std::exchange(other.in_flight, {});
+                next_offset = other.next_offset;
+                known_size = other.known_size;
+                advised_until = other.advised_until;
+                hint = std::exchange(other.hint, std::nullopt);
+                eof = other.eof;
+                current_depth = other.current_depth;
+                tuner = other.tuner;
+            }
+            return *this;
+        }
+        read_ahead_rstream(const read_ahead_rstream &) = delete;
+        read_ahead_rstream &operator=(const read_ahead_rstream &) = delete;
+
+        ~read_ahead_rstream() noexcept
+        {
+            release();
+        }
+
+        /// @brief The next chunk of at most `chunk_size` bytes, nullopt at the end of the file.
+        task<std::optional<std::vector<char>>> recv()
+        {
+            issue();
+            if (in_flight.empty())
+            {
+                co_return std::nullopt;
+            }
+
+            auto pending = std::move(in_flight.front());
+            in_flight.pop_front();
+            size_t received = co_await pending.read;
+            adapt(received);
+
+            if (received < pending.buffer.size())
+            {
+                // the end of the file: whatever was issued past it comes back empty
+                eof = true;
+                co_await drain(in_flight, hint);
+                if (received == 0)
+                {
+                    co_return std::nullopt;
+                }
+            }
+
+            pending.buffer.resize(received);
+            issue(); // top up before handing the chunk out so the device stays busy while the caller works on it
+            co_return std::move(pending.buffer);
+        }
+
+        /// @brief The number of reads the stream currently keeps in flight.
+        size_t depth() const noexcept { return current_depth; }
+
+        task<void> close()
+        {
+            co_await drain(in_flight, hint);
+            co_await file.close();
+        }
+    };
+
+    static_assert(async_readable_stream<read_ahead_rstream, std::vector<char>>);
+    static_assert(async_closeable_stream<read_ahead_rstream, std::vector<char>>);
+
+    /// @brief Opens `f` for deep-queue sequential reading from `offset`, see read_ahead_rstream.
+    inline task<read_ahead_rstream> open_read_ahead_stream(file f, read_ahead_options options = {}, uint64_t offset = 0)
+    {
+        auto opened = co_await f.open_random_access();
+        file_status status = co_await detail::stat_descriptor(opened.get_descriptor(), f.get_path());
+        uint64_t size = status.size;
+        if (options.advise)
+        {
+            co_await opened.get_descriptor()->advise(offset, 0, access_pattern::sequential);
+        }
+        co_return read_ahead_rstream(std::move(opened), options, offset, size);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <vector>
+#include "core.hpp"
+#include "socket.hpp"
+
+namespace webcraft::async::io::socket
+{
+    /// @brief Options for make_sharded_listener().
+    struct sharded_listener_options
+    {
+        /// @brief Applied to every shard and to the sockets it accepts; reuse_port is always turned on.
+        socket_options socket;
+        /// @brief The listen() backlog of each shard.
+        int backlog = 1024;
+        /// @brief Hands each connection to the shard numbered after the CPU that received its SYN, modulo the number of
+        /// shards, instead of to one picked by hashing its addresses (SO_ATTACH_REUSEPORT_CBPF, Linux; ignored elsewhere).
+        bool steer_to_cpu = false;
+    };
+
+    /// @brief Several listening sockets bound to the same address with SO_REUSEPORT. The kernel spreads incoming
+    /// connections over their accept queues, so they are not all serialised on the lock of one queue, and every shard
+    /// can have an accept in flight at once.
+    ///
+    /// Each shard needs an accept loop of its own: connections the kernel gave to a shard nobody accepts on wait there
+    /// until its backlog fills. Closing one shard while the others stay open moves its pending connections nowhere, they
+    /// are reset, so shards are closed together with close().
+    class sharded_listener
+    {
+    private:
+        std::vector<tcp_listener> shards;
+
+    public:
+        explicit sharded_listener(std::vector<tcp_listener> shards) : shards(std::move(shards)) {}
+
+        size_t size() const noexcept { return shards.size(); }
+
+        tcp_listener &shard(size_t index) { return shards.at(index); }
+
+        /// @brief Accepts the next connection the kernel gave to shard `index`.
+        task<tcp_socket> accept(size_t index)
+        {
+            return shards.at(index).accept();
+        }
+
+        task<void> close()
+        {
+            for (auto &shard : shards)
+            {
+                co_await shard.close();
+            }
+        }
+    };
+
+    /// @brief Binds `shards` listeners to `info` and starts them listening, zero for one per hardware thread. If
+    /// `info.port` is 0 the first shard picks a free port and the others join it.
+    ///
+    /// Platforms without SO_REUSEPORT (Windows) get a single shard.
+    /// @throws std::system_error if a shard cannot be bound, e.g. because a socket without SO_REUSEPORT holds the address
+    sharded_listener make_sharded_listener(const connection_info &info, size_t shards = 0, sharded_listener_options options = {});
+}
@@ -7,10 +7,19 @@
 
 #include "core.hpp"
 #include <webcraft/async/fire_and_forget_task.hpp>
+#include <webcraft/async/io_priority.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
 #include <cstdio>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <string_view>
+#include <vector>
+
+struct sockaddr;
 
 namespace webcraft::async::io::socket
 {
@@ -20,6 +29,63 @@ namespace webcraft::async::io::socket
         uint16_t port;
     };
 
+    /// @brief An IPv4 or IPv6 socket address as the kernel takes and returns it (a copy of a sockaddr_storage). Unlike
+    /// connection_info it needs no name lookup to be used, and is only formatted to a string when asked, so it is the
+    /// type for per-packet and per-connection paths: resolve a destination once and send to the address from then on.
+    class socket_address
+    {
+    private:
+        alignas(8) std::array<std::byte, 128> storage{};
+        size_t length{0};
+
+    public:
+        socket_address() = default;
+
+        /// @brief Copies the `length` bytes of `addr`.
+        /// @throws std::invalid_argument if `length` is larger than a sockaddr_storage
+        socket_address(const ::sockaddr *addr, size_t length);
+
+        /// @brief Parses a numeric IPv4 or IPv6 address; never consults the name service. Empty if `host` is not numeric.
+        static std::optional<socket_address> parse(std::string_view host, uint16_t port);
+
+        /// @brief Resolves `info` through getaddrinfo, in the order getaddrinfo sorts the results.
+        /// @throws webcraft::net::util::get_addr_info_error if the host cannot be resolved
+        static std::vector<socket_address> resolve_all(const connection_info &info);
+
+        /// @brief The first address resolve_all() returns.
+        static socket_address resolve(const connection_info &info);
+
+        const ::sockaddr *data() const noexcept { return reinterpret_cast<const ::sockaddr *>(storage.data()); }
+        ::sockaddr *data() noexcept { return reinterpret_cast<::sockaddr *>(storage.data()); }
+        size_t size() const noexcept { return length; }
+        static constexpr size_t capacity() noexcept { return sizeof(storage); }
+
+        /// @brief Sets how many bytes of the storage are valid, after the kernel has written an address into data().
+        void resize(size_t size)
+        {
+            if (size > capacity())
+                throw std::invalid_argument("Socket address larger than sockaddr_storage");
+            length = size;
+        }
+
+        bool empty() const noexcept { return length == 0; }
+
+        /// @brief AF_INET, AF_INET6, or AF_UNSPEC for an empty address.
+        int family() const noexcept;
+        uint16_t port() const noexcept;
+
+        /// @brief The numeric host, e.g. "192.0.2.1" or "fe80::1%eth0".
+        std::string host() const;
+        /// @brief "192.0.2.1:80" or "[2001:db8::1]:80".
+        std::string to_string() const;
+        connection_info to_connection_info() const { return {host(), port()}; }
+
+        friend bool operator==(const socket_address &a, const socket_address &b) noexcept
+        {
+            return a.length == b.length && std::equal(a.storage.begin(), a.storage.begin() + a.length, b.storage.begin());
+        }
+    };
+
     /// Placeholder for options when joining a multicast group. Currently empty: an instance
     /// of this type indicates default multicast join behavior. Fields may be added in the future.
     struct multicast_join_options
@@ -57,6 +123,57 @@ namespace webcraft::async::io::socket
         WRITE
     };
 
+    /// @brief TCP keepalive: after `idle` without traffic a probe is sent every `interval`, and the connection is reset
+    /// once `probes` of them in a row go unanswered.
+    struct keepalive_options
+    {
+        std::chrono::seconds idle{60};
+        std::chrono::seconds interval{10};
+        int probes = 6;
+    };
+
+    /// @brief Options for the OS sockets behind a tcp_socket, tcp_listener or udp_socket. They are applied to the socket a
+    /// tcp_socket connects with, to a listener's socket and to every socket it accepts, and to a datagram socket when it
+    /// is created and when it is bound. Unset fields keep the system default. Options a platform does not have are
+    /// ignored; one the kernel rejects fails the call that created the socket with std::system_error.
+    struct socket_options
+    {
+        /// @brief TCP_NODELAY: small writes go out at once instead of waiting for earlier data to be acknowledged.
+        std::optional<bool> no_delay;
+        /// @brief SO_RCVBUF in bytes. Set on a listener before listen(), so the window scale every connection offers
+        /// fits it; accepted sockets inherit it.
+        std::optional<int> receive_buffer;
+        /// @brief SO_SNDBUF in bytes, inherited by accepted sockets like receive_buffer.
+        std::optional<int> send_buffer;
+        /// @brief TCP_QUICKACK (Linux): acknowledge at once instead of delaying. The kernel falls back to delayed acks
+        /// by itself, so it is set again after every read.
+        std::optional<bool> quick_ack;
+        /// @brief SO_KEEPALIVE together with its idle time, probe interval and probe count.
+        std::optional<keepalive_options> keepalive;
+        /// @brief SO_BUSY_POLL (Linux): how long a receive polls the device queue before sleeping. Raising it above
+        /// net.core.busy_read needs CAP_NET_ADMIN.
+        std::optional<std::chrono::microseconds> busy_poll;
+        /// @brief TCP Fast Open. On a listener, how many fast-open connections may be pending (TCP_FASTOPEN); on a
+        /// connecting socket any value turns on TCP_FASTOPEN_CONNECT, so the first write rides on the SYN.
+        std::optional<int> fast_open;
+        /// @brief TCP_DEFER_ACCEPT (Linux, listeners): accept() only returns a connection once data has arrived on it,
+        /// or this long after the handshake.
+        std::optional<std::chrono::seconds> defer_accept;
+        /// @brief SO_REUSEADDR on listeners and bound datagram sockets, so a restarted server can bind its port while
+        /// old connections are in TIME_WAIT (not set on Windows, where it lets another socket take the port).
+        bool reuse_address = true;
+        /// @brief SO_REUSEPORT on listeners and bound datagram sockets: several sockets of the same user may bind the
+        /// same address, and the kernel spreads connections or datagrams over them. make_sharded_listener() sets it.
+        bool reuse_port = false;
+        /// @brief Happy Eyeballs (RFC 8305, Linux): when a host has several addresses, connect() tries them with the
+        /// families interleaved and starts the next one if the current one has not connected after this long, without
+        /// giving up on it; the first to connect wins. An address that fails starts the next one at once. Zero starts
+        /// them all together.
+        std::chrono::milliseconds connect_attempt_delay{250};
+        /// @brief Fails connect() with std::errc::timed_out if no address has connected after this long (Linux).
+        std::optional<std::chrono::milliseconds> connect_timeout;
+    };
+
     namespace detail
     {
         /// Returns true if the given address string is a valid IPv4 or IPv6 multicast address.
@@ -108,26 +225,67 @@ namespace webcraft::async::io::socket
 
         class tcp_descriptor_base
         {
+        protected:
+            socket_options options;
+
         public:
             tcp_descriptor_base() = default;
             virtual ~tcp_descriptor_base() = default;
 
+            // the options applied to the OS sockets created from now on, and by a listener to the ones it accepts
+            void set_options(socket_options options) { this->options = std::move(options); }
+
+            const socket_options &get_options() const noexcept { return options; }
+
             virtual task<void> close() = 0; // Close the socket
         };
 
         class tcp_socket_descriptor : public tcp_descriptor_base
         {
+        protected:
+            io_priority read_priority;
+            io_priority write_priority;
+
         public:
             tcp_socket_descriptor() = default;
             virtual ~tcp_socket_descriptor() = default;
 
+            // the priority of the reads or writes issued from now on; it orders them in the runtime, the SQE's ioprio
+            // field means something else for socket operations
+            void set_priority(socket_stream_mode mode, io_priority priority) noexcept
+            {
+                (mode == socket_stream_mode::READ ? read_priority : write_priority) = priority;
+            }
+
+            io_priority get_priority(socket_stream_mode mode) const noexcept
+            {
+                return mode == socket_stream_mode::READ ? read_priority : write_priority;
+            }
+
             virtual task<void> connect(const connection_info &info) = 0;  // Connect to a server
             virtual task<size_t> read(std::span<char> buffer) = 0;        // Read data from the socket
             virtual task<size_t> write(std::span<const char> buffer) = 0; // Write data to the socket
             virtual void shutdown(socket_stream_mode mode) = 0;           // Shutdown the socket
 
+            // connects to addresses that are already resolved; descriptors without a native path go through the
+            // connection_info overload with the numeric host
+            virtual task<void> connect(const std::vector<socket_address> &addresses)
+            {
+                if (addresses.empty())
+                    throw std::invalid_argument("No address to connect to");
+                co_await connect(addresses.front().to_connection_info());
+            }
+
             virtual std::string get_remote_host() = 0;
             virtual uint16_t get_remote_port() = 0;
+
+            virtual socket_address get_remote_address()
+            {
+                return socket_address::parse(get_remote_host(), get_remote_port()).value_or(socket_address{});
+            }
+
+            // OS socket used by the zero-copy transfer paths, -1 if there is none (mocks, non-posix platforms)
+            virtual int native_handle() const noexcept { return -1; }
         };
 
         class tcp_listener_descriptor : public tcp_descriptor_base
@@ -139,12 +297,20 @@ namespace webcraft::async::io::socket
             virtual void bind(const connection_info &info) = 0;                // Bind the listener to an address
             virtual void listen(int backlog) = 0;                              // Start listening for incoming connections
             virtual task<std::shared_ptr<tcp_socket_descriptor>> accept() = 0; // Accept a new connection
+
+            virtual void bind(const socket_address &address) { bind(address.to_connection_info()); }
+
+            // OS socket of the listener once it is bound, -1 before that or where there is none
+            virtual int native_handle() const noexcept { return -1; }
         };
 
         class udp_socket_descriptor
         {
+        protected:
+            socket_options options;
+
         public:
-            udp_socket_descriptor(std::optional<ip_version> version) {}
+            udp_socket_descriptor(std::optional<ip_version> version, socket_options options = {}) : options(std::move(options)) {}
             virtual ~udp_socket_descriptor() = default;
 
             virtual task<void> close() = 0;
@@ -153,15 +319,32 @@ namespace webcraft::async::io::socket
             virtual task<size_t> recvfrom(std::span<char> buffer, connection_info &info) = 0;
             virtual task<size_t> sendto(std::span<const char> buffer, const connection_info &info) = 0;
 
+            // the address overloads skip the name service on the native paths; elsewhere they go through the
+            // connection_info ones
+            virtual void bind(const socket_address &address) { bind(address.to_connection_info()); }
+
+            virtual task<size_t> recvfrom(std::span<char> buffer, socket_address &from)
+            {
+                connection_info info;
+                size_t received = co_await recvfrom(buffer, info);
+                from = socket_address::parse(info.host, info.port).value_or(socket_address{});
+                co_return received;
+            }
+
+            virtual task<size_t> sendto(std::span<const char> buffer, const socket_address &to)
+            {
+                return sendto(buffer, to.to_connection_info());
+            }
+
             /// Join a multicast group. Optional; no-op if not supported (e.g. mock).
             virtual void join_group(const multicast_group &group, const multicast_join_options &opts) { (void)group; (void)opts; }
             /// Leave a multicast group.
             virtual void leave_group(const multicast_group &group) { (void)group; }
         };
 
-        std::shared_ptr<tcp_socket_descriptor> make_tcp_socket_descriptor();
-        std::shared_ptr<tcp_listener_descriptor> make_tcp_listener_descriptor();
-        std::shared_ptr<udp_socket_descriptor> make_udp_socket_descriptor(std::optional<ip_version> version = std::nullopt);
+        std::shared_ptr<tcp_socket_descriptor> make_tcp_socket_descriptor(socket_options options = {});
+        std::shared_ptr<tcp_listener_descriptor> make_tcp_listener_descriptor(socket_options options = {});
+        std::shared_ptr<udp_socket_descriptor> make_udp_socket_descriptor(std::optional<ip_version> version = std::nullopt, socket_options options = {});
 
     }
 
@@ -200,6 +383,22 @@ namespace webcraft::async::io::socket
             co_return std::nullopt;
         }
 
+        const std::shared_ptr<detail::tcp_socket_descriptor> &get_descriptor() const noexcept
+        {
+            return descriptor;
+        }
+
+        /// @brief Sets the I/O priority of the reads issued from now on, independently of the socket's writes.
+        void set_priority(io_priority priority) noexcept
+        {
+            descriptor->set_priority(socket_stream_mode::READ, priority);
+        }
+
+        io_priority get_priority() const noexcept
+        {
+            return descriptor->get_priority(socket_stream_mode::READ);
+        }
+
         task<void> close()
         {
             descriptor->shutdown(socket_stream_mode::READ);
@@ -247,6 +446,22 @@ namespace webcraft::async::io::socket
             co_return false;
         }
 
+        const std::shared_ptr<detail::tcp_socket_descriptor> &get_descriptor() const noexcept
+        {
+            return descriptor;
+        }
+
+        /// @brief Sets the I/O priority of the writes issued from now on, independently of the socket's reads.
+        void set_priority(io_priority priority) noexcept
+        {
+            descriptor->set_priority(socket_stream_mode::WRITE, priority);
+        }
+
+        io_priority get_priority() const noexcept
+        {
+            return descriptor->get_priority(socket_stream_mode::WRITE);
+        }
+
         task<void> close()
         {
             descriptor->shutdown(socket_stream_mode::WRITE);
@@ -303,6 +518,22 @@ namespace webcraft::async::io::socket
             co_await descriptor->connect(info);
         }
 
+        /// @brief Connects to an address resolved beforehand, e.g. with socket_address::resolve_all(), without a name
+        /// lookup. Several addresses are raced like the ones of a host name.
+        task<void> connect(const std::vector<socket_address> &addresses)
+        {
+            if (!descriptor)
+                throw std::logic_error("Descriptor is null");
+
+            co_await descriptor->connect(addresses);
+        }
+
+        task<void> connect(const socket_address &address)
+        {
+            std::vector<socket_address> addresses{address};
+            co_await connect(addresses);
+        }
+
         tcp_rstream &get_readable_stream()
         {
             if (!descriptor)
@@ -344,6 +575,15 @@ namespace webcraft::async::io::socket
             }
         }
 
+        /// @brief Sets the I/O priority of both directions, e.g. io_priority::idle() for replication traffic.
+        void set_priority(io_priority priority)
+        {
+            if (!descriptor)
+                throw std::logic_error("Descriptor is null");
+            descriptor->set_priority(socket_stream_mode::READ, priority);
+            descriptor->set_priority(socket_stream_mode::WRITE, priority);
+        }
+
         inline std::string get_remote_host()
         {
             return descriptor->get_remote_host();
@@ -353,6 +593,12 @@ namespace webcraft::async::io::socket
         {
             return descriptor->get_remote_port();
         }
+
+        /// @brief The peer's address as the kernel reported it; unlike get_remote_host() it is not formatted to a string.
+        inline socket_address get_remote_address()
+        {
+            return descriptor->get_remote_address();
+        }
     };
 
     class tcp_listener
@@ -370,11 +616,31 @@ namespace webcraft::async::io::socket
             }
         }
 
+        tcp_listener(tcp_listener &&other) noexcept : descriptor(std::exchange(other.descriptor, nullptr)) {}
+
+        tcp_listener &operator=(tcp_listener &&other) noexcept
+        {
+            if (this != &other)
+            {
+                if (descriptor)
+                {
+                    fire_and_forget(descriptor->close());
+                }
+                descriptor = std::exchange(other.descriptor, nullptr);
+            }
+            return *this;
+        }
+
         void bind(const connection_info &info)
         {
             descriptor->bind(info);
         }
 
+        void bind(const socket_address &address)
+        {
+            descriptor->bind(address);
+        }
+
         void listen(int backlog)
         {
             descriptor->listen(backlog);
@@ -385,6 +651,11 @@ namespace webcraft::async::io::socket
             co_return tcp_socket(co_await descriptor->accept());
         }
 
+        const std::shared_ptr<detail::tcp_listener_descriptor> &get_descriptor() const noexcept
+        {
+            return descriptor;
+        }
+
         task<void> close()
         {
             if (descriptor)
@@ -421,15 +692,32 @@ namespace webcraft::async::io::socket
             descriptor->bind(info);
         }
 
+        void bind(const socket_address &address)
+        {
+            descriptor->bind(address);
+        }
+
         task<size_t> recvfrom(std::span<char> buffer, connection_info &info)
         {
             return descriptor->recvfrom(buffer, info);
         }
 
+        /// @brief Receives a datagram and the address it came from, without formatting the address to a string.
+        task<size_t> recvfrom(std::span<char> buffer, socket_address &from)
+        {
+            return descriptor->recvfrom(buffer, from);
+        }
+
         task<size_t> sendto(std::span<const char> buffer, const connection_info &info)
         {
             return descriptor->sendto(buffer, info);
         }
+
+        /// @brief Sends a datagram to an address resolved beforehand, without a getaddrinfo call per datagram.
+        task<size_t> sendto(std::span<const char> buffer, const socket_address &to)
+        {
+            return descriptor->sendto(buffer, to);
+        }
     };
 
     /// UDP socket that can join multicast groups and send/receive to/from those groups.
@@ -467,6 +755,11 @@ namespace webcraft::async::io::socket
             return descriptor->recvfrom(buffer, info);
         }
 
+        task<size_t> recvfrom(std::span<char> buffer, socket_address &from)
+        {
+            return descriptor->recvfrom(buffer, from);
+        }
+
         /// Send data to a multicast group. group.port must be non-zero.
         /// \throws std::invalid_argument if group.port is 0.
         task<size_t> sendto(std::span<const char> buffer, const multicast_group &group)
@@ -489,23 +782,24 @@ namespace webcraft::async::io::socket
         }
     };
 
-    inline tcp_socket make_tcp_socket()
+    inline tcp_socket make_tcp_socket(socket_options options = {})
     {
-        return tcp_socket(detail::make_tcp_socket_descriptor());
+        return tcp_socket(detail::make_tcp_socket_descriptor(std::move(options)));
     }
 
-    inline tcp_listener make_tcp_listener()
+    /// @brief A listener whose accepted sockets get the same `options` as the listener itself.
+    inline tcp_listener make_tcp_listener(socket_options options = {})
     {
-        return tcp_listener(detail::make_tcp_listener_descriptor());
+        return tcp_listener(detail::make_tcp_listener_descriptor(std::move(options)));
     }
 
-    inline udp_socket make_udp_socket(std::optional<ip_version> version = std::nullopt)
+    inline udp_socket make_udp_socket(std::optional<ip_version> version = std::nullopt, socket_options options = {})
     {
-        return udp_socket(detail::make_udp_socket_descriptor(version));
+        return udp_socket(detail::make_udp_socket_descriptor(version, std::move(options)));
     }
 
-    inline multicast_socket make_multicast_socket(std::optional<ip_version> version = std::nullopt)
+    inline multicast_socket make_multicast_socket(std::optional<ip_version> version = std::nullopt, socket_options options = {})
     {
-        return multicast_socket(detail::make_udp_socket_descriptor(version));
+        return multicast_socket(detail::make_udp_socket_descriptor(version, std::move(options)));
     }
 }
\ No newline at end of file
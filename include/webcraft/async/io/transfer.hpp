@@ -0,0 +1,222 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <vector>
+#include "core.hpp"
+#include "adaptors.hpp"
+#include "fs.hpp"
+#include "open_file_cache.hpp"
+#include "socket.hpp"
+
+namespace webcraft::async::io
+{
+    namespace detail
+    {
+        /// @brief Moves up to `length` bytes from a file to a socket. On Linux the bytes are spliced through a pooled
+        /// pipe with IORING_OP_SPLICE and never enter user space; if either descriptor has no native handle or the
+        /// kernel refuses to splice them, the remainder is copied through a user-space buffer instead.
+        /// `offset` is an absolute file offset that leaves the file position untouched, nullopt reads from the
+        /// current position and advances it.
+        task<size_t> transfer_file_to_socket(fs::detail::file_descriptor &source, socket::detail::tcp_socket_descriptor &destination,
+                                             std::optional<uint64_t> offset, size_t length);
+
+        /// @brief Copies up to `length` bytes from one file to another at explicit offsets, leaving both file positions
+        /// alone. On Linux the bytes are spliced through a pooled pipe; without native handles, or if the kernel refuses,
+        /// they are copied through a user-space buffer instead.
+        /// @return the number of bytes copied, fewer than `length` only if the source ends first
+        task<size_t> transfer_file_range(fs::detail::file_descriptor &source, uint64_t source_offset,
+                                         fs::detail::file_descriptor &destination, uint64_t destination_offset, size_t length);
+
+        // until `from` reaches end of stream, copying where splicing is not possible; shuts nothing down
+        task<void> splice_sockets(socket::detail::tcp_socket_descriptor &from, socket::detail::tcp_socket_descriptor &to, std::atomic<uint64_t> &counter);
+    }
+
+    /// @brief Sends `length` bytes of a file starting at `offset`, or everything up to the end of the file if the file is
+    /// shorter, without copying them through user space where the platform allows it. The file position is not moved.
+    /// Where positional reads are not available (mocks, non-Linux platforms for now) the file is read from its current
+    /// position after skipping `offset` bytes instead.
+    /// @return the number of bytes sent
+    inline task<size_t> transfer(fs::file_rstream &source, socket::tcp_wstream &destination, uint64_t offset, size_t length)
+    {
+        return detail::transfer_file_to_socket(*source.get_descriptor(), *destination.get_descriptor(), offset, length);
+    }
+
+    /// @brief Sends up to `length` bytes from the current position of the file, by default the rest of it.
+    inline task<size_t> transfer(fs::file_rstream &source, socket::tcp_wstream &destination, size_t length = std::numeric_limits<size_t>::max())
+    {
+        return detail::transfer_file_to_socket(*source.get_descriptor(), *destination.get_descriptor(), std::nullopt, length);
+    }
+
+    /// @brief Sends a file kept open by an open_file_cache, see the file_rstream overload. Serving a cached file this way
+    /// takes no open, stat or close. Where positional transfers are not available the shared file position is used,
+    /// so concurrent transfers of one cached file must then be serialised by the caller.
+    inline task<size_t> transfer(const fs::open_file_handle &source, socket::tcp_wstream &destination, uint64_t offset, size_t length)
+    {
+        return detail::transfer_file_to_socket(*source.get_descriptor(), *destination.get_descriptor(), offset, length);
+    }
+
+    // safe to read from other threads while the splice runs
+    struct splice_counters
+    {
+        std::atomic<uint64_t> a_to_b{0};
+        std::atomic<uint64_t> b_to_a{0};
+    };
+
+    struct splice_result
+    {
+        uint64_t a_to_b;
+        uint64_t b_to_a;
+    };
+
+    namespace detail
+    {
+        inline task<void> splice_half(socket::tcp_socket &from, socket::tcp_socket &to, std::atomic<uint64_t> &counter, std::exception_ptr &error)
+        {
+            try
+            {
+                co_await splice_sockets(*from.get_readable_stream().get_descriptor(), *to.get_writable_stream().get_descriptor(), counter);
+                to.shutdown_channel(socket::socket_stream_mode::WRITE); // pass the half-close on
+            }
+            catch (...)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+                // a broken direction tears the whole relay down so the other one stops waiting
+                from.shutdown_channel(socket::socket_stream_mode::READ);
+                to.shutdown_channel(socket::socket_stream_mode::READ);
+                from.shutdown_channel(socket::socket_stream_mode::WRITE);
+                to.shutdown_channel(socket::socket_stream_mode::WRITE);
+            }
+        }
+    }
+
+    // A TCP proxy between two connected sockets: runs until both directions reach end of stream, passing each
+    // half-close on, and leaves the sockets open. Throws once both directions have stopped if either one failed.
+    // An idle direction waits on a poll; only a direction whose receiver is not keeping up holds an io-wq worker.
+    inline task<splice_result> bidirectional_splice(socket::tcp_socket &a, socket::tcp_socket &b, splice_counters &counters)
+    {
+        std::exception_ptr error;
+
+        // tasks start eagerly, so both directions run concurrently
+        auto forward = detail::splice_half(a, b, counters.a_to_b, error);
+        auto backward = detail::splice_half(b, a, counters.b_to_a, error);
+        co_await forward;
+        co_await backward;
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        co_return splice_result{counters.a_to_b.load(), counters.b_to_a.load()};
+    }
+
+    inline task<splice_result> bidirectional_splice(socket::tcp_socket &a, socket::tcp_socket &b)
+    {
+        splice_counters counters;
+        splice_result result = co_await bidirectional_splice(a, b, counters);
+        co_return result;
+    }
+}
+
+namespace webcraft::async::io::adaptors
+{
+    namespace detail
+    {
+        template <typename RStream>
+        task<size_t> copy_to_socket(RStream &source, socket::tcp_wstream &destination)
+        {
+            size_t total = 0;
+            if constexpr (async_buffered_readable_stream<RStream, char>)
+            {
+                std::vector<char> buffer(64 * 1024);
+                while (true)
+                {
+                    size_t received = co_await source.recv(std::span<char>(buffer));
+                    if (received == 0)
+                    {
+                        break;
+                    }
+
+                    std::span<const char> remaining(buffer.data(), received);
+                    while (!remaining.empty())
+                    {
+                        size_t sent = co_await destination.send(remaining);
+                        if (sent == 0)
+                        {
+                            co_return total; // the peer stopped accepting data
+                        }
+                        total += sent;
+                        remaining = remaining.subspan(sent);
+                    }
+                }
+            }
+            else
+            {
+                while (true)
+                {
+                    auto value = co_await source.recv();
+                    if (!value.has_value())
+                    {
+                        break;
+                    }
+                    bool sent = co_await destination.send(*value);
+                    if (!sent)
+                    {
+                        break;
+                    }
+                    total++;
+                }
+            }
+            co_return total;
+        }
+
+        // RStream is a reference for a borrowed lvalue stream, otherwise the stream is moved into this frame
+        template <typename RStream>
+        task<size_t> forward_to_socket(RStream source, socket::tcp_wstream &destination)
+        {
+            if constexpr (std::same_as<std::remove_cvref_t<RStream>, fs::file_rstream>)
+            {
+                co_return co_await io::transfer(source, destination);
+            }
+            else
+            {
+                co_return co_await copy_to_socket(source, destination);
+            }
+        }
+
+        class socket_forward_adaptor : public async_readable_stream_adaptor<socket_forward_adaptor, char>
+        {
+        private:
+            socket::tcp_wstream *destination;
+
+        public:
+            explicit socket_forward_adaptor(socket::tcp_wstream &destination) : destination(&destination) {}
+
+            template <typename RStream>
+                requires async_readable_stream<std::remove_cvref_t<RStream>, char>
+            task<size_t> operator()(RStream &&stream) const
+            {
+                return forward_to_socket<RStream>(std::forward<RStream>(stream), *destination);
+            }
+        };
+    }
+
+    /// @brief Sends a char stream to a TCP socket and resolves to the number of bytes sent. A file_rstream is
+    /// handed to io::transfer() so that the bytes go straight from the page cache to the socket; other streams
+    /// are copied a buffer at a time.
+    inline auto forward_to(socket::tcp_wstream &stream)
+    {
+        return detail::socket_forward_adaptor(stream);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+
+namespace webcraft::async
+{
+    /// @brief I/O scheduling classes, numbered as ioprio_set(2) numbers them.
+    enum class io_priority_class : uint8_t
+    {
+        none = 0,        // no class of its own: the runtime treats it as best_effort, the kernel uses the thread's priority
+        realtime = 1,    // served first; the kernel only accepts it from processes with CAP_SYS_ADMIN or CAP_SYS_NICE
+        best_effort = 2, // ordered by level
+        idle = 3         // background work, only served when nothing else is waiting
+    };
+
+    /// @brief The priority of a stream's I/O: a class and, for realtime and best_effort, a level from 0 (highest) to 7.
+    ///
+    /// On Linux the runtime submits realtime operations before anything else and holds idle ones back while too many
+    /// are in flight, leaving ring slots to the rest. File reads and writes also carry the priority in their SQE, so
+    /// block layer schedulers that honour ioprio (BFQ, mq-deadline) order them on the device. Other platforms ignore it.
+    struct io_priority
+    {
+        io_priority_class io_class = io_priority_class::none;
+        uint8_t level = 4;
+
+        static constexpr io_priority realtime(uint8_t level = 4) noexcept { return {io_priority_class::realtime, level}; }
+        static constexpr io_priority best_effort(uint8_t level = 4) noexcept { return {io_priority_class::best_effort, level}; }
+        static constexpr io_priority idle() noexcept { return {io_priority_class::idle, 0}; }
+
+        /// @brief The value of the ioprio field of an SQE, IOPRIO_PRIO_VALUE(class, level).
+        constexpr uint16_t native() const noexcept
+        {
+            if (io_class == io_priority_class::none)
+            {
+                return 0;
+            }
+            return static_cast<uint16_t>((static_cast<uint16_t>(io_class) << 13) | (level & 7));
+        }
+
+        bool operator==(const io_priority &) const = default;
+    };
+}
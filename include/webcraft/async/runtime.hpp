@@ -15,6 +15,7 @@
 #include <webcraft/async/task.hpp>
 #include <webcraft/async/sync_wait.hpp>
 #include <webcraft/async/fire_and_forget_task.hpp>
+#include <webcraft/async/io_priority.hpp>
 
 #ifdef __linux__
 #include <liburing.h>
@@ -175,6 +176,8 @@ namespace webcraft::async
 #ifdef __linux__
         using io_uring_operation = std::function<void(struct io_uring_sqe *)>;
         void submit_runtime_operation(io_uring_operation op);
+        // queues `op` by the class of `priority`: realtime ahead of everything, idle behind the background limit
+        void submit_runtime_operation(io_uring_operation op, io_priority priority);
 #elif defined(__APPLE__)
         int16_t get_kqueue_filter();
         uint32_t get_kqueue_flags();
@@ -205,6 +208,12 @@ namespace webcraft::async
     /// @return the stop token associated with the async runtime.
     std::stop_token get_stop_token();
 
+    /// @brief Caps how many operations of the idle I/O class the runtime keeps in flight at once (16 by default, 0 for
+    /// no cap). Further idle operations wait in the runtime until earlier ones complete, so background work cannot fill
+    /// the kernel's queues ahead of foreground requests. Receives, accepts and connects, which complete only when a
+    /// peer acts, are not counted. Only has an effect on Linux.
+    void set_background_io_limit(size_t limit) noexcept;
+
     /// @brief Yields control back to the async runtime, allowing other tasks to run.
     /// @return A task that completes when the yield operation is done.
     inline task<void> yield()
@@ -9,7 +9,9 @@
 
 #include <webcraft/async/runtime.hpp>
 #include <liburing.h>
+#include <atomic>
 #include <exception>
+#include <memory>
 
 namespace webcraft::async::detail::linux
 {
@@ -29,13 +31,37 @@ namespace webcraft::async::detail::linux
 
     struct io_uring_runtime_event : public webcraft::async::detail::runtime_event
     {
-        io_uring_runtime_event(std::stop_token token)
-            : webcraft::async::detail::runtime_event(token)
+    private:
+        io_priority priority;
+        // cleared once the event gives up, so an idle operation still waiting in the runtime is never prepared
+        std::shared_ptr<std::atomic<bool>> waiting;
+
+    public:
+        io_uring_runtime_event(std::stop_token token, io_priority priority = {})
+            : webcraft::async::detail::runtime_event(token), priority(priority)
+        {
+        }
+
+        ~io_uring_runtime_event()
         {
+            if (waiting)
+            {
+                waiting->store(false, std::memory_order_release);
+            }
+        }
+
+        io_priority get_priority() const noexcept
+        {
+            return priority;
         }
 
         void try_native_cancel() override
         {
+            if (waiting)
+            {
+                waiting->store(false, std::memory_order_release);
+            }
+
             auto userdata = get_user_data();
 
             auto func = [userdata](struct io_uring_sqe *sqe)
@@ -47,6 +73,27 @@ namespace webcraft::async::detail::linux
 
         void try_start() override
         {
+            if (priority.io_class == io_priority_class::idle)
+            {
+                // idle operations can wait in the runtime for a long time, long enough to be cancelled and destroyed
+                waiting = std::make_shared<std::atomic<bool>>(true);
+                auto func = [this, waiting = waiting](struct io_uring_sqe *sqe)
+                {
+                    if (!waiting->load(std::memory_order_acquire))
+                    {
+                        ::io_uring_prep_nop(sqe);
+                        ::io_uring_sqe_set_data64(sqe, 0);
+                        return;
+                    }
+
+                    perform_io_uring_operation(sqe);
+
+                    ::io_uring_sqe_set_data64(sqe, get_user_data());
+                };
+
+                webcraft::async::detail::submit_runtime_operation(func, priority);
+                return;
+            }
 
             auto func = [this](struct io_uring_sqe *sqe)
             {
@@ -55,7 +102,7 @@ namespace webcraft::async::detail::linux
                 ::io_uring_sqe_set_data64(sqe, get_user_data());
             };
 
-            webcraft::async::detail::submit_runtime_operation(func);
+            webcraft::async::detail::submit_runtime_operation(func, priority);
         }
 
         uint64_t get_user_data() const
@@ -66,12 +113,12 @@ namespace webcraft::async::detail::linux
         virtual void perform_io_uring_operation(struct io_uring_sqe *sqe) = 0;
     };
 
-    inline auto create_io_uring_event(webcraft::async::detail::io_uring_operation op, std::stop_token token = get_stop_token())
+    inline auto create_io_uring_event(webcraft::async::detail::io_uring_operation op, std::stop_token token = get_stop_token(), io_priority priority = {})
     {
         struct io_uring_runtime_event_impl : public io_uring_runtime_event
         {
-            io_uring_runtime_event_impl(webcraft::async::detail::io_uring_operation op, std::stop_token token)
-                : io_uring_runtime_event(token), operation(std::move(op))
+            io_uring_runtime_event_impl(webcraft::async::detail::io_uring_operation op, std::stop_token token, io_priority priority)
+                : io_uring_runtime_event(token, priority), operation(std::move(op))
             {
             }
 
@@ -84,7 +131,73 @@ namespace webcraft::async::detail::linux
             io_uring_operation operation;
         };
 
-        return std::make_unique<io_uring_runtime_event_impl>(std::move(op), token);
+        return std::make_unique<io_uring_runtime_event_impl>(std::move(op), token, priority);
     }
+
+    // Two operations in adjacent SQEs of one submission, the second hard-linked behind the first so it runs whether or
+    // not the first succeeds. The event completes with the second; the first's completion only records its result, and
+    // always arrives first. Like create_io_uring_event, the operations set their own sqe->ioprio where it applies.
+    class io_uring_linked_pair_event : public io_uring_runtime_event
+    {
+    private:
+        struct first_completion : webcraft::async::detail::runtime_callback
+        {
+            int result{0};
+
+            void try_execute(int result, bool cancelled = false) override
+            {
+                this->result = result;
+            }
+        };
+
+        webcraft::async::detail::io_uring_operation first_op;
+        webcraft::async::detail::io_uring_operation second_op;
+        first_completion first;
+
+    public:
+        // never cancelled: the first completion points into this object, so it has to outlive both operations
+        io_uring_linked_pair_event(webcraft::async::detail::io_uring_operation first_op, webcraft::async::detail::io_uring_operation second_op, io_priority priority = {})
+            : io_uring_runtime_event(std::stop_token{}, priority), first_op(std::move(first_op)), second_op(std::move(second_op))
+        {
+        }
+
+        int first_result() const noexcept
+        {
+            return first.result;
+        }
+
+        void try_start() override
+        {
+            webcraft::async::detail::submit_runtime_operation([this](struct io_uring_sqe *sqe)
+                                                              { prepare(sqe); }, get_priority());
+        }
+
+        // the runtime leaves room for both SQEs before handing out the first; should the ring be full anyway, the first
+        // becomes a no-op and the pair goes back in the queue, since a link cannot span submissions
+        void prepare(struct io_uring_sqe *sqe)
+        {
+            auto *ring = reinterpret_cast<struct io_uring *>(webcraft::async::detail::get_native_handle());
+            if (::io_uring_sq_space_left(ring) == 0)
+            {
+                ::io_uring_prep_nop(sqe);
+                ::io_uring_sqe_set_data64(sqe, 0);
+                try_start();
+                return;
+            }
+
+            first_op(sqe);
+            sqe->flags |= IOSQE_IO_HARDLINK;
+            ::io_uring_sqe_set_data64(sqe, reinterpret_cast<uint64_t>(static_cast<webcraft::async::detail::runtime_callback *>(&first)));
+
+            struct io_uring_sqe *second = ::io_uring_get_sqe(ring);
+            second_op(second);
+            ::io_uring_sqe_set_data64(second, get_user_data());
+        }
+
+        void perform_io_uring_operation(struct io_uring_sqe *sqe) override
+        {
+            // both SQEs are prepared in try_start()
+        }
+    };
 }
 #endif
\ No newline at end of file
@@ -17,6 +17,9 @@
 #include <future>
 #include <functional>
 #include <type_traits>
+#include <coroutine>
+#include <optional>
+#include <exception>
 
 using namespace std::chrono_literals;
 
@@ -156,6 +159,74 @@ namespace webcraft::async
             return result;
         }
 
+        // resumes on the worker that ran f, so co_await yield() afterwards to get back to the runtime thread
+        template <typename F>
+        auto async_submit(F &&f)
+        {
+            using return_type = typename std::invoke_result_t<F>;
+
+            struct awaitable
+            {
+                thread_pool &pool;
+                std::decay_t<F> fn;
+                std::conditional_t<std::is_void_v<return_type>, bool, std::optional<return_type>> result{};
+                std::exception_ptr exception;
+
+                constexpr bool await_ready() const noexcept { return false; }
+
+                bool await_suspend(std::coroutine_handle<> h)
+                {
+                    auto future = pool.submit([this, h]
+                                              {
+                        try
+                        {
+                            if constexpr (std::is_void_v<return_type>)
+                            {
+                                fn();
+                            }
+                            else
+                            {
+                                result.emplace(fn());
+                            }
+                        }
+                        catch (...)
+                        {
+                            exception = std::current_exception();
+                        }
+                        h.resume(); });
+
+                    // a pool that is shutting down never runs the job, so it has already failed the future
+                    if (future.wait_for(0s) == std::future_status::ready)
+                    {
+                        try
+                        {
+                            future.get();
+                        }
+                        catch (...)
+                        {
+                            exception = std::current_exception();
+                            return false;
+                        }
+                    }
+                    return true;
+                }
+
+                return_type await_resume()
+                {
+                    if (exception)
+                    {
+                        std::rethrow_exception(exception);
+                    }
+                    if constexpr (!std::is_void_v<return_type>)
+                    {
+                        return std::move(*result);
+                    }
+                }
+            };
+
+            return awaitable{*this, std::forward<F>(f)};
+        }
+
     public:
         const size_t get_min_threads() const
         {
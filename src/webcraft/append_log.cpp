@@ -0,0 +1,489 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/append_log.hpp>
+#include <webcraft/async/io/checksum.hpp>
+#include <webcraft/async/io/direct_io.hpp>
+#include <webcraft/async/task_completion_source.hpp>
+#include <webcraft/async/fire_and_forget_task.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+using namespace webcraft::async;
+using namespace webcraft::async::io;
+using namespace webcraft::async::io::fs;
+
+namespace
+{
+    constexpr size_t header_size = 8;
+
+    // a header with this length marks padding; its checksum field holds the number of padding bytes that follow
+    constexpr uint32_t padding_marker = 0xFFFFFFFFu;
+
+    // zero-padded so that the names sort in segment order
+    constexpr size_t segment_name_digits = 20;
+    constexpr std::string_view segment_extension = ".log";
+
+    // shared by an append and the writer; the append clears `done` if it is destroyed first, so it is never completed
+    struct append_waiter
+    {
+        task_completion_source<log_position> *done;
+    };
+
+    struct pending_append
+    {
+        std::span<const char> record;
+        std::shared_ptr<append_waiter> waiter;
+        log_position position{};
+    };
+
+    void write_u32(char *p, uint32_t value) noexcept
+    {
+        if constexpr (std::endian::native == std::endian::big)
+        {
+            value = std::byteswap(value);
+        }
+        std::memcpy(p, &value, sizeof(value));
+    }
+
+    uint32_t read_u32(const char *p) noexcept
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        if constexpr (std::endian::native == std::endian::big)
+        {
+            value = std::byteswap(value);
+        }
+        return value;
+    }
+
+    // covers the length as well so that a torn header cannot pass for a shorter record
+    uint32_t record_checksum(std::span<const char> record) noexcept
+    {
+        char length[4];
+        write_u32(length, static_cast<uint32_t>(record.size()));
+        crc32c checksum;
+        checksum.update(std::as_bytes(std::span<const char>(length)));
+        checksum.update(std::as_bytes(record));
+        return checksum.digest();
+    }
+
+    std::string segment_name(uint64_t index)
+    {
+        std::string name = std::to_string(index);
+        name.insert(0, segment_name_digits - name.size(), '0');
+        return name + std::string(segment_extension);
+    }
+
+    std::optional<uint64_t> parse_segment_name(const std::filesystem::path &p)
+    {
+        std::string name = p.filename().string();
+        if (name.size() != segment_name_digits + segment_extension.size() || !name.ends_with(segment_extension))
+        {
+            return std::nullopt;
+        }
+
+        uint64_t index = 0;
+        for (size_t i = 0; i < segment_name_digits; i++)
+        {
+            if (name[i] < '0' || name[i] > '9')
+            {
+                return std::nullopt;
+            }
+            index = index * 10 + static_cast<uint64_t>(name[i] - '0');
+        }
+        return index;
+    }
+
+    std::vector<std::pair<uint64_t, std::filesystem::path>> list_segments(const std::filesystem::path &directory)
+    {
+        std::vector<std::pair<uint64_t, std::filesystem::path>> segments;
+        if (!std::filesystem::is_directory(directory))
+        {
+            return segments;
+        }
+
+        for (const auto &entry : std::filesystem::directory_iterator(directory))
+        {
+            if (auto index = parse_segment_name(entry.path()); index && entry.is_regular_file())
+            {
+                segments.emplace_back(*index, entry.path());
+            }
+        }
+        std::sort(segments.begin(), segments.end());
+        return segments;
+    }
+
+    uint64_t round_up(uint64_t value, uint64_t multiple) noexcept
+    {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+}
+
+struct webcraft::async::io::fs::detail::append_log_state
+{
+    std::filesystem::path directory;
+    append_log_options options;
+
+    std::mutex mutex;
+    std::deque<pending_append> queue;
+    bool writer_running{false};
+    bool closing{false};
+    task_completion_source<void> *idle_waiter{nullptr};
+
+    // only touched by the writer, or by open() and close() while there is none
+    std::optional<random_access_file> segment;
+    uint64_t segment_index{0};
+    uint64_t segment_offset{0};
+    size_t block_size{1};
+    std::optional<aligned_buffer_pool> buffers;
+};
+
+namespace
+{
+    using webcraft::async::io::fs::detail::append_log_state;
+
+    // makes the new segment's directory entry durable where the platform lets a directory be opened and synced
+    task<void> sync_directory(const std::filesystem::path &directory)
+    {
+        std::optional<random_access_file> opened;
+        try
+        {
+            opened.emplace(co_await make_file(directory).open_random_access());
+        }
+        catch (const std::exception &)
+        {
+            co_return;
+        }
+
+        try
+        {
+            co_await opened->sync();
+        }
+        catch (const std::exception &)
+        {
+        }
+        co_await opened->close();
+    }
+
+    task<void> open_next_segment(append_log_state &state)
+    {
+        if (state.segment)
+        {
+            co_await state.segment->close();
+            state.segment.reset();
+        }
+
+        uint64_t index = state.segment_index + 1;
+        auto opened = co_await make_file(state.directory / segment_name(index)).open_random_access(true, open_options{.direct = state.options.direct});
+
+        if (!state.buffers)
+        {
+            // the first segment tells us what direct I/O needs from every write
+            direct_io_alignment alignment = opened.alignment();
+            size_t block = std::bit_ceil(std::max({state.options.block_size, alignment.offset, size_t{1}}));
+            state.block_size = block;
+            state.options.segment_size = round_up(std::max<uint64_t>(state.options.segment_size, block), block);
+            state.buffers.emplace(direct_io_alignment{alignment.memory, block}, std::max(state.options.max_batch_bytes, block), 1);
+        }
+
+        co_await opened.allocate(0, state.options.segment_size);
+        co_await opened.sync(); // the preallocated size, so later data syncs have no metadata left to flush
+        co_await sync_directory(state.directory);
+
+        state.segment.emplace(std::move(opened));
+        state.segment_index = index;
+        state.segment_offset = 0;
+    }
+
+    task<void> write_batch(append_log_state &state, std::vector<pending_append> &batch, size_t bytes)
+    {
+        uint64_t room = state.options.segment_size - state.segment_offset;
+        uint64_t size = round_up(bytes, state.block_size);
+        if (size - bytes > 0 && size - bytes < header_size)
+        {
+            size += state.block_size; // too little room for a padding header, pad a whole block more instead
+        }
+        size = std::min(size, room); // replay stops by itself when less than a header is left in the segment
+
+        aligned_buffer buffer = size <= state.buffers->buffer_size()
+                                    ? state.buffers->acquire()
+                                    : aligned_buffer(size, state.buffers->alignment().memory);
+        char *out = buffer.data();
+        std::memset(out, 0, size);
+
+        size_t at = 0;
+        for (auto &entry : batch)
+        {
+            write_u32(out + at, static_cast<uint32_t>(entry.record.size()));
+            write_u32(out + at + 4, record_checksum(entry.record));
+            std::memcpy(out + at + header_size, entry.record.data(), entry.record.size());
+            entry.position = {state.segment_index, state.segment_offset + at};
+            at += header_size + entry.record.size();
+        }
+
+        if (size - bytes >= header_size)
+        {
+            write_u32(out + at, padding_marker);
+            write_u32(out + at + 4, static_cast<uint32_t>(size - bytes - header_size));
+        }
+
+        size_t written = co_await state.segment->write_at_and_sync(state.segment_offset, std::span<const char>(out, size), state.options.data_sync);
+        if (written != size)
+        {
+            throw std::system_error(std::make_error_code(std::errc::io_error), "Short write to the append log");
+        }
+        state.segment_offset += size;
+    }
+
+    task<void> run_writer(std::shared_ptr<append_log_state> state)
+    {
+        while (true)
+        {
+            std::vector<pending_append> batch;
+            size_t bytes = 0;
+            bool finished = false;
+            task_completion_source<void> *idle = nullptr;
+            {
+                std::lock_guard lock(state->mutex);
+                if (state->queue.empty())
+                {
+                    state->writer_running = false;
+                    finished = true;
+                    idle = std::exchange(state->idle_waiter, nullptr);
+                }
+                else
+                {
+                    uint64_t room = state->segment ? state->options.segment_size - state->segment_offset : 0;
+                    while (!state->queue.empty())
+                    {
+                        size_t framed = header_size + state->queue.front().record.size();
+                        if (bytes + framed > room || (!batch.empty() && bytes + framed > state->options.max_batch_bytes))
+                        {
+                            break;
+                        }
+                        batch.push_back(state->queue.front());
+                        state->queue.pop_front();
+                        bytes += framed;
+                    }
+                }
+            }
+
+            if (finished)
+            {
+                if (idle)
+                {
+                    idle->set_value();
+                }
+                co_return;
+            }
+
+            std::exception_ptr error;
+            try
+            {
+                if (batch.empty())
+                {
+                    co_await open_next_segment(*state); // the next record does not fit into what is left of this one
+                }
+                else
+                {
+                    co_await write_batch(*state, batch, bytes);
+                }
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            if (error && batch.empty())
+            {
+                // without a segment nothing queued can be written, fail it all and let the next append try again
+                std::lock_guard lock(state->mutex);
+                batch.assign(state->queue.begin(), state->queue.end());
+                state->queue.clear();
+            }
+
+            // completing resumes the appenders right here, so the lock must not be held
+            for (auto &entry : batch)
+            {
+                task_completion_source<log_position> *done;
+                {
+                    std::lock_guard lock(state->mutex);
+                    done = std::exchange(entry.waiter->done, nullptr);
+                }
+
+                if (!done)
+                {
+                    continue; // the append was destroyed while it waited
+                }
+                if (error)
+                {
+                    done->set_exception(error);
+                }
+                else
+                {
+                    done->set_value(entry.position);
+                }
+            }
+        }
+    }
+}
+
+task<append_log> append_log::open(std::filesystem::path directory, append_log_options options)
+{
+    if (options.max_batch_bytes == 0 || options.block_size == 0)
+    {
+        throw std::invalid_argument("The append log needs a non-zero batch and block size");
+    }
+
+    std::filesystem::create_directories(directory);
+    auto state = std::make_shared<detail::append_log_state>();
+    state->directory = directory;
+    state->options = options;
+
+    auto segments = list_segments(directory);
+    state->segment_index = segments.empty() ? 0 : segments.back().first;
+    co_await open_next_segment(*state);
+    co_return append_log(std::move(state));
+}
+
+namespace
+{
+    // an append destroyed before the writer got to it leaves the queue, one destroyed mid-batch is skipped on completion
+    struct queued_append
+    {
+        std::shared_ptr<append_log_state> state;
+        std::shared_ptr<append_waiter> waiter;
+
+        queued_append(std::shared_ptr<append_log_state> state, std::shared_ptr<append_waiter> waiter) : state(std::move(state)), waiter(std::move(waiter)) {}
+        queued_append(const queued_append &) = delete;
+        queued_append &operator=(const queued_append &) = delete;
+
+        ~queued_append()
+        {
+            std::lock_guard lock(state->mutex);
+            if (std::exchange(waiter->done, nullptr))
+            {
+                std::erase_if(state->queue, [this](const pending_append &entry)
+                              { return entry.waiter == waiter; });
+            }
+        }
+    };
+}
+
+task<log_position> append_log::append(std::span<const char> record)
+{
+    if (record.size() >= padding_marker || header_size + record.size() > state->options.segment_size)
+    {
+        throw std::invalid_argument("A record must fit into one append log segment");
+    }
+
+    task_completion_source<log_position> done;
+    auto completion = done.task(); // waiting on the source before the writer can see it
+    queued_append queued{state, std::make_shared<append_waiter>(&done)};
+    bool start_writer = false;
+    {
+        std::lock_guard lock(state->mutex);
+        if (state->closing)
+        {
+            throw std::logic_error("The append log is closed");
+        }
+        state->queue.push_back({record, queued.waiter});
+        start_writer = !std::exchange(state->writer_running, true);
+    }
+
+    if (start_writer)
+    {
+        fire_and_forget(run_writer(state));
+    }
+
+    log_position position = co_await completion;
+    co_return position;
+}
+
+task<void> append_log::close()
+{
+    if (!state)
+    {
+        co_return;
+    }
+
+    task_completion_source<void> idle;
+    std::optional<task<void>> drained;
+    {
+        std::lock_guard lock(state->mutex);
+        state->closing = true;
+        if (state->writer_running)
+        {
+            drained.emplace(idle.task());
+            state->idle_waiter = &idle;
+        }
+    }
+
+    if (drained)
+    {
+        auto pending = std::move(*drained);
+        co_await pending;
+    }
+
+    if (state->segment)
+    {
+        co_await state->segment->close();
+        state->segment.reset();
+    }
+}
+
+async_generator<std::vector<char>> append_log::replay(std::filesystem::path directory)
+{
+    for (const auto &[index, path] : list_segments(directory))
+    {
+        auto mapped = co_await make_file(path).open_mapped({.pattern = access_pattern::sequential});
+        std::span<const char> data = mapped.contents();
+
+        size_t at = 0;
+        while (data.size() - at >= header_size)
+        {
+            uint32_t length = read_u32(data.data() + at);
+            uint32_t checksum = read_u32(data.data() + at + 4);
+            if (length == 0 && checksum == 0)
+            {
+                break; // preallocated space nobody has written to yet
+            }
+
+            if (length == padding_marker)
+            {
+                if (checksum > data.size() - at - header_size)
+                {
+                    break;
+                }
+                at += header_size + checksum;
+                continue;
+            }
+
+            if (length > data.size() - at - header_size)
+            {
+                break;
+            }
+            auto record = data.subspan(at + header_size, length);
+            if (record_checksum(record) != checksum)
+            {
+                break; // torn by a crash; whatever follows was written by a later open() into the next segment
+            }
+
+            co_yield std::vector<char>(record.begin(), record.end());
+            at += header_size + length;
+        }
+
+        co_await mapped.close();
+    }
+}
@@ -0,0 +1,269 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/fs.hpp>
+#include <webcraft/async/io/transfer.hpp>
+#include <webcraft/async/runtime.hpp>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+#include "fs_pool_decl.hpp"
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+using namespace webcraft::async;
+using namespace webcraft::async::io::fs;
+
+namespace
+{
+    using webcraft::async::io::fs::detail::file_descriptor;
+
+    struct copy_job
+    {
+        std::shared_ptr<file_descriptor> source;
+        std::shared_ptr<file_descriptor> destination;
+        uint64_t size{0};
+        uint64_t range_size{0};
+
+        std::atomic<uint64_t> next{0};
+        std::atomic<uint64_t> copied{0};
+        std::atomic<uint64_t> end{0};          // lowered when the source turns out to be shorter than it was
+        std::atomic<bool> kernel_copy{true};   // cleared for every range once copy_file_range() is refused
+        std::atomic<bool> failed{false};
+
+        std::mutex mutex;
+        std::exception_ptr error;
+        std::function<void(uint64_t, uint64_t)> progress;
+        uint64_t reported{0};
+
+        void fail(std::exception_ptr e)
+        {
+            std::lock_guard lock(mutex);
+            if (!error)
+            {
+                error = std::move(e);
+            }
+            failed.store(true, std::memory_order_relaxed);
+        }
+
+        void shorten(uint64_t at) noexcept
+        {
+            uint64_t current = end.load(std::memory_order_relaxed);
+            while (at < current && !end.compare_exchange_weak(current, at, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        void report()
+        {
+            if (!progress)
+            {
+                return;
+            }
+
+            // the lock orders the calls, and reading the counter under it keeps what they see increasing
+            std::lock_guard lock(mutex);
+            uint64_t now = copied.load(std::memory_order_relaxed);
+            if (now > reported)
+            {
+                reported = now;
+                progress(now, size);
+            }
+        }
+    };
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+    // errors that mean this pair of files cannot be copied in the kernel at all, rather than that the copy failed
+    bool copy_refused(int error) noexcept
+    {
+        return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP || error == EBADF;
+    }
+
+    // copies as much of the range as copy_file_range() will, which on Linux 5.19+ also works across file systems of
+    // the same type; stops short, and turns kernel copies off for the job, where it is refused
+    task<size_t> copy_in_kernel(copy_job &job, uint64_t offset, size_t length)
+    {
+        int in = job.source->native_handle();
+        int out = job.destination->native_handle();
+        if (in < 0 || out < 0)
+        {
+            job.kernel_copy.store(false, std::memory_order_relaxed);
+            co_return 0;
+        }
+
+        // copy_file_range() has no io_uring opcode, so it blocks a thread of the shared pool
+        auto call = webcraft::async::io::fs::detail::blocking_pool().async_submit([in, out, offset, length]() -> std::pair<size_t, int>
+                                      {
+            size_t total = 0;
+            while (total < length)
+            {
+                loff_t in_offset = static_cast<loff_t>(offset + total);
+                loff_t out_offset = in_offset;
+                ssize_t copied = ::copy_file_range(in, &in_offset, out, &out_offset, length - total, 0);
+                if (copied < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return {total, errno};
+                }
+                if (copied == 0)
+                {
+                    break; // the end of the file, or a file system that reports nothing to copy (procfs, sysfs)
+                }
+                total += static_cast<size_t>(copied);
+            }
+            return {total, 0}; });
+        std::pair<size_t, int> outcome = co_await call;
+        co_await yield(); // async_submit() resumes on the worker that ran the call
+
+        auto [total, error] = outcome;
+        if (error != 0 && !copy_refused(error))
+        {
+            throw std::system_error(error, std::system_category(), "Failed to copy file range");
+        }
+        if (error != 0 || total == 0)
+        {
+            // a zero return is only an end of file if the other paths agree, which they find out for themselves
+            job.kernel_copy.store(false, std::memory_order_relaxed);
+        }
+        co_return total;
+    }
+#else
+    task<size_t> copy_in_kernel(copy_job &job, uint64_t, size_t)
+    {
+        job.kernel_copy.store(false, std::memory_order_relaxed);
+        co_return 0;
+    }
+#endif
+
+    // one worker: takes the next range until there are none left or another worker failed
+    task<void> copy_ranges(std::shared_ptr<copy_job> job)
+    {
+        try
+        {
+            while (!job->failed.load(std::memory_order_relaxed))
+            {
+                uint64_t offset = job->next.fetch_add(job->range_size, std::memory_order_relaxed);
+                if (offset >= job->end.load(std::memory_order_relaxed))
+                {
+                    break;
+                }
+                size_t length = static_cast<size_t>(std::min(job->range_size, job->size - offset));
+
+                size_t done = 0;
+                if (job->kernel_copy.load(std::memory_order_relaxed))
+                {
+                    done = co_await copy_in_kernel(*job, offset, length);
+                }
+                if (done < length)
+                {
+                    size_t copied = co_await webcraft::async::io::detail::transfer_file_range(*job->source, offset + done, *job->destination, offset + done, length - done);
+                    done += copied;
+                }
+                if (done < length)
+                {
+                    job->shorten(offset + done);
+                }
+
+                job->copied.fetch_add(done, std::memory_order_relaxed);
+                job->report();
+            }
+        }
+        catch (...)
+        {
+            job->fail(std::current_exception());
+        }
+    }
+}
+
+task<uint64_t> webcraft::async::io::fs::copy(std::filesystem::path from, std::filesystem::path to, copy_options options)
+{
+    auto job = std::make_shared<copy_job>();
+    job->range_size = std::max<uint64_t>(options.range_size, 1);
+    job->progress = std::move(options.progress);
+
+    job->source = co_await detail::make_file_descriptor(from, std::ios::in);
+
+    std::exception_ptr error;
+    try
+    {
+        file_status status = co_await detail::stat_descriptor(job->source, from);
+        if (status.type == std::filesystem::file_type::directory)
+        {
+            throw std::filesystem::filesystem_error("Failed to copy file", from, std::make_error_code(std::errc::is_a_directory));
+        }
+        job->size = status.size;
+        job->end.store(job->size, std::memory_order_relaxed);
+
+        // opened read-write, the one mode that does not truncate on every platform, and cut to size afterwards, so
+        // that copying a file onto itself leaves it as it was
+        job->destination = co_await detail::make_file_descriptor(to, std::ios::in | std::ios::out);
+        co_await job->destination->truncate(job->size);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    if (!error)
+    {
+        uint64_t ranges = (job->size + job->range_size - 1) / job->range_size;
+        size_t workers = static_cast<size_t>(std::min<uint64_t>(std::max<size_t>(options.parallelism, 1), ranges));
+
+        // every worker is started before any is awaited, so that their reads and writes overlap
+        std::vector<task<void>> running;
+        running.reserve(workers);
+        for (size_t i = 0; i < workers; i++)
+        {
+            running.push_back(copy_ranges(job));
+        }
+        for (auto &worker : running)
+        {
+            co_await worker;
+        }
+        error = job->error;
+    }
+
+    if (!error)
+    {
+        try
+        {
+            uint64_t end = job->end.load(std::memory_order_relaxed);
+            if (end < job->size)
+            {
+                co_await job->destination->truncate(end); // the source shrank while it was being copied
+            }
+            if (options.sync)
+            {
+                co_await job->destination->sync(false);
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+
+    if (job->destination)
+    {
+        co_await job->destination->close();
+    }
+    co_await job->source->close();
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    co_return job->copied.load(std::memory_order_relaxed);
+}
@@ -20,6 +20,9 @@ using namespace webcraft::async::io::fs::detail;
 
 #if defined(WEBCRAFT_MOCK_FS_TESTS)
 
+#include <sys/stat.h>
+#include <unistd.h>
+
 class sync_file_descriptor : public file_descriptor
 {
 private:
@@ -28,7 +31,16 @@ private:
 public:
     sync_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode) : file_descriptor(mode)
     {
-        if (mode & std::ios::in)
+        if ((mode & std::ios::in) && (mode & std::ios::out))
+        {
+            // read-write without truncating, creating the file if needed
+            file = std::fopen(p.c_str(), "r+");
+            if (!file)
+            {
+                file = std::fopen(p.c_str(), "w+");
+            }
+        }
+        else if (mode & std::ios::in)
         {
             file = std::fopen(p.c_str(), "r");
         }
@@ -65,6 +77,61 @@ public:
         co_return std::fwrite(buffer.data(), sizeof(char), buffer.size(), file);
     }
 
+    // the mock has no positional I/O, so it seeks there and back
+    task<size_t> read_at(uint64_t offset, std::span<char> buffer) override
+    {
+        long position = std::ftell(file);
+        std::fseek(file, static_cast<long>(offset), SEEK_SET);
+        size_t size = std::fread(buffer.data(), sizeof(char), buffer.size(), file);
+        std::fseek(file, position, SEEK_SET);
+        co_return size;
+    }
+
+    task<size_t> write_at(uint64_t offset, std::span<const char> buffer) override
+    {
+        long position = std::ftell(file);
+        std::fseek(file, static_cast<long>(offset), SEEK_SET);
+        size_t size = std::fwrite(buffer.data(), sizeof(char), buffer.size(), file);
+        std::fseek(file, position, SEEK_SET);
+        co_return size;
+    }
+
+    task<void> truncate(uint64_t size) override
+    {
+        std::fflush(file);
+        if (::ftruncate(::fileno(file), static_cast<off_t>(size)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), "Failed to truncate file");
+        }
+        co_return;
+    }
+
+    task<void> sync(bool data_only) override
+    {
+        std::fflush(file);
+        if (::fsync(::fileno(file)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), "Failed to sync file");
+        }
+        co_return;
+    }
+
+    task<void> sync_range(uint64_t offset, uint64_t length) override
+    {
+        co_await sync(true);
+    }
+
+    // only makes sure the file is long enough, which is all the tests can observe
+    task<void> allocate(uint64_t offset, uint64_t length) override
+    {
+        std::fflush(file);
+        struct stat info{};
+        if (::fstat(::fileno(file), &info) == 0 && static_cast<uint64_t>(info.st_size) < offset + length)
+        {
+            co_await truncate(offset + length);
+        }
+    }
+
     task<void> close()
     {
         if (file)
@@ -76,13 +143,18 @@ public:
     }
 };
 
-task<std::shared_ptr<file_descriptor>> webcraft::async::io::fs::detail::make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode)
+// the mock always goes through the C library's buffers, so direct I/O is ignored
+task<std::shared_ptr<file_descriptor>> webcraft::async::io::fs::detail::make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode, open_options options)
 {
     co_return std::make_shared<sync_file_descriptor>(p, mode);
 }
 
 #elif defined(__linux__)
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 int ios_to_posix(std::ios_base::openmode mode)
 {
     int flags = 0;
@@ -118,14 +190,50 @@ int ios_to_posix(std::ios_base::openmode mode)
     return flags;
 }
 
+// Switches an open descriptor to O_DIRECT and returns the alignment it then requires. statx() reports whether the
+// file system can do direct I/O on this file at all, so the descriptor stays buffered (alignment 1) where it cannot,
+// e.g. on some FUSE or network file systems, instead of failing every read later on.
+direct_io_alignment enable_direct_io(int fd)
+{
+    // kernels before 6.1 cannot report it, 4096 covers the logical block size of every common device
+    direct_io_alignment alignment{4096, 4096};
+#if defined(STATX_DIOALIGN)
+    struct statx stx{};
+    if (::statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 && (stx.stx_mask & STATX_DIOALIGN))
+    {
+        if (stx.stx_dio_offset_align == 0)
+        {
+            return {};
+        }
+        alignment = {stx.stx_dio_mem_align, stx.stx_dio_offset_align};
+    }
+#endif
+
+    int flags = ::fcntl(fd, F_GETFL);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_DIRECT) < 0)
+    {
+        return {};
+    }
+    return alignment;
+}
+
+void throw_if_failed(int result, const char *message)
+{
+    if (result < 0)
+    {
+        throw std::system_error(-result, std::system_category(), message);
+    }
+}
+
 class io_uring_file_descriptor : public webcraft::async::io::fs::detail::file_descriptor
 {
 private:
     int fd;
     bool closed{false};
+    direct_io_alignment direct_alignment;
 
 public:
-    io_uring_file_descriptor(int fd, std::ios_base::openmode mode) : file_descriptor(mode), fd(fd)
+    io_uring_file_descriptor(int fd, std::ios_base::openmode mode, direct_io_alignment direct_alignment) : file_descriptor(mode), fd(fd), direct_alignment(direct_alignment)
     {
     }
 
@@ -146,8 +254,10 @@ public:
         }
 
         int fd = this->fd;
-        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, buffer](struct io_uring_sqe *sqe)
-                                                                                                                 { io_uring_prep_read(sqe, fd, buffer.data(), buffer.size(), -1); }));
+        uint16_t ioprio = priority.native();
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, buffer, ioprio](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_read(sqe, fd, buffer.data(), buffer.size(), -1);
+                                                                                                                   sqe->ioprio = ioprio; }, get_stop_token(), priority));
 
         co_await event;
 
@@ -162,14 +272,164 @@ public:
         }
 
         int fd = this->fd;
-        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, buffer](struct io_uring_sqe *sqe)
-                                                                                                                 { io_uring_prep_write(sqe, fd, buffer.data(), buffer.size(), 0); }));
+        uint16_t ioprio = priority.native();
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, buffer, ioprio](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_write(sqe, fd, buffer.data(), buffer.size(), -1);
+                                                                                                                   sqe->ioprio = ioprio; }, get_stop_token(), priority));
+
+        co_await event;
+
+        co_return event.get_result();
+    }
+
+    task<size_t> read_at(uint64_t offset, std::span<char> buffer) override
+    {
+        if ((mode & std::ios::in) != std::ios::in)
+        {
+            throw std::logic_error("File not open for reading");
+        }
+
+        int fd = this->fd;
+        uint16_t ioprio = priority.native();
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, buffer, offset, ioprio](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_read(sqe, fd, buffer.data(), buffer.size(), offset);
+                                                                                                                   sqe->ioprio = ioprio; }, get_stop_token(), priority));
+
+        co_await event;
+
+        if (event.get_result() < 0)
+        {
+            std::error_code ec(-event.get_result(), std::system_category());
+            throw std::system_error(ec, "Failed to read from file");
+        }
+
+        co_return event.get_result();
+    }
+
+    task<size_t> write_at(uint64_t offset, std::span<const char> buffer) override
+    {
+        if ((mode & std::ios::out) != std::ios::out)
+        {
+            throw std::logic_error("File not open for writing");
+        }
+
+        int fd = this->fd;
+        uint16_t ioprio = priority.native();
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, buffer, offset, ioprio](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_write(sqe, fd, buffer.data(), buffer.size(), offset);
+                                                                                                                   sqe->ioprio = ioprio; }, get_stop_token(), priority));
 
         co_await event;
 
+        if (event.get_result() < 0)
+        {
+            std::error_code ec(-event.get_result(), std::system_category());
+            throw std::system_error(ec, "Failed to write to file");
+        }
+
         co_return event.get_result();
     }
 
+    // IORING_OP_FTRUNCATE only exists from 6.9 on, and changing the size is a metadata update that does not block on data
+    task<void> truncate(uint64_t size) override
+    {
+        if (::ftruncate(fd, static_cast<off_t>(size)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), "Failed to truncate file");
+        }
+        co_return;
+    }
+
+    direct_io_alignment alignment() const noexcept override
+    {
+        return direct_alignment;
+    }
+
+    task<void> advise(uint64_t offset, uint64_t length, access_pattern pattern) override
+    {
+        int advice = POSIX_FADV_NORMAL;
+        switch (pattern)
+        {
+        case access_pattern::sequential:
+            advice = POSIX_FADV_SEQUENTIAL;
+            break;
+        case access_pattern::random:
+            advice = POSIX_FADV_RANDOM;
+            break;
+        case access_pattern::normal:
+            break;
+        }
+        co_await fadvise(offset, length, advice);
+    }
+
+    // POSIX_FADV_WILLNEED starts the same page cache read-ahead as readahead(2) without waiting for it
+    task<void> prefetch(uint64_t offset, uint64_t length) override
+    {
+        co_await fadvise(offset, length, POSIX_FADV_WILLNEED);
+    }
+
+    task<void> sync(bool data_only) override
+    {
+        int fd = this->fd;
+        unsigned flags = data_only ? IORING_FSYNC_DATASYNC : 0;
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, flags](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_fsync(sqe, fd, flags); }, get_stop_token(), priority));
+
+        co_await event;
+
+        throw_if_failed(event.get_result(), "Failed to sync file");
+    }
+
+    task<void> sync_range(uint64_t offset, uint64_t length) override
+    {
+        int fd = this->fd;
+        // the length field is 32 bits wide, longer ranges are written back to the end of the file instead
+        unsigned clamped = length > UINT32_MAX ? 0 : static_cast<unsigned>(length);
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, offset, clamped](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_sync_file_range(sqe, fd, clamped, offset, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER); }, get_stop_token(), priority));
+
+        co_await event;
+
+        throw_if_failed(event.get_result(), "Failed to sync file range");
+    }
+
+    task<void> allocate(uint64_t offset, uint64_t length) override
+    {
+        int fd = this->fd;
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, offset, length](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_fallocate(sqe, fd, 0, offset, length); }, get_stop_token(), priority));
+
+        co_await event;
+
+        throw_if_failed(event.get_result(), "Failed to allocate file space");
+    }
+
+    // The write is hard-linked to the fsync so both are queued together and the fsync only starts once the write has
+    // finished. A hard link keeps the fsync running even if the write fails, so its completion always arrives.
+    task<size_t> write_and_sync(std::optional<uint64_t> offset, std::span<const char> buffer, bool data_only) override
+    {
+        if ((mode & std::ios::out) != std::ios::out)
+        {
+            throw std::logic_error("File not open for writing");
+        }
+
+        int fd = this->fd;
+        uint64_t position = offset.value_or(static_cast<uint64_t>(-1));
+        unsigned fsync_flags = data_only ? IORING_FSYNC_DATASYNC : 0;
+        uint16_t ioprio = priority.native();
+        auto event = webcraft::async::detail::as_awaitable(std::make_unique<webcraft::async::detail::linux::io_uring_linked_pair_event>([fd, buffer, position, ioprio](struct io_uring_sqe *sqe)
+                                                                                                                                        { io_uring_prep_write(sqe, fd, buffer.data(), buffer.size(), position);
+                                                                                                                                          sqe->ioprio = ioprio; },
+                                                                                                                                        [fd, fsync_flags](struct io_uring_sqe *sqe)
+                                                                                                                                        { io_uring_prep_fsync(sqe, fd, fsync_flags); },
+                                                                                                                                        priority));
+        co_await event;
+
+        throw_if_failed(event.event->first_result(), "Failed to write to file");
+        throw_if_failed(event.get_result(), "Failed to sync file");
+        co_return static_cast<size_t>(event.event->first_result());
+    }
+
     task<void> close() override
     {
         if (closed)
@@ -182,9 +442,27 @@ public:
 
         closed = true;
     }
+
+    int native_handle() const noexcept override
+    {
+        return closed ? -1 : fd;
+    }
+
+private:
+    task<void> fadvise(uint64_t offset, uint64_t length, int advice)
+    {
+        int fd = this->fd;
+        // the length field is 32 bits wide, a longer range is clamped (0 still means up to the end of the file)
+        auto clamped = static_cast<__u32>(std::min<uint64_t>(length, UINT32_MAX));
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, offset, clamped, advice](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_fadvise(sqe, fd, offset, clamped, advice); }, get_stop_token(), priority));
+
+        // only a hint: kernels without IORING_OP_FADVISE or file systems that ignore it are not an error
+        co_await event;
+    }
 };
 
-task<std::shared_ptr<file_descriptor>> webcraft::async::io::fs::detail::make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode)
+task<std::shared_ptr<file_descriptor>> webcraft::async::io::fs::detail::make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode, open_options options)
 {
     int flags = ios_to_posix(mode);
 
@@ -200,7 +478,8 @@ task<std::shared_ptr<file_descriptor>> webcraft::async::io::fs::detail::make_fil
         throw std::system_error(ec, "Failed to open file: " + p.string());
     }
 
-    co_return std::make_shared<io_uring_file_descriptor>(fd, mode);
+    direct_io_alignment alignment = options.direct ? enable_direct_io(fd) : direct_io_alignment{};
+    co_return std::make_shared<io_uring_file_descriptor>(fd, mode, alignment);
 }
 
 #elif defined(_WIN32)
@@ -213,16 +492,23 @@ protected:
     HANDLE fd;
     HANDLE iocp;
     LONGLONG fileOffset = 0;
+    direct_io_alignment direct_alignment;
 
 public:
-    iocp_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode) : file_descriptor(mode)
+    iocp_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode, open_options options) : file_descriptor(mode)
     {
         // Implementation for Windows
         DWORD desiredAccess = 0;
         DWORD shareMode = FILE_SHARE_READ | FILE_SHARE_WRITE;
         DWORD creationMode = OPEN_EXISTING; // Default for read-only
 
-        if ((mode & std::ios::in) == std::ios::in)
+        if ((mode & std::ios::in) == std::ios::in && (mode & std::ios::out) == std::ios::out)
+        {
+            // Read-write for positional access, keeps existing contents
+            desiredAccess = GENERIC_READ | GENERIC_WRITE;
+            creationMode = OPEN_ALWAYS;
+        }
+        else if ((mode & std::ios::in) == std::ios::in)
         {
             // Read only
             desiredAccess = GENERIC_READ;
@@ -248,13 +534,31 @@ public:
             }
         }
 
-        fd = ::CreateFileW(p.c_str(), desiredAccess, shareMode, nullptr, creationMode, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED, nullptr);
+        DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED;
+        if (options.direct)
+        {
+            flags |= FILE_FLAG_NO_BUFFERING;
+        }
+
+        fd = ::CreateFileW(p.c_str(), desiredAccess, shareMode, nullptr, creationMode, flags, nullptr);
 
         if (fd == INVALID_HANDLE_VALUE)
         {
             throw webcraft::async::detail::windows::overlapped_runtime_event_error("Failed to create file");
         }
 
+        if (options.direct)
+        {
+            // unbuffered handles need sector aligned buffers, offsets and lengths
+            FILE_STORAGE_INFO storage{};
+            size_t sector = 4096;
+            if (::GetFileInformationByHandleEx(fd, FileStorageInfo, &storage, sizeof(storage)))
+            {
+                sector = storage.PhysicalBytesPerSectorForPerformance;
+            }
+            direct_alignment = {sector, sector};
+        }
+
         // Associate this file handle with the global IOCP
         iocp = ::CreateIoCompletionPort(fd, (HANDLE)webcraft::async::detail::get_native_handle(), 0, 0);
 
@@ -326,6 +630,117 @@ public:
         throw std::logic_error("The file is not opened in write mode");
     }
 
+    task<size_t> read_at(uint64_t offset, std::span<char> buffer) override
+    {
+        if ((mode & std::ios::in) != std::ios::in)
+        {
+            throw std::logic_error("The file is not opened in read mode");
+        }
+
+        HANDLE fd = this->fd;
+        auto event = webcraft::async::detail::as_awaitable(
+            webcraft::async::detail::windows::create_async_io_overlapped_event(
+                fd,
+                [fd, buffer, offset](LPDWORD bytesTransferred, LPOVERLAPPED ptr)
+                {
+                    ptr->Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+                    ptr->OffsetHigh = static_cast<DWORD>((offset >> 32) & 0xFFFFFFFF);
+                    return ::ReadFile(fd, buffer.data(), (ULONG)buffer.size(), bytesTransferred, ptr);
+                }));
+        co_await event;
+
+        if (event.get_result() < 0)
+        {
+            std::error_code ec(-event.get_result(), std::system_category());
+            throw std::system_error(ec, "Failed to read from file");
+        }
+
+        co_return event.get_result();
+    }
+
+    task<size_t> write_at(uint64_t offset, std::span<const char> buffer) override
+    {
+        if ((mode & std::ios::out) != std::ios::out)
+        {
+            throw std::logic_error("The file is not opened in write mode");
+        }
+
+        HANDLE fd = this->fd;
+        auto event = webcraft::async::detail::as_awaitable(
+            webcraft::async::detail::windows::create_async_io_overlapped_event(
+                fd,
+                [fd, buffer, offset](LPDWORD bytesTransferred, LPOVERLAPPED ptr)
+                {
+                    ptr->Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+                    ptr->OffsetHigh = static_cast<DWORD>((offset >> 32) & 0xFFFFFFFF);
+                    return ::WriteFile(fd, buffer.data(), (ULONG)buffer.size(), bytesTransferred, ptr);
+                }));
+        co_await event;
+
+        if (event.get_result() < 0)
+        {
+            std::error_code ec(-event.get_result(), std::system_category());
+            throw std::system_error(ec, "Failed to write to file");
+        }
+
+        co_return event.get_result();
+    }
+
+    task<void> truncate(uint64_t size) override
+    {
+        FILE_END_OF_FILE_INFO end_of_file{};
+        end_of_file.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+        if (!::SetFileInformationByHandle(fd, FileEndOfFileInfo, &end_of_file, sizeof(end_of_file)))
+        {
+            throw webcraft::async::detail::windows::overlapped_runtime_event_error("Failed to truncate file");
+        }
+        co_return;
+    }
+
+    direct_io_alignment alignment() const noexcept override
+    {
+        return direct_alignment;
+    }
+
+    // Windows has no asynchronous flush and no separate data-only or ranged variant
+    task<void> sync(bool data_only) override
+    {
+        if (!::FlushFileBuffers(fd))
+        {
+            throw webcraft::async::detail::windows::overlapped_runtime_event_error("Failed to sync file");
+        }
+        co_return;
+    }
+
+    task<void> sync_range(uint64_t offset, uint64_t length) override
+    {
+        co_await sync(true);
+    }
+
+    task<void> allocate(uint64_t offset, uint64_t length) override
+    {
+        LARGE_INTEGER size{};
+        if (!::GetFileSizeEx(fd, &size))
+        {
+            throw webcraft::async::detail::windows::overlapped_runtime_event_error("Failed to get the file size");
+        }
+
+        LONGLONG end = static_cast<LONGLONG>(offset + length);
+        if (size.QuadPart >= end)
+        {
+            co_return;
+        }
+
+        // reserve the clusters, then move the end of file like fallocate() does
+        FILE_ALLOCATION_INFO allocation{};
+        allocation.AllocationSize.QuadPart = end;
+        if (!::SetFileInformationByHandle(fd, FileAllocationInfo, &allocation, sizeof(allocation)))
+        {
+            throw webcraft::async::detail::windows::overlapped_runtime_event_error("Failed to allocate file space");
+        }
+        co_await truncate(static_cast<uint64_t>(end));
+    }
+
     task<void> close()
     {
         if (fd != INVALID_HANDLE_VALUE)
@@ -338,13 +753,18 @@ public:
     }
 };
 
-task<std::shared_ptr<file_descriptor>> webcraft::async::io::fs::detail::make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode)
+task<std::shared_ptr<file_descriptor>> webcraft::async::io::fs::detail::make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode, open_options options)
 {
-    co_return std::make_shared<iocp_file_descriptor>(p, mode);
+    co_return std::make_shared<iocp_file_descriptor>(p, mode, options);
 }
 
 #elif defined(__APPLE__)
 
+#include <climits>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 static webcraft::async::thread_pool pool(std::thread::hardware_concurrency(), std::thread::hardware_concurrency() * 2);
 
 class thread_pool_file_descriptor : public file_descriptor
@@ -353,9 +773,18 @@ private:
     std::FILE *file;
 
 public:
-    thread_pool_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode) : file_descriptor(mode)
+    thread_pool_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode, open_options options) : file_descriptor(mode)
     {
-        if (mode & std::ios::in)
+        if ((mode & std::ios::in) && (mode & std::ios::out))
+        {
+            // read-write without truncating, creating the file if needed
+            file = std::fopen(p.c_str(), "r+");
+            if (!file)
+            {
+                file = std::fopen(p.c_str(), "w+");
+            }
+        }
+        else if (mode & std::ios::in)
         {
             file = std::fopen(p.c_str(), "r");
         }
@@ -370,6 +799,12 @@ public:
                 file = std::fopen(p.c_str(), "w");
             }
         }
+
+        if (file && options.direct)
+        {
+            // F_NOCACHE keeps the data out of the unified buffer cache and has no alignment requirements
+            ::fcntl(::fileno(file), F_NOCACHE, 1);
+        }
     }
 
     ~thread_pool_file_descriptor()
@@ -411,6 +846,129 @@ public:
         co_return si;
     }
 
+    // pread/pwrite on the underlying descriptor leave the FILE position alone and may run concurrently
+    task<size_t> read_at(uint64_t offset, std::span<char> buffer) override
+    {
+        task_completion_source<ssize_t> source;
+        int fd = ::fileno(file);
+
+        pool.submit([&, fd]
+                    {
+            auto size = ::pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(offset));
+            source.set_value(size < 0 ? -errno : size); });
+
+        auto si = co_await source.task();
+        co_await yield();
+        if (si < 0)
+        {
+            throw std::system_error(static_cast<int>(-si), std::system_category(), "Failed to read from file");
+        }
+        co_return static_cast<size_t>(si);
+    }
+
+    task<size_t> write_at(uint64_t offset, std::span<const char> buffer) override
+    {
+        task_completion_source<ssize_t> source;
+        int fd = ::fileno(file);
+
+        // buffered writes through the FILE must reach the descriptor first
+        std::fflush(file);
+        pool.submit([&, fd]
+                    {
+            auto size = ::pwrite(fd, buffer.data(), buffer.size(), static_cast<off_t>(offset));
+            source.set_value(size < 0 ? -errno : size); });
+
+        auto si = co_await source.task();
+        co_await yield();
+        if (si < 0)
+        {
+            throw std::system_error(static_cast<int>(-si), std::system_category(), "Failed to write to file");
+        }
+        co_return static_cast<size_t>(si);
+    }
+
+    task<void> truncate(uint64_t size) override
+    {
+        std::fflush(file);
+        if (::ftruncate(::fileno(file), static_cast<off_t>(size)) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), "Failed to truncate file");
+        }
+        co_return;
+    }
+
+    // macOS has no posix_fadvise, the closest it offers is switching read-ahead off for random access
+    task<void> advise(uint64_t offset, uint64_t length, access_pattern pattern) override
+    {
+        ::fcntl(::fileno(file), F_RDAHEAD, pattern == access_pattern::random ? 0 : 1);
+        co_return;
+    }
+
+    task<void> prefetch(uint64_t offset, uint64_t length) override
+    {
+        struct radvisory advisory{};
+        advisory.ra_offset = static_cast<off_t>(offset);
+        advisory.ra_count = static_cast<int>(std::min<uint64_t>(length, INT_MAX));
+        ::fcntl(::fileno(file), F_RDADVISE, &advisory);
+        co_return;
+    }
+
+    // fsync() on macOS leaves the data in the drive's cache, only F_FULLFSYNC reaches stable storage
+    task<void> sync(bool data_only) override
+    {
+        task_completion_source<int> source;
+        std::FILE *file = this->file;
+
+        pool.submit([&, file, data_only]
+                    {
+            std::fflush(file);
+            int fd = ::fileno(file);
+            int result = data_only ? ::fsync(fd) : ::fcntl(fd, F_FULLFSYNC);
+            if (result < 0 && !data_only)
+            {
+                result = ::fsync(fd); // file systems without F_FULLFSYNC support
+            }
+            source.set_value(result < 0 ? errno : 0); });
+
+        int error = co_await source.task();
+        co_await yield();
+        if (error)
+        {
+            throw std::system_error(error, std::system_category(), "Failed to sync file");
+        }
+    }
+
+    task<void> sync_range(uint64_t offset, uint64_t length) override
+    {
+        co_await sync(true);
+    }
+
+    task<void> allocate(uint64_t offset, uint64_t length) override
+    {
+        std::fflush(file);
+        int fd = ::fileno(file);
+
+        struct stat info{};
+        if (::fstat(fd, &info) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), "Failed to get the file size");
+        }
+
+        off_t end = static_cast<off_t>(offset + length);
+        if (info.st_size >= end)
+        {
+            co_return;
+        }
+
+        // F_PREALLOCATE reserves blocks past the end of the file, the size is moved separately like fallocate() does
+        fstore_t store{F_ALLOCATEALL, F_PEOFPOSMODE, 0, end - info.st_size, 0};
+        if (::fcntl(fd, F_PREALLOCATE, &store) < 0)
+        {
+            throw std::system_error(errno, std::system_category(), "Failed to allocate file space");
+        }
+        co_await truncate(static_cast<uint64_t>(end));
+    }
+
     task<void> close()
     {
         if (file)
@@ -422,9 +980,9 @@ public:
     }
 };
 
-task<std::shared_ptr<file_descriptor>> webcraft::async::io::fs::detail::make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode)
+task<std::shared_ptr<file_descriptor>> webcraft::async::io::fs::detail::make_file_descriptor(std::filesystem::path p, std::ios_base::openmode mode, open_options options)
 {
-    co_return std::make_shared<thread_pool_file_descriptor>(p, mode);
+    co_return std::make_shared<thread_pool_file_descriptor>(p, mode, options);
 }
 
 #else
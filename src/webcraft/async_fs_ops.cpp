@@ -0,0 +1,764 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/fs.hpp>
+#include <webcraft/async/fire_and_forget_task.hpp>
+#include <webcraft/async/runtime.hpp>
+#include <webcraft/async/runtime/linux.event.hpp>
+#include "fs_pool_decl.hpp"
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <system_error>
+
+using namespace webcraft::async;
+using namespace webcraft::async::io::fs;
+
+#if !defined(WEBCRAFT_MOCK_FS_TESTS)
+webcraft::async::thread_pool &webcraft::async::io::fs::detail::blocking_pool()
+{
+    static webcraft::async::thread_pool pool(0, std::thread::hardware_concurrency());
+    return pool;
+}
+#endif
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace
+{
+    void throw_if_failed(int result, const char *message, const std::filesystem::path &p1, const std::filesystem::path &p2 = {})
+    {
+        if (result < 0)
+        {
+            std::error_code ec(-result, std::system_category());
+            if (p2.empty())
+            {
+                throw std::filesystem::filesystem_error(message, p1, ec);
+            }
+            throw std::filesystem::filesystem_error(message, p1, p2, ec);
+        }
+    }
+
+    std::filesystem::file_type to_file_type(uint32_t mode) noexcept
+    {
+        using std::filesystem::file_type;
+        switch (mode & S_IFMT)
+        {
+        case S_IFREG:
+            return file_type::regular;
+        case S_IFDIR:
+            return file_type::directory;
+        case S_IFLNK:
+            return file_type::symlink;
+        case S_IFBLK:
+            return file_type::block;
+        case S_IFCHR:
+            return file_type::character;
+        case S_IFIFO:
+            return file_type::fifo;
+        case S_IFSOCK:
+            return file_type::socket;
+        default:
+            return file_type::unknown;
+        }
+    }
+
+    file_status to_file_status(const struct statx &result) noexcept
+    {
+        file_status status;
+        status.type = to_file_type(result.stx_mode);
+        status.permissions = static_cast<std::filesystem::perms>(result.stx_mode & 07777);
+        status.size = result.stx_size;
+        status.hard_links = result.stx_nlink;
+        status.last_write_time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::seconds(result.stx_mtime.tv_sec) + std::chrono::nanoseconds(result.stx_mtime.tv_nsec)));
+        return status;
+    }
+}
+
+task<file_status> webcraft::async::io::fs::stat(std::filesystem::path p, bool follow_symlinks)
+{
+    struct statx result{};
+    struct statx *out = &result;
+    int flags = follow_symlinks ? 0 : AT_SYMLINK_NOFOLLOW;
+
+    auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([p, flags, out](struct io_uring_sqe *sqe)
+                                                                                                          { io_uring_prep_statx(sqe, AT_FDCWD, p.c_str(), flags, STATX_BASIC_STATS, out); }, {}));
+
+    co_await event;
+
+    throw_if_failed(event.get_result(), "Failed to stat", p);
+    co_return to_file_status(result);
+}
+
+task<file_status> webcraft::async::io::fs::detail::stat_descriptor(std::shared_ptr<file_descriptor> fd, std::filesystem::path p)
+{
+    int handle = fd->native_handle();
+    if (handle < 0)
+    {
+        file_status status = co_await stat(p);
+        co_return status;
+    }
+
+    struct statx result{};
+    struct statx *out = &result;
+
+    auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([handle, out](struct io_uring_sqe *sqe)
+                                                                                                          { io_uring_prep_statx(sqe, handle, "", AT_EMPTY_PATH, STATX_BASIC_STATS, out); }, {}));
+
+    co_await event;
+
+    throw_if_failed(event.get_result(), "Failed to stat", p);
+    co_return to_file_status(result);
+}
+
+task<void> webcraft::async::io::fs::unlink(std::filesystem::path p)
+{
+    auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([p](struct io_uring_sqe *sqe)
+                                                                                                          { io_uring_prep_unlinkat(sqe, AT_FDCWD, p.c_str(), 0); }, {}));
+
+    co_await event;
+
+    throw_if_failed(event.get_result(), "Failed to unlink", p);
+}
+
+task<void> webcraft::async::io::fs::rmdir(std::filesystem::path p)
+{
+    auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([p](struct io_uring_sqe *sqe)
+                                                                                                          { io_uring_prep_unlinkat(sqe, AT_FDCWD, p.c_str(), AT_REMOVEDIR); }, {}));
+
+    co_await event;
+
+    throw_if_failed(event.get_result(), "Failed to remove directory", p);
+}
+
+task<void> webcraft::async::io::fs::rename(std::filesystem::path from, std::filesystem::path to)
+{
+    auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([from, to](struct io_uring_sqe *sqe)
+                                                                                                          { io_uring_prep_renameat(sqe, AT_FDCWD, from.c_str(), AT_FDCWD, to.c_str(), 0); }, {}));
+
+    co_await event;
+
+    throw_if_failed(event.get_result(), "Failed to rename", from, to);
+}
+
+task<void> webcraft::async::io::fs::mkdir(std::filesystem::path p, std::filesystem::perms permissions)
+{
+    auto mode = static_cast<mode_t>(static_cast<unsigned>(permissions) & 07777);
+    auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([p, mode](struct io_uring_sqe *sqe)
+                                                                                                          { io_uring_prep_mkdirat(sqe, AT_FDCWD, p.c_str(), mode); }, {}));
+
+    co_await event;
+
+    throw_if_failed(event.get_result(), "Failed to create directory", p);
+}
+
+task<void> webcraft::async::io::fs::link(std::filesystem::path existing, std::filesystem::path link_path)
+{
+    auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([existing, link_path](struct io_uring_sqe *sqe)
+                                                                                                          { io_uring_prep_linkat(sqe, AT_FDCWD, existing.c_str(), AT_FDCWD, link_path.c_str(), 0); }, {}));
+
+    co_await event;
+
+    throw_if_failed(event.get_result(), "Failed to create hard link", existing, link_path);
+}
+
+#else
+
+namespace
+{
+#if defined(WEBCRAFT_MOCK_FS_TESTS)
+    // the mock runs everything inline so tests stay deterministic
+    template <typename F>
+    struct inline_call
+    {
+        F fn;
+
+        constexpr bool await_ready() const noexcept { return true; }
+        constexpr void await_suspend(std::coroutine_handle<>) const noexcept {}
+        auto await_resume() { return fn(); }
+    };
+
+    template <typename F>
+    auto run_blocking(F &&fn)
+    {
+        return inline_call<std::decay_t<F>>{std::forward<F>(fn)};
+    }
+
+    task<void> return_to_runtime()
+    {
+        co_return;
+    }
+#else
+    // an awaitable rather than a coroutine taking `fn`, so the closure is never copied into a coroutine frame
+    template <typename F>
+    auto run_blocking(F &&fn)
+    {
+        return webcraft::async::io::fs::detail::blocking_pool().async_submit(std::forward<F>(fn));
+    }
+
+    // async_submit() resumes on the worker that ran the call
+    task<void> return_to_runtime()
+    {
+        co_await yield();
+    }
+#endif
+
+    void throw_if_failed(const std::error_code &ec, const char *message, const std::filesystem::path &p1, const std::filesystem::path &p2 = {})
+    {
+        if (ec)
+        {
+            if (p2.empty())
+            {
+                throw std::filesystem::filesystem_error(message, p1, ec);
+            }
+            throw std::filesystem::filesystem_error(message, p1, p2, ec);
+        }
+    }
+}
+
+// the calls report errors through error codes so that the caller is always back on the runtime thread before throwing
+task<file_status> webcraft::async::io::fs::stat(std::filesystem::path p, bool follow_symlinks)
+{
+    auto call = run_blocking([p, follow_symlinks]
+                             {
+        std::error_code ec;
+        auto found = follow_symlinks ? std::filesystem::status(p, ec) : std::filesystem::symlink_status(p, ec);
+        if (!ec && found.type() == std::filesystem::file_type::not_found)
+        {
+            ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        }
+
+        file_status status;
+        if (ec)
+        {
+            return std::make_pair(status, ec);
+        }
+
+        std::error_code ignored;
+        status.type = found.type();
+        status.permissions = found.permissions();
+        if (status.type == std::filesystem::file_type::regular)
+        {
+            status.size = std::filesystem::file_size(p, ignored);
+        }
+        status.hard_links = std::filesystem::hard_link_count(p, ignored);
+        auto modified = std::filesystem::last_write_time(p, ignored);
+        if (!ignored)
+        {
+            status.last_write_time = std::chrono::time_point_cast<std::chrono::system_clock::duration>(std::chrono::file_clock::to_sys(modified));
+        }
+        return std::make_pair(status, ec); });
+    auto [status, ec] = co_await call;
+    co_await return_to_runtime();
+
+    throw_if_failed(ec, "Failed to stat", p);
+    co_return status;
+}
+
+// without a descriptor-based call on every platform, the path is looked up again
+task<file_status> webcraft::async::io::fs::detail::stat_descriptor(std::shared_ptr<file_descriptor> fd, std::filesystem::path p)
+{
+    file_status status = co_await stat(p);
+    co_return status;
+}
+
+task<void> webcraft::async::io::fs::unlink(std::filesystem::path p)
+{
+    auto call = run_blocking([p]
+                             {
+        std::error_code ec;
+        if (std::filesystem::is_directory(std::filesystem::symlink_status(p, ec)))
+        {
+            ec = std::make_error_code(std::errc::is_a_directory);
+        }
+        else if (!ec && !std::filesystem::remove(p, ec) && !ec)
+        {
+            ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        }
+        return ec; });
+    std::error_code ec = co_await call;
+    co_await return_to_runtime();
+
+    throw_if_failed(ec, "Failed to unlink", p);
+}
+
+task<void> webcraft::async::io::fs::rmdir(std::filesystem::path p)
+{
+    auto call = run_blocking([p]
+                             {
+        std::error_code ec;
+        if (!std::filesystem::is_directory(std::filesystem::symlink_status(p, ec)) && !ec)
+        {
+            ec = std::make_error_code(std::errc::not_a_directory);
+        }
+        else if (!ec && !std::filesystem::remove(p, ec) && !ec)
+        {
+            ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        }
+        return ec; });
+    std::error_code ec = co_await call;
+    co_await return_to_runtime();
+
+    throw_if_failed(ec, "Failed to remove directory", p);
+}
+
+task<void> webcraft::async::io::fs::rename(std::filesystem::path from, std::filesystem::path to)
+{
+    auto call = run_blocking([from, to]
+                             {
+        std::error_code ec;
+        std::filesystem::rename(from, to, ec);
+        return ec; });
+    std::error_code ec = co_await call;
+    co_await return_to_runtime();
+
+    throw_if_failed(ec, "Failed to rename", from, to);
+}
+
+task<void> webcraft::async::io::fs::mkdir(std::filesystem::path p, std::filesystem::perms permissions)
+{
+    auto call = run_blocking([p, permissions]
+                             {
+        std::error_code ec;
+        if (!std::filesystem::create_directory(p, ec) && !ec)
+        {
+            ec = std::make_error_code(std::errc::file_exists);
+        }
+        if (!ec && permissions != std::filesystem::perms::all)
+        {
+            std::filesystem::permissions(p, permissions, ec);
+        }
+        return ec; });
+    std::error_code ec = co_await call;
+    co_await return_to_runtime();
+
+    throw_if_failed(ec, "Failed to create directory", p);
+}
+
+task<void> webcraft::async::io::fs::link(std::filesystem::path existing, std::filesystem::path link_path)
+{
+    auto call = run_blocking([existing, link_path]
+                             {
+        std::error_code ec;
+        std::filesystem::create_hard_link(existing, link_path, ec);
+        return ec; });
+    std::error_code ec = co_await call;
+    co_await return_to_runtime();
+
+    throw_if_failed(ec, "Failed to create hard link", existing, link_path);
+}
+
+#endif
+
+// Directory traversal
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+
+#include <dirent.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace
+{
+    // getdents64 hands back as many entries as fit into the buffer in one call, where readdir() would go through
+    // another layer of buffering and a lock per call
+    class directory_reader
+    {
+    private:
+        int fd;
+        std::filesystem::path directory;
+        size_t depth;
+        std::vector<char> buffer = std::vector<char>(64 * 1024);
+        size_t position{0};
+        size_t filled{0};
+
+        std::filesystem::file_type resolve_type(unsigned char d_type, const char *name) const
+        {
+            using std::filesystem::file_type;
+            switch (d_type)
+            {
+            case DT_REG:
+                return file_type::regular;
+            case DT_DIR:
+                return file_type::directory;
+            case DT_LNK:
+                return file_type::symlink;
+            case DT_BLK:
+                return file_type::block;
+            case DT_CHR:
+                return file_type::character;
+            case DT_FIFO:
+                return file_type::fifo;
+            case DT_SOCK:
+                return file_type::socket;
+            default:
+                break;
+            }
+
+            // some file systems (XFS without ftype, many network ones) leave d_type empty
+            struct stat info{};
+            if (::fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) < 0)
+            {
+                return file_type::not_found;
+            }
+            switch (info.st_mode & S_IFMT)
+            {
+            case S_IFREG:
+                return file_type::regular;
+            case S_IFDIR:
+                return file_type::directory;
+            case S_IFLNK:
+                return file_type::symlink;
+            default:
+                return file_type::unknown;
+            }
+        }
+
+        bool points_to_directory(const char *name) const
+        {
+            struct stat info{};
+            return ::fstatat(fd, name, &info, 0) == 0 && S_ISDIR(info.st_mode);
+        }
+
+    public:
+        directory_reader(std::filesystem::path directory, size_t depth) : directory(std::move(directory)), depth(depth)
+        {
+            fd = ::open(this->directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0)
+            {
+                throw std::filesystem::filesystem_error("Failed to open directory", this->directory, std::error_code(errno, std::system_category()));
+            }
+        }
+
+        directory_reader(const directory_reader &) = delete;
+        directory_reader &operator=(const directory_reader &) = delete;
+
+        ~directory_reader()
+        {
+            ::close(fd);
+        }
+
+        /// @return false once the directory is exhausted
+        bool next(std::vector<dir_entry> &entries, std::vector<std::filesystem::path> &subdirectories, size_t limit, bool follow_symlinks)
+        {
+            while (entries.size() < limit)
+            {
+                if (position >= filled)
+                {
+                    long read = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+                    if (read < 0)
+                    {
+                        throw std::filesystem::filesystem_error("Failed to read directory", directory, std::error_code(errno, std::system_category()));
+                    }
+                    if (read == 0)
+                    {
+                        return false;
+                    }
+                    position = 0;
+                    filled = static_cast<size_t>(read);
+                }
+
+                // struct linux_dirent64: u64 d_ino, s64 d_off, u16 d_reclen, u8 d_type, char d_name[]
+                const char *record = buffer.data() + position;
+                unsigned short length;
+                std::memcpy(&length, record + 16, sizeof(length));
+                unsigned char d_type = static_cast<unsigned char>(record[18]);
+                const char *name = record + 19;
+                position += length;
+
+                if (std::strcmp(name, ".") == 0 || std::strcmp(name, "..") == 0)
+                {
+                    continue;
+                }
+
+                dir_entry entry;
+                entry.path = directory / name;
+                entry.type = resolve_type(d_type, name);
+                entry.depth = depth;
+                if (entry.type == std::filesystem::file_type::not_found)
+                {
+                    continue; // removed since the directory was read
+                }
+
+                if (entry.type == std::filesystem::file_type::directory ||
+                    (follow_symlinks && entry.type == std::filesystem::file_type::symlink && points_to_directory(name)))
+                {
+                    subdirectories.push_back(entry.path);
+                }
+                entries.push_back(std::move(entry));
+            }
+            return true;
+        }
+    };
+}
+
+#else
+
+namespace
+{
+    class directory_reader
+    {
+    private:
+        std::filesystem::path directory;
+        std::filesystem::directory_iterator iterator;
+        size_t depth;
+
+    public:
+        directory_reader(std::filesystem::path directory, size_t depth) : directory(directory), iterator(directory), depth(depth) {}
+
+        /// @return false once the directory is exhausted
+        bool next(std::vector<dir_entry> &entries, std::vector<std::filesystem::path> &subdirectories, size_t limit, bool follow_symlinks)
+        {
+            std::error_code ec;
+            for (; iterator != std::filesystem::directory_iterator(); iterator.increment(ec))
+            {
+                if (entries.size() >= limit)
+                {
+                    return true;
+                }
+
+                std::error_code entry_error;
+                dir_entry entry;
+                entry.path = iterator->path();
+                entry.type = iterator->symlink_status(entry_error).type();
+                entry.depth = depth;
+                if (entry_error)
+                {
+                    continue; // removed since the directory was read
+                }
+
+                if (entry.type == std::filesystem::file_type::directory ||
+                    (follow_symlinks && entry.type == std::filesystem::file_type::symlink && iterator->is_directory(entry_error)))
+                {
+                    subdirectories.push_back(entry.path);
+                }
+                entries.push_back(std::move(entry));
+            }
+
+            if (ec)
+            {
+                throw std::filesystem::filesystem_error("Failed to read directory", directory, ec);
+            }
+            return false;
+        }
+    };
+}
+
+#endif
+
+namespace
+{
+    struct pending_directory
+    {
+        std::filesystem::path path;
+        size_t depth;
+        std::shared_ptr<directory_reader> reader; // set once the directory is open and partly read
+    };
+
+    struct directory_batch
+    {
+        std::vector<dir_entry> entries;
+        std::vector<std::filesystem::path> subdirectories;
+        std::optional<pending_directory> rest; // the same directory if it has more entries
+        size_t depth{0};
+        std::exception_ptr error;
+        bool done{false};
+    };
+
+    // Reads run on the pool and outlive the walk if its generator is dropped early, so they report back through state
+    // shared with the walk rather than by resuming a task that may no longer exist.
+    struct walk_state
+    {
+        std::mutex mutex;
+        const directory_batch *awaited{nullptr};
+        std::coroutine_handle<> waiter;
+    };
+
+    // carries the wake-up from the pool thread over to the runtime thread, where the walk also runs and is destroyed,
+    // so the check that it is still waiting and the resumption cannot be split by the generator going away
+    fire_and_forget_task wake_walk(std::shared_ptr<walk_state> state, const directory_batch *batch)
+    {
+        co_await yield();
+
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard lock(state->mutex);
+            if (state->awaited == batch)
+            {
+                waiter = std::exchange(state->waiter, {});
+                state->awaited = nullptr;
+            }
+        }
+
+        if (waiter)
+        {
+            waiter.resume();
+        }
+    }
+
+    void finish(const std::shared_ptr<walk_state> &state, directory_batch &batch)
+    {
+        bool waited;
+        {
+            std::lock_guard lock(state->mutex);
+            batch.done = true;
+            waited = state->awaited == &batch;
+        }
+
+        if (waited)
+        {
+            wake_walk(state, &batch);
+        }
+    }
+
+    std::shared_ptr<directory_batch> start_read(std::shared_ptr<walk_state> state, pending_directory directory, const walk_options &options)
+    {
+        auto batch = std::make_shared<directory_batch>();
+        batch->depth = directory.depth;
+
+        auto read = [state, batch, directory = std::move(directory), limit = std::max<size_t>(options.batch_size, 1), follow = options.follow_symlinks]() mutable
+        {
+            try
+            {
+                if (!directory.reader)
+                {
+                    directory.reader = std::make_shared<directory_reader>(directory.path, directory.depth);
+                }
+                if (directory.reader->next(batch->entries, batch->subdirectories, limit, follow))
+                {
+                    batch->rest = std::move(directory);
+                }
+            }
+            catch (...)
+            {
+                batch->error = std::current_exception();
+            }
+            finish(state, *batch);
+        };
+
+#if defined(WEBCRAFT_MOCK_FS_TESTS)
+        read();
+#else
+        webcraft::async::io::fs::detail::blocking_pool().submit(std::move(read));
+#endif
+        return batch;
+    }
+
+    struct batch_ready
+    {
+        walk_state &state;
+        directory_batch &batch;
+        bool suspended{false};
+
+        batch_ready(walk_state &state, directory_batch &batch) : state(state), batch(batch) {}
+        batch_ready(const batch_ready &) = delete;
+        batch_ready &operator=(const batch_ready &) = delete;
+
+        // the walk's generator was dropped while waiting: the read must not resume the destroyed frame once it is done
+        ~batch_ready()
+        {
+            if (suspended)
+            {
+                std::lock_guard lock(state.mutex);
+                if (state.awaited == &batch)
+                {
+                    state.awaited = nullptr;
+                    state.waiter = {};
+                }
+            }
+        }
+
+        bool await_ready() const
+        {
+            std::lock_guard lock(state.mutex);
+            return batch.done;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle)
+        {
+            std::lock_guard lock(state.mutex);
+            if (batch.done)
+            {
+                return false;
+            }
+            state.awaited = &batch;
+            state.waiter = handle;
+            suspended = true;
+            return true;
+        }
+
+        void await_resume() const noexcept {}
+    };
+}
+
+async_generator<dir_entry> webcraft::async::io::fs::walk(std::filesystem::path root, walk_options options)
+{
+    auto state = std::make_shared<walk_state>();
+    std::deque<pending_directory> queued;
+    std::deque<std::shared_ptr<directory_batch>> in_flight;
+    queued.push_back({root, 0, nullptr});
+
+    while (!queued.empty() || !in_flight.empty())
+    {
+        while (in_flight.size() < std::max<size_t>(options.max_parallel, 1) && !queued.empty())
+        {
+            in_flight.push_back(start_read(state, std::move(queued.front()), options));
+            queued.pop_front();
+        }
+
+        auto batch = std::move(in_flight.front());
+        in_flight.pop_front();
+
+        co_await batch_ready{*state, *batch};
+
+        if (batch->error)
+        {
+            if (batch->depth == 0 || !options.skip_errors)
+            {
+                std::rethrow_exception(batch->error);
+            }
+            continue;
+        }
+
+        // finishing a directory comes first so its reader, and the descriptor it holds, does not linger
+        if (batch->rest)
+        {
+            queued.push_front(std::move(*batch->rest));
+        }
+        if (options.recursive)
+        {
+            for (auto &subdirectory : batch->subdirectories)
+            {
+                queued.push_back({std::move(subdirectory), batch->depth + 1, nullptr});
+            }
+        }
+
+        if (options.stat && !batch->entries.empty())
+        {
+            std::vector<std::filesystem::path> paths;
+            paths.reserve(batch->entries.size());
+            for (const auto &entry : batch->entries)
+            {
+                paths.push_back(entry.path);
+            }
+
+            auto statuses = co_await stat_many(paths, options.follow_symlinks);
+            for (size_t i = 0; i < statuses.size(); i++)
+            {
+                batch->entries[i].status = statuses[i];
+            }
+        }
+
+        for (auto &entry : batch->entries)
+        {
+            co_yield entry;
+        }
+    }
+}
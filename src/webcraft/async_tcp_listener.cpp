@@ -49,6 +49,20 @@ private:
     int fd;
     std::atomic<bool> closed{false};
 
+    void apply_listener_options()
+    {
+        try
+        {
+            apply_socket_options(this->fd, options, socket_role::listener);
+        }
+        catch (...)
+        {
+            ::close(this->fd);
+            this->fd = -1;
+            throw;
+        }
+    }
+
 public:
     io_uring_tcp_listener_descriptor()
     {
@@ -112,8 +126,7 @@ public:
                 continue;
             }
 
-            int opt = 1;
-            if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+            if (!apply_bind_options(fd, options))
             {
                 ::close(fd);
                 continue;
@@ -142,6 +155,28 @@ public:
 
             throw std::system_error(ec, "Failed to create socket");
         }
+
+        apply_listener_options();
+    }
+
+    void bind(const webcraft::async::io::socket::socket_address &address) override
+    {
+        int fd = ::socket(address.family(), SOCK_STREAM, IPPROTO_TCP);
+        if (fd < 0)
+        {
+            std::error_code ec(errno, std::system_category());
+            throw std::system_error(ec, "Failed to create socket");
+        }
+
+        if (!apply_bind_options(fd, options) || ::bind(fd, address.data(), static_cast<socklen_t>(address.size())) < 0)
+        {
+            std::error_code ec(errno, std::system_category());
+            ::close(fd);
+            throw std::system_error(ec, "Failed to bind to " + address.to_string());
+        }
+
+        this->fd = fd;
+        apply_listener_options();
     }
 
     void listen(int backlog) override
@@ -157,14 +192,20 @@ public:
         }
     }
 
+    int native_handle() const noexcept override
+    {
+        return closed.load(std::memory_order_acquire) ? -1 : fd;
+    }
+
     task<std::shared_ptr<tcp_socket_descriptor>> accept() override
     {
         int fd = this->fd;
-        struct sockaddr_storage addr;
-        socklen_t addr_len = sizeof(addr);
+        webcraft::async::io::socket::socket_address peer;
+        socklen_t addr_len = static_cast<socklen_t>(peer.capacity());
+        sockaddr *addr = peer.data();
 
-        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, &addr, addr_len](struct io_uring_sqe *sqe)
-                                                                                                                 { io_uring_prep_accept(sqe, fd, (struct sockaddr *)&addr, (socklen_t *)&addr_len, SOCK_CLOEXEC); }));
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, addr, &addr_len](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_accept(sqe, fd, addr, &addr_len, SOCK_CLOEXEC); }));
 
         co_await event;
 
@@ -174,20 +215,22 @@ public:
             throw std::system_error(ec, "Failed to accept connection");
         }
 
-        auto [host, port] = webcraft::net::util::addr_to_host_port(addr);
-
-        if (host.empty() || port == 0)
-        {
-            co_return nullptr;
-        }
+        // kept as the kernel returned it; formatting the peer to a string is left to whoever asks for it
+        peer.resize(addr_len);
 
-        co_return std::make_shared<io_uring_tcp_socket_descriptor>(event.get_result(), host, port);
+        // the descriptor owns the socket from here on, so it is closed if an option is rejected
+        auto accepted = std::make_shared<io_uring_tcp_socket_descriptor>(event.get_result(), std::move(peer));
+        accepted->set_options(options);
+        apply_socket_options(event.get_result(), options, socket_role::accepted);
+        co_return accepted;
     }
 };
 
-std::shared_ptr<webcraft::async::io::socket::detail::tcp_listener_descriptor> webcraft::async::io::socket::detail::make_tcp_listener_descriptor()
+std::shared_ptr<webcraft::async::io::socket::detail::tcp_listener_descriptor> webcraft::async::io::socket::detail::make_tcp_listener_descriptor(socket_options options)
 {
-    return std::make_shared<io_uring_tcp_listener_descriptor>();
+    auto descriptor = std::make_shared<io_uring_tcp_listener_descriptor>();
+    descriptor->set_options(std::move(options));
+    return descriptor;
 }
 
 #elif defined(_WIN32)
@@ -275,6 +318,17 @@ public:
         if (!flag) {
             throw webcraft::async::detail::windows::overlapped_winsock2_runtime_error("Failed to create socket");
         }
+
+        try
+        {
+            apply_socket_options(this->socket, options, socket_role::listener);
+        }
+        catch (...)
+        {
+            ::closesocket(this->socket);
+            this->socket = INVALID_SOCKET;
+            throw;
+        }
     }
 
     void listen(int backlog) override
@@ -377,7 +431,10 @@ public:
         // 7. Return the descriptor
         // The iocp_tcp_socket_descriptor constructor will call CreateIoCompletionPort
         // to associate this new 'accept_socket' with the global IOCP handle.
-        co_return std::make_shared<iocp_tcp_socket_descriptor>(accept_socket, remote_host, remote_port);
+        auto accepted = std::make_shared<iocp_tcp_socket_descriptor>(accept_socket, remote_host, remote_port);
+        accepted->set_options(options);
+        apply_socket_options(accept_socket, options, socket_role::accepted);
+        co_return accepted;
     }
 
     task<void> close() override
@@ -393,9 +450,11 @@ public:
     }
 };
 
-std::shared_ptr<webcraft::async::io::socket::detail::tcp_listener_descriptor> webcraft::async::io::socket::detail::make_tcp_listener_descriptor()
+std::shared_ptr<webcraft::async::io::socket::detail::tcp_listener_descriptor> webcraft::async::io::socket::detail::make_tcp_listener_descriptor(socket_options options)
 {
-    return std::make_shared<iocp_tcp_socket_listener>();
+    auto descriptor = std::make_shared<iocp_tcp_socket_listener>();
+    descriptor->set_options(std::move(options));
+    return descriptor;
 }
 
 #elif defined(__APPLE__)
@@ -473,8 +532,7 @@ public:
                 continue;
             }
 
-            int opt = 1;
-            if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+            if (!apply_bind_options(fd, options))
             {
                 ::close(fd);
                 continue;
@@ -502,6 +560,17 @@ public:
             std::error_code ec(errno, std::system_category());
             throw std::system_error(ec, "Failed to create socket");
         }
+
+        try
+        {
+            apply_socket_options(this->fd, options, socket_role::listener);
+        }
+        catch (...)
+        {
+            ::close(this->fd);
+            this->fd = -1;
+            throw;
+        }
     }
 
     void listen(int backlog) override
@@ -519,6 +588,11 @@ public:
         register_with_queue();
     }
 
+    int native_handle() const noexcept override
+    {
+        return closed.load(std::memory_order_acquire) ? -1 : fd;
+    }
+
     task<std::shared_ptr<tcp_socket_descriptor>> accept() override
     {
         if (no_more_connections)
@@ -548,7 +622,10 @@ public:
             co_return nullptr;
         }
 
-        co_return std::make_shared<kqueue_tcp_socket_descriptor>(result, host, port);
+        auto accepted = std::make_shared<kqueue_tcp_socket_descriptor>(result, host, port);
+        accepted->set_options(options);
+        apply_socket_options(result, options, socket_role::accepted);
+        co_return accepted;
     }
 
     void register_with_queue()
@@ -593,9 +670,11 @@ public:
     }
 };
 
-std::shared_ptr<webcraft::async::io::socket::detail::tcp_listener_descriptor> webcraft::async::io::socket::detail::make_tcp_listener_descriptor()
+std::shared_ptr<webcraft::async::io::socket::detail::tcp_listener_descriptor> webcraft::async::io::socket::detail::make_tcp_listener_descriptor(socket_options options)
 {
-    return std::make_shared<kqueue_tcp_listener_descriptor>();
+    auto descriptor = std::make_shared<kqueue_tcp_listener_descriptor>();
+    descriptor->set_options(std::move(options));
+    return descriptor;
 }
 
 #endif
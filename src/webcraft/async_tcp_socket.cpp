@@ -20,7 +20,7 @@ using namespace webcraft::async::io::socket::detail;
 #if defined(WEBCRAFT_MOCK_SOCKET_TESTS)
 
 inline std::shared_ptr<tcp_socket_descriptor>
-webcraft::async::io::socket::detail::make_tcp_socket_descriptor()
+webcraft::async::io::socket::detail::make_tcp_socket_descriptor(socket_options options)
 {
     throw std::runtime_error("TCP socket descriptor not implemented in mock tests");
 }
@@ -30,14 +30,21 @@ webcraft::async::io::socket::detail::make_tcp_socket_descriptor()
 #include <unistd.h>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
 #include <string.h>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <vector>
 
 io_uring_tcp_socket_descriptor::io_uring_tcp_socket_descriptor()
 {
     fd = -1;
 }
 
-io_uring_tcp_socket_descriptor::io_uring_tcp_socket_descriptor(int fd, std::string host, uint16_t port) : fd(fd), host(std::move(host)), port(port)
+io_uring_tcp_socket_descriptor::io_uring_tcp_socket_descriptor(int fd, webcraft::async::io::socket::socket_address peer) : fd(fd), port(0), peer(std::move(peer))
 {
 }
 
@@ -65,7 +72,7 @@ task<size_t> io_uring_tcp_socket_descriptor::read(std::span<char> buffer)
 {
     int fd = this->fd;
     auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, buffer](struct io_uring_sqe *sqe)
-                                                                                                             { io_uring_prep_recv(sqe, fd, buffer.data(), buffer.size(), 0); }));
+                                                                                                             { io_uring_prep_recv(sqe, fd, buffer.data(), buffer.size(), 0); }, get_stop_token(), read_priority));
 
     co_await event;
 
@@ -75,6 +82,13 @@ task<size_t> io_uring_tcp_socket_descriptor::read(std::span<char> buffer)
         throw std::system_error(ec, "Failed to read from socket");
     }
 
+    if (options.quick_ack.value_or(false))
+    {
+        // the kernel goes back to delayed acks on its own, so quick acks only last if they are asked for again
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+    }
+
     co_return event.get_result();
 }
 
@@ -82,7 +96,7 @@ task<size_t> io_uring_tcp_socket_descriptor::write(std::span<const char> buffer)
 {
     int fd = this->fd;
     auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd, buffer](struct io_uring_sqe *sqe)
-                                                                                                             { io_uring_prep_write(sqe, fd, buffer.data(), buffer.size(), 0); }));
+                                                                                                             { io_uring_prep_write(sqe, fd, buffer.data(), buffer.size(), 0); }, get_stop_token(), write_priority));
 
     co_await event;
 
@@ -95,71 +109,265 @@ task<size_t> io_uring_tcp_socket_descriptor::write(std::span<const char> buffer)
     co_return event.get_result();
 }
 
-task<void> io_uring_tcp_socket_descriptor::connect(const webcraft::async::io::socket::connection_info &info)
+namespace
 {
-
-    this->host = info.host;
-    this->port = info.port;
-
-    // Prepare address string for getaddrinfo
-    std::string port_str = std::to_string(info.port);
-    struct addrinfo hints{};
-    hints.ai_family = AF_UNSPEC;     // Allow IPv4 or IPv6
-    hints.ai_socktype = SOCK_STREAM; // TCP
-    hints.ai_protocol = IPPROTO_TCP;
-
-    struct addrinfo *res;
-    int ret = getaddrinfo(info.host.c_str(), port_str.c_str(), &hints, &res);
-    if (ret != 0)
+    // RFC 8305 section 4: alternate between the address families, starting with the one sorted first
+    std::vector<const webcraft::async::io::socket::socket_address *> interleave_families(const std::vector<webcraft::async::io::socket::socket_address> &addresses)
     {
-        throw webcraft::net::util::get_addr_info_error(ret);
+        std::vector<const webcraft::async::io::socket::socket_address *> preferred;
+        std::vector<const webcraft::async::io::socket::socket_address *> other;
+        for (const auto &address : addresses)
+        {
+            (address.family() == addresses.front().family() ? preferred : other).push_back(&address);
+        }
+
+        std::vector<const webcraft::async::io::socket::socket_address *> ordered;
+        ordered.reserve(addresses.size());
+        for (size_t i = 0; i < std::max(preferred.size(), other.size()); i++)
+        {
+            if (i < preferred.size())
+                ordered.push_back(preferred[i]);
+            if (i < other.size())
+                ordered.push_back(other[i]);
+        }
+        return ordered;
     }
 
-    bool flag = false;
-    for (auto *rp = res; rp; rp = rp->ai_next)
+    // the attempts of one connect() racing each other. Once the race is settled, a connect still waiting in the runtime
+    // is turned into a no-op when its SQE is prepared, and a socket already connecting is stopped with shutdown(),
+    // which fails its connect at once. Either way every attempt ends through its own completion: the runtime's stop
+    // token cancellation would resume the attempt and free its event before the ring is done with it
+    struct connect_race
     {
+        std::mutex mutex;
+        std::vector<int> connecting;
+        int winner{-1};
+        const webcraft::async::io::socket::socket_address *winning_address{nullptr};
+        int error{0}; // of the last attempt that failed
+        bool timed_out{false};
+        std::exception_ptr failure;
+        std::stop_source settled; // stopped under the lock once there is a winner, a timeout or a failure
+
+        // attempt_done[i] is stopped once attempt i has failed or the race is decided, waking the wait before attempt i + 1
+        std::vector<std::stop_source> attempt_done;
+        std::stop_source over;
+
+        explicit connect_race(size_t attempts) : attempt_done(attempts) {}
+
+        bool decided()
+        {
+            return settled.stop_requested();
+        }
 
-        int family = rp->ai_family;
-        int sock_type = rp->ai_socktype;
-        int protocol = rp->ai_protocol;
-        const sockaddr *addr = rp->ai_addr;
-        const socklen_t len = rp->ai_addrlen;
+        // the caller holds the lock; nothing waits on `settled`, so stopping it runs no callback under the lock
+        void settle()
+        {
+            settled.request_stop();
+            for (int fd : connecting)
+            {
+                ::shutdown(fd, SHUT_RDWR);
+            }
+        }
 
-        int fd = socket(family, sock_type, protocol);
+        // requesting a stop resumes the waits on it right here, so never with the lock held
+        void wake_all()
+        {
+            for (auto &done : attempt_done)
+            {
+                done.request_stop();
+            }
+        }
+
+        void expire()
+        {
+            {
+                std::lock_guard lock(mutex);
+                if (decided())
+                {
+                    return;
+                }
+                timed_out = true;
+                settle();
+            }
+            wake_all();
+        }
+    };
+
+    task<void> connect_attempt(connect_race &race, size_t index, const webcraft::async::io::socket::socket_address &address, const webcraft::async::io::socket::socket_options &options)
+    {
+        int fd = ::socket(address.family(), SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
         if (fd < 0)
         {
-            continue;
+            {
+                std::lock_guard lock(race.mutex);
+                race.error = errno;
+            }
+            race.attempt_done[index].request_stop();
+            co_return;
         }
 
-        // Await io_uring connect
+        bool rejected = false;
+        try
+        {
+            apply_socket_options(fd, options, socket_role::connecting);
+        }
+        catch (...)
+        {
+            std::lock_guard lock(race.mutex);
+            if (!race.failure)
+            {
+                race.failure = std::current_exception(); // every other address would get the same options
+            }
+            race.settle();
+            rejected = true;
+        }
+
+        bool started = false;
+        {
+            std::lock_guard lock(race.mutex);
+            if (!rejected && !race.decided())
+            {
+                race.connecting.push_back(fd);
+                started = true;
+            }
+        }
+        if (!started)
+        {
+            ::close(fd);
+            race.wake_all();
+            co_return;
+        }
+
+        // shutdown() does nothing to a socket whose connect has not been submitted yet, so the race is checked again
+        // when the SQE is prepared
+        const sockaddr *addr = address.data();
+        const socklen_t len = static_cast<socklen_t>(address.size());
         auto event = webcraft::async::detail::as_awaitable(
             webcraft::async::detail::linux::create_io_uring_event(
-                [fd, addr, len](struct io_uring_sqe *sqe)
+                [fd, addr, len, settled = race.settled.get_token()](struct io_uring_sqe *sqe)
                 {
+                    if (settled.stop_requested())
+                    {
+                        io_uring_prep_nop(sqe);
+                        return;
+                    }
                     io_uring_prep_connect(sqe, fd, addr, len);
-                }));
+                },
+                std::stop_token{}));
 
         co_await event;
 
-        if (event.get_result() < 0)
+        int result = event.get_result();
+        bool won = false;
         {
-            ::close(fd);
+            std::lock_guard lock(race.mutex);
+            std::erase(race.connecting, fd);
+            // once the race is settled this attempt lost, whatever its result: the no-op completes with 0 as well
+            if (!race.decided() && result >= 0)
+            {
+                race.winner = fd;
+                race.winning_address = &address;
+                won = true;
+                race.settle();
+            }
+            else if (!race.decided())
+            {
+                race.error = -result;
+            }
+        }
+
+        if (won)
+        {
+            race.wake_all();
         }
         else
         {
-            this->fd = fd;
-            flag = true;
+            ::close(fd); // failed, or connected after another address had already won
+            race.attempt_done[index].request_stop();
+        }
+    }
+
+    task<void> expire_connect(connect_race &race, std::chrono::milliseconds timeout)
+    {
+        co_await sleep_for(timeout, race.over.get_token());
+        if (!race.over.stop_requested())
+        {
+            race.expire();
+        }
+    }
+}
+
+task<void> io_uring_tcp_socket_descriptor::connect(const webcraft::async::io::socket::connection_info &info)
+{
+    this->host = info.host;
+    this->port = info.port;
+
+    std::vector<webcraft::async::io::socket::socket_address> addresses = webcraft::async::io::socket::socket_address::resolve_all(info);
+    co_await connect(addresses);
+}
+
+task<void> io_uring_tcp_socket_descriptor::connect(const std::vector<webcraft::async::io::socket::socket_address> &resolved)
+{
+    if (resolved.empty())
+    {
+        throw std::invalid_argument("No address to connect to");
+    }
+
+    // Happy Eyeballs (RFC 8305): each address gets connect_attempt_delay before the next one is started alongside it,
+    // and an address that fails starts the next one at once. The first to connect wins and the rest are aborted.
+    auto addresses = interleave_families(resolved);
+    connect_race race(addresses.size());
+
+    std::optional<task<void>> deadline;
+    if (options.connect_timeout)
+    {
+        deadline.emplace(expire_connect(race, *options.connect_timeout));
+    }
+
+    std::vector<task<void>> attempts;
+    attempts.reserve(addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++)
+    {
+        if (race.decided())
+        {
             break;
         }
+        attempts.push_back(connect_attempt(race, i, *addresses[i], options));
+        if (i + 1 < addresses.size())
+        {
+            co_await sleep_for(options.connect_attempt_delay, race.attempt_done[i].get_token());
+        }
     }
 
-    freeaddrinfo(res); // Free memory allocated by getaddrinfo
+    for (auto &attempt : attempts)
+    {
+        co_await attempt;
+    }
+    race.over.request_stop();
+    if (deadline)
+    {
+        auto &expiry = *deadline;
+        co_await expiry;
+    }
 
-    if (!flag)
+    if (race.winner >= 0)
     {
-        std::error_code ec(errno, std::system_category());
-        throw std::system_error(ec, "Failed to create socket");
+        this->fd = race.winner;
+        this->peer = *race.winning_address;
+        co_return;
+    }
+    if (race.failure)
+    {
+        std::rethrow_exception(race.failure);
     }
+
+    std::string target = host.empty() ? resolved.front().to_string() : host;
+    if (race.timed_out)
+    {
+        throw std::system_error(std::make_error_code(std::errc::timed_out), "Failed to connect to " + target + ": timed out");
+    }
+    std::error_code ec(race.error ? race.error : ECONNREFUSED, std::system_category());
+    throw std::system_error(ec, "Failed to connect to " + target);
 }
 
 void io_uring_tcp_socket_descriptor::shutdown(webcraft::async::io::socket::socket_stream_mode mode)
@@ -178,17 +386,30 @@ void io_uring_tcp_socket_descriptor::shutdown(webcraft::async::io::socket::socke
 
 std::string io_uring_tcp_socket_descriptor::get_remote_host()
 {
-    return host;
+    // accepted sockets only have the address; it is formatted when somebody asks
+    return host.empty() ? peer.host() : host;
 }
 
 uint16_t io_uring_tcp_socket_descriptor::get_remote_port()
 {
-    return port;
+    return port == 0 ? peer.port() : port;
+}
+
+webcraft::async::io::socket::socket_address io_uring_tcp_socket_descriptor::get_remote_address()
+{
+    return peer;
+}
+
+int io_uring_tcp_socket_descriptor::native_handle() const noexcept
+{
+    return closed.load(std::memory_order_acquire) ? -1 : fd;
 }
 
-std::shared_ptr<tcp_socket_descriptor> webcraft::async::io::socket::detail::make_tcp_socket_descriptor()
+std::shared_ptr<tcp_socket_descriptor> webcraft::async::io::socket::detail::make_tcp_socket_descriptor(socket_options options)
 {
-    return std::make_shared<io_uring_tcp_socket_descriptor>();
+    auto descriptor = std::make_shared<io_uring_tcp_socket_descriptor>();
+    descriptor->set_options(std::move(options));
+    return descriptor;
 }
 
 #elif defined(_WIN32)
@@ -250,6 +471,17 @@ task<void> iocp_tcp_socket_descriptor::connect(const webcraft::async::io::socket
             continue;
         }
 
+        try
+        {
+            apply_socket_options(fd, options, socket_role::connecting);
+        }
+        catch (...)
+        {
+            ::closesocket(fd);
+            freeaddrinfo(res);
+            throw;
+        }
+
         iocp = ::CreateIoCompletionPort((HANDLE)fd, (HANDLE)webcraft::async::detail::get_native_handle(), 0, 0);
 
         if (iocp == nullptr)
@@ -368,9 +600,11 @@ task<void> iocp_tcp_socket_descriptor::close()
     co_return;
 }
 
-std::shared_ptr<tcp_socket_descriptor> webcraft::async::io::socket::detail::make_tcp_socket_descriptor()
+std::shared_ptr<tcp_socket_descriptor> webcraft::async::io::socket::detail::make_tcp_socket_descriptor(socket_options options)
 {
-    return std::make_shared<iocp_tcp_socket_descriptor>();
+    auto descriptor = std::make_shared<iocp_tcp_socket_descriptor>();
+    descriptor->set_options(std::move(options));
+    return descriptor;
 }
 
 #elif defined(__APPLE__)
@@ -480,6 +714,18 @@ task<void> kqueue_tcp_socket_descriptor::connect(const webcraft::async::io::sock
         {
             continue;
         }
+
+        try
+        {
+            apply_socket_options(fd, options, socket_role::connecting);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            freeaddrinfo(res);
+            throw;
+        }
+
         if (::connect(fd, rp->ai_addr, rp->ai_addrlen) < 0)
         {
             ::close(fd);
@@ -630,9 +876,11 @@ void kqueue_tcp_socket_descriptor::try_execute(int result, bool cancelled)
     }
 }
 
-std::shared_ptr<tcp_socket_descriptor> webcraft::async::io::socket::detail::make_tcp_socket_descriptor()
+std::shared_ptr<tcp_socket_descriptor> webcraft::async::io::socket::detail::make_tcp_socket_descriptor(socket_options options)
 {
-    return std::make_shared<kqueue_tcp_socket_descriptor>();
+    auto descriptor = std::make_shared<kqueue_tcp_socket_descriptor>();
+    descriptor->set_options(std::move(options));
+    return descriptor;
 }
 
 #endif
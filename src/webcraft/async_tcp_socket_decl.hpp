@@ -15,6 +15,7 @@
 #include <webcraft/async/thread_pool.hpp>
 #include <webcraft/async/async_event.hpp>
 #include <webcraft/net/util.hpp>
+#include "socket_options_decl.hpp"
 
 using namespace webcraft::async;
 using namespace webcraft::async::io::socket::detail;
@@ -56,12 +57,13 @@ private:
     std::atomic<bool> closed{false};
 
     std::string host;
-    uint16_t port;
+    uint16_t port{0};
+    webcraft::async::io::socket::socket_address peer;
 
 public:
     io_uring_tcp_socket_descriptor();
 
-    io_uring_tcp_socket_descriptor(int fd, std::string host, uint16_t port);
+    io_uring_tcp_socket_descriptor(int fd, webcraft::async::io::socket::socket_address peer);
 
     ~io_uring_tcp_socket_descriptor();
 
@@ -73,11 +75,17 @@ public:
 
     task<void> connect(const webcraft::async::io::socket::connection_info &info) override;
 
+    task<void> connect(const std::vector<webcraft::async::io::socket::socket_address> &addresses) override;
+
     void shutdown(webcraft::async::io::socket::socket_stream_mode mode) override;
 
     std::string get_remote_host() override;
 
     uint16_t get_remote_port() override;
+
+    webcraft::async::io::socket::socket_address get_remote_address() override;
+
+    int native_handle() const noexcept override;
 };
 
 #elif defined(_WIN32)
@@ -0,0 +1,601 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/io.hpp>
+#include <webcraft/async/io/transfer.hpp>
+#include <webcraft/async/runtime.hpp>
+#include <webcraft/async/runtime/linux.event.hpp>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace webcraft::async;
+using namespace webcraft::async::io;
+
+namespace
+{
+    constexpr size_t copy_buffer_size = 64 * 1024;
+    // file to file copies are not paced by a peer, so fewer, larger reads pay off
+    constexpr size_t file_copy_buffer_size = 1024 * 1024;
+
+    task<size_t> send_all(socket::detail::tcp_socket_descriptor &destination, std::span<const char> data)
+    {
+        size_t total = 0;
+        while (total < data.size())
+        {
+            size_t sent = co_await destination.write(data.subspan(total));
+            if (sent == 0)
+            {
+                break;
+            }
+            total += sent;
+        }
+        co_return total;
+    }
+
+    // used when neither side can be spliced; reads sequentially from the descriptor's current position
+    task<size_t> copy_through_buffer(fs::detail::file_descriptor &source, socket::detail::tcp_socket_descriptor &destination, uint64_t skip, size_t length)
+    {
+        std::vector<char> buffer(copy_buffer_size);
+
+        while (skip > 0)
+        {
+            size_t received = co_await source.read(std::span<char>(buffer.data(), std::min<uint64_t>(skip, buffer.size())));
+            if (received == 0)
+            {
+                co_return 0;
+            }
+            skip -= received;
+        }
+
+        size_t total = 0;
+        while (total < length)
+        {
+            size_t received = co_await source.read(std::span<char>(buffer.data(), std::min(length - total, buffer.size())));
+            if (received == 0)
+            {
+                break;
+            }
+            size_t sent = co_await send_all(destination, std::span<const char>(buffer.data(), received));
+            total += sent;
+            if (sent < received)
+            {
+                break;
+            }
+        }
+        co_return total;
+    }
+
+    // writes all of `data` at `offset`; files only accept less on errors, which write_at() reports by throwing
+    task<void> write_all_at(fs::detail::file_descriptor &destination, uint64_t offset, std::span<const char> data)
+    {
+        size_t total = 0;
+        while (total < data.size())
+        {
+            size_t written = co_await destination.write_at(offset + total, data.subspan(total));
+            if (written == 0)
+            {
+                throw std::system_error(std::make_error_code(std::errc::io_error), "Failed to write to file");
+            }
+            total += written;
+        }
+    }
+
+    // copies a range between two files by positional reads and writes through one buffer
+    task<size_t> copy_range_through_buffer(fs::detail::file_descriptor &source, uint64_t source_offset,
+                                           fs::detail::file_descriptor &destination, uint64_t destination_offset, size_t length)
+    {
+        std::vector<char> buffer(std::min(length, file_copy_buffer_size));
+        size_t total = 0;
+        while (total < length)
+        {
+            size_t received = co_await source.read_at(source_offset + total, std::span<char>(buffer.data(), std::min(length - total, buffer.size())));
+            if (received == 0)
+            {
+                break;
+            }
+            co_await write_all_at(destination, destination_offset + total, std::span<const char>(buffer.data(), received));
+            total += received;
+        }
+        co_return total;
+    }
+
+    // relays one direction through a user-space buffer until the source reaches end of stream
+    task<void> copy_between_sockets(socket::detail::tcp_socket_descriptor &from, socket::detail::tcp_socket_descriptor &to, std::atomic<uint64_t> &counter)
+    {
+        std::vector<char> buffer(copy_buffer_size);
+        while (true)
+        {
+            size_t received = co_await from.read(std::span<char>(buffer));
+            if (received == 0)
+            {
+                co_return;
+            }
+            size_t sent = co_await send_all(to, std::span<const char>(buffer.data(), received));
+            counter.fetch_add(sent, std::memory_order_relaxed);
+            if (sent < received)
+            {
+                co_return;
+            }
+        }
+    }
+}
+
+#if defined(__linux__)
+
+namespace
+{
+    struct pipe_pair
+    {
+        int read_end;
+        int write_end;
+        size_t capacity;
+    };
+
+    // Splicing always goes through a pipe. Creating one costs two descriptors and a 64 KiB kernel buffer, so
+    // drained pipes are kept for the next transfer instead of being closed.
+    class pipe_pool
+    {
+    private:
+        static constexpr size_t max_idle = 64;
+        static constexpr int preferred_capacity = 1024 * 1024;
+
+        std::mutex mutex;
+        std::vector<pipe_pair> idle;
+
+    public:
+        ~pipe_pool()
+        {
+            for (auto &p : idle)
+            {
+                ::close(p.read_end);
+                ::close(p.write_end);
+            }
+        }
+
+        std::optional<pipe_pair> acquire()
+        {
+            {
+                std::lock_guard lock(mutex);
+                if (!idle.empty())
+                {
+                    pipe_pair p = idle.back();
+                    idle.pop_back();
+                    return p;
+                }
+            }
+
+            int fds[2];
+            if (::pipe2(fds, O_CLOEXEC) != 0)
+            {
+                return std::nullopt; // out of descriptors, the caller copies instead
+            }
+
+            // a bigger pipe means fewer round trips; unprivileged processes may be capped, which is fine
+            ::fcntl(fds[1], F_SETPIPE_SZ, preferred_capacity);
+            int capacity = ::fcntl(fds[1], F_GETPIPE_SZ);
+            return pipe_pair{fds[0], fds[1], capacity > 0 ? static_cast<size_t>(capacity) : 64 * 1024};
+        }
+
+        // a pipe that still holds data cannot be handed to another transfer
+        void release(pipe_pair p, bool drained)
+        {
+            if (drained)
+            {
+                std::lock_guard lock(mutex);
+                if (idle.size() < max_idle)
+                {
+                    idle.push_back(p);
+                    return;
+                }
+            }
+            ::close(p.read_end);
+            ::close(p.write_end);
+        }
+
+        static pipe_pool &shared()
+        {
+            static pipe_pool pool;
+            return pool;
+        }
+    };
+
+    class pipe_lease
+    {
+    private:
+        pipe_pair p;
+
+    public:
+        bool drained{true};
+
+        explicit pipe_lease(pipe_pair p) : p(p) {}
+        pipe_lease(const pipe_lease &) = delete;
+        pipe_lease &operator=(const pipe_lease &) = delete;
+        ~pipe_lease() { pipe_pool::shared().release(p, drained); }
+
+        const pipe_pair *operator->() const { return &p; }
+    };
+
+    task<int> splice_once(int fd_in, int64_t offset_in, int fd_out, int64_t offset_out, size_t length, unsigned int flags)
+    {
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([=](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_splice(sqe, fd_in, offset_in, fd_out, offset_out, static_cast<unsigned int>(length), flags); }));
+        co_await event;
+        int result = event.get_result();
+        co_return result;
+    }
+
+    // waits for the socket to have data (or hang up) as a poll, which holds no io-wq worker while the peer is idle
+    task<int> poll_readable(int fd)
+    {
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([=](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_poll_add(sqe, fd, POLLIN); }));
+        co_await event;
+        int result = event.get_result();
+        co_return result;
+    }
+
+    task<int> read_once(int fd, std::span<char> buffer, int64_t offset)
+    {
+        auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([=](struct io_uring_sqe *sqe)
+                                                                                                                 { io_uring_prep_read(sqe, fd, buffer.data(), buffer.size(), offset); }));
+        co_await event;
+        int result = event.get_result();
+        co_return result;
+    }
+
+    // errors that mean "this pair of descriptors cannot be spliced", as opposed to a broken connection or file
+    bool splice_refused(int error)
+    {
+        return error == EINVAL || error == EOPNOTSUPP || error == ENOSYS;
+    }
+
+    [[noreturn]] void throw_transfer_error(int error, const char *what)
+    {
+        throw std::system_error(std::error_code(error, std::system_category()), what);
+    }
+
+    // copies through user space but still reads at an explicit offset, for when splice was refused midway
+    task<size_t> copy_at(int source, std::optional<uint64_t> &offset, socket::detail::tcp_socket_descriptor &destination, size_t length)
+    {
+        std::vector<char> buffer(copy_buffer_size);
+        size_t total = 0;
+        while (total < length)
+        {
+            int64_t read_offset = offset ? static_cast<int64_t>(*offset) : -1;
+            int received = co_await read_once(source, std::span<char>(buffer.data(), std::min(length - total, buffer.size())), read_offset);
+            if (received < 0)
+            {
+                throw_transfer_error(-received, "Failed to read from file");
+            }
+            if (received == 0)
+            {
+                break;
+            }
+            if (offset)
+            {
+                *offset += received;
+            }
+
+            size_t sent = co_await send_all(destination, std::span<const char>(buffer.data(), received));
+            total += sent;
+            if (sent < static_cast<size_t>(received))
+            {
+                break;
+            }
+        }
+        co_return total;
+    }
+
+    // sends whatever a refused splice left behind in the pipe before switching to copying
+    task<size_t> drain_pipe(pipe_lease &pipe, size_t pending, socket::detail::tcp_socket_descriptor &destination)
+    {
+        std::vector<char> buffer(std::min(pending, copy_buffer_size));
+        size_t total = 0;
+        while (pending > 0)
+        {
+            int received = co_await read_once(pipe->read_end, std::span<char>(buffer.data(), std::min(pending, buffer.size())), -1);
+            if (received <= 0)
+            {
+                throw_transfer_error(received < 0 ? -received : EIO, "Failed to drain splice pipe");
+            }
+            pending -= received;
+
+            size_t sent = co_await send_all(destination, std::span<const char>(buffer.data(), received));
+            total += sent;
+            if (sent < static_cast<size_t>(received))
+            {
+                co_return total; // the pipe keeps the rest and is closed instead of being pooled
+            }
+        }
+        pipe.drained = true;
+        co_return total;
+    }
+
+    // writes whatever a refused splice left behind in the pipe into the file before switching to copying
+    task<void> drain_pipe_to_file(pipe_lease &pipe, size_t pending, fs::detail::file_descriptor &destination, uint64_t offset)
+    {
+        std::vector<char> buffer(std::min(pending, copy_buffer_size));
+        while (pending > 0)
+        {
+            int received = co_await read_once(pipe->read_end, std::span<char>(buffer.data(), std::min(pending, buffer.size())), -1);
+            if (received <= 0)
+            {
+                throw_transfer_error(received < 0 ? -received : EIO, "Failed to drain splice pipe");
+            }
+            co_await write_all_at(destination, offset, std::span<const char>(buffer.data(), received));
+            offset += received;
+            pending -= received;
+        }
+        pipe.drained = true;
+    }
+}
+
+task<size_t> webcraft::async::io::detail::transfer_file_to_socket(fs::detail::file_descriptor &source, socket::detail::tcp_socket_descriptor &destination,
+                                                                  std::optional<uint64_t> offset, size_t length)
+{
+    int source_fd = source.native_handle();
+    int destination_fd = destination.native_handle();
+    if (source_fd < 0)
+    {
+        size_t copied = co_await copy_through_buffer(source, destination, offset.value_or(0), length);
+        co_return copied;
+    }
+
+    auto acquired = destination_fd < 0 ? std::nullopt : pipe_pool::shared().acquire();
+    if (!acquired)
+    {
+        size_t copied = co_await copy_at(source_fd, offset, destination, length);
+        co_return copied;
+    }
+
+    pipe_lease pipe(*acquired);
+    size_t total = 0;
+    bool refused = false;
+
+    while (total < length)
+    {
+        size_t chunk = std::min(length - total, pipe->capacity);
+        int64_t splice_offset = offset ? static_cast<int64_t>(*offset) : -1;
+
+        int filled = co_await splice_once(source_fd, splice_offset, pipe->write_end, -1, chunk, SPLICE_F_MOVE);
+        if (filled < 0)
+        {
+            if (splice_refused(-filled))
+            {
+                refused = true;
+                break;
+            }
+            throw_transfer_error(-filled, "Failed to splice from file");
+        }
+        if (filled == 0)
+        {
+            break; // end of file
+        }
+        if (offset)
+        {
+            *offset += filled;
+        }
+
+        pipe.drained = false;
+        size_t pending = filled;
+        bool more = total + filled < length;
+        while (pending > 0)
+        {
+            int sent = co_await splice_once(pipe->read_end, -1, destination_fd, -1, pending, SPLICE_F_MOVE | (more ? SPLICE_F_MORE : 0));
+            if (sent < 0 && splice_refused(-sent))
+            {
+                size_t drained = co_await drain_pipe(pipe, pending, destination);
+                total += drained;
+                if (!pipe.drained)
+                {
+                    co_return total;
+                }
+                refused = true;
+                pending = 0;
+                break;
+            }
+            if (sent < 0)
+            {
+                throw_transfer_error(-sent, "Failed to splice to socket");
+            }
+            if (sent == 0)
+            {
+                co_return total; // the peer stopped accepting data, the pipe is closed instead of being pooled
+            }
+            pending -= sent;
+            total += sent;
+        }
+        if (refused)
+        {
+            break;
+        }
+        pipe.drained = true;
+    }
+
+    if (refused && total < length)
+    {
+        size_t copied = co_await copy_at(source_fd, offset, destination, length - total);
+        total += copied;
+    }
+
+    co_return total;
+}
+
+task<size_t> webcraft::async::io::detail::transfer_file_range(fs::detail::file_descriptor &source, uint64_t source_offset,
+                                                              fs::detail::file_descriptor &destination, uint64_t destination_offset, size_t length)
+{
+    int source_fd = source.native_handle();
+    int destination_fd = destination.native_handle();
+    auto acquired = source_fd < 0 || destination_fd < 0 ? std::nullopt : pipe_pool::shared().acquire();
+    if (!acquired)
+    {
+        size_t copied = co_await copy_range_through_buffer(source, source_offset, destination, destination_offset, length);
+        co_return copied;
+    }
+
+    pipe_lease pipe(*acquired);
+    size_t total = 0;
+    bool refused = false;
+
+    while (total < length)
+    {
+        size_t chunk = std::min(length - total, pipe->capacity);
+        int filled = co_await splice_once(source_fd, static_cast<int64_t>(source_offset + total), pipe->write_end, -1, chunk, SPLICE_F_MOVE);
+        if (filled < 0)
+        {
+            if (splice_refused(-filled))
+            {
+                refused = true;
+                break;
+            }
+            throw_transfer_error(-filled, "Failed to splice from file");
+        }
+        if (filled == 0)
+        {
+            break; // end of file
+        }
+
+        pipe.drained = false;
+        size_t pending = filled;
+        while (pending > 0)
+        {
+            int written = co_await splice_once(pipe->read_end, -1, destination_fd, static_cast<int64_t>(destination_offset + total), pending, SPLICE_F_MOVE);
+            if (written < 0 && splice_refused(-written))
+            {
+                co_await drain_pipe_to_file(pipe, pending, destination, destination_offset + total);
+                total += pending;
+                refused = true;
+                break;
+            }
+            if (written <= 0)
+            {
+                throw_transfer_error(written < 0 ? -written : EIO, "Failed to splice to file");
+            }
+            pending -= written;
+            total += written;
+        }
+        if (refused)
+        {
+            break;
+        }
+        pipe.drained = true;
+    }
+
+    if (refused && total < length)
+    {
+        size_t copied = co_await copy_range_through_buffer(source, source_offset + total, destination, destination_offset + total, length - total);
+        total += copied;
+    }
+
+    co_return total;
+}
+
+task<void> webcraft::async::io::detail::splice_sockets(socket::detail::tcp_socket_descriptor &from, socket::detail::tcp_socket_descriptor &to, std::atomic<uint64_t> &counter)
+{
+    int from_fd = from.native_handle();
+    int to_fd = to.native_handle();
+
+    auto acquired = from_fd < 0 || to_fd < 0 ? std::nullopt : pipe_pool::shared().acquire();
+    if (acquired)
+    {
+        pipe_lease pipe(*acquired);
+        bool refused = false;
+
+        while (!refused)
+        {
+            // io_uring always runs a splice on an io-wq worker, so it is only issued once the socket has data
+            int ready = co_await poll_readable(from_fd);
+            if (ready < 0)
+            {
+                throw_transfer_error(-ready, "Failed to wait for socket data");
+            }
+
+            int filled = co_await splice_once(from_fd, -1, pipe->write_end, -1, pipe->capacity, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (filled == -EAGAIN)
+            {
+                continue; // the data was taken or the wakeup was spurious
+            }
+            if (filled < 0)
+            {
+                if (splice_refused(-filled))
+                {
+                    break;
+                }
+                throw_transfer_error(-filled, "Failed to splice from socket");
+            }
+            if (filled == 0)
+            {
+                co_return; // end of stream
+            }
+
+            pipe.drained = false;
+            size_t pending = filled;
+            while (pending > 0)
+            {
+                int sent = co_await splice_once(pipe->read_end, -1, to_fd, -1, pending, SPLICE_F_MOVE);
+                if (sent < 0 && splice_refused(-sent))
+                {
+                    size_t drained = co_await drain_pipe(pipe, pending, to);
+                    counter.fetch_add(drained, std::memory_order_relaxed);
+                    if (!pipe.drained)
+                    {
+                        co_return;
+                    }
+                    refused = true;
+                    break;
+                }
+                if (sent < 0)
+                {
+                    throw_transfer_error(-sent, "Failed to splice to socket");
+                }
+                if (sent == 0)
+                {
+                    co_return; // the peer stopped accepting data, the pipe is closed instead of being pooled
+                }
+                pending -= sent;
+                counter.fetch_add(sent, std::memory_order_relaxed);
+            }
+            if (!refused)
+            {
+                pipe.drained = true;
+            }
+        }
+    }
+
+    co_await copy_between_sockets(from, to, counter);
+}
+
+#else
+
+task<size_t> webcraft::async::io::detail::transfer_file_to_socket(fs::detail::file_descriptor &source, socket::detail::tcp_socket_descriptor &destination,
+                                                                  std::optional<uint64_t> offset, size_t length)
+{
+    // no splice outside Linux yet: sendfile/TransmitFile would need their own event types
+    size_t copied = co_await copy_through_buffer(source, destination, offset.value_or(0), length);
+    co_return copied;
+}
+
+task<size_t> webcraft::async::io::detail::transfer_file_range(fs::detail::file_descriptor &source, uint64_t source_offset,
+                                                              fs::detail::file_descriptor &destination, uint64_t destination_offset, size_t length)
+{
+    size_t copied = co_await copy_range_through_buffer(source, source_offset, destination, destination_offset, length);
+    co_return copied;
+}
+
+task<void> webcraft::async::io::detail::splice_sockets(socket::detail::tcp_socket_descriptor &from, socket::detail::tcp_socket_descriptor &to, std::atomic<uint64_t> &counter)
+{
+    co_await copy_between_sockets(from, to, counter);
+}
+
+#endif
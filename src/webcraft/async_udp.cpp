@@ -14,6 +14,7 @@
 #include <webcraft/async/async_event.hpp>
 #include <webcraft/net/util.hpp>
 #include <system_error>
+#include "socket_options_decl.hpp"
 
 using namespace webcraft::async;
 using namespace webcraft::async::io::socket::detail;
@@ -162,6 +163,16 @@ private:
                 std::error_code ec(err, std::system_category());
                 throw std::system_error(ec, "Failed to create UDP socket");
             }
+
+            try
+            {
+                apply_socket_options(socket, options, socket_role::datagram);
+            }
+            catch (...)
+            {
+                close_socket();
+                throw;
+            }
         }
     }
 
@@ -176,7 +187,7 @@ private:
     }
 
 public:
-    mock_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version) : webcraft::async::io::socket::detail::udp_socket_descriptor(version), socket(-1)
+    mock_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version, webcraft::async::io::socket::socket_options options) : webcraft::async::io::socket::detail::udp_socket_descriptor(version, std::move(options)), socket(-1)
     {
         create_socket_if_not_exists(version);
     }
@@ -235,14 +246,11 @@ public:
                 continue;
             }
 
-#ifndef _WIN32
-            int opt = 1;
-            if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+            if (!apply_bind_options(fd, options))
             {
                 close_socket();
                 continue;
             }
-#endif
 
             // Await io_uring bind
             int result = ::bind(fd, addr, len);
@@ -267,6 +275,16 @@ public:
             std::error_code ec(get_last_socket_error(), std::system_category());
             throw std::system_error(ec, "Failed to create socket");
         }
+
+        try
+        {
+            apply_socket_options(this->socket, options, socket_role::datagram);
+        }
+        catch (...)
+        {
+            close_socket();
+            throw;
+        }
     }
 
     task<size_t> recvfrom(std::span<char> buffer, webcraft::async::io::socket::connection_info &info) override
@@ -317,9 +335,9 @@ public:
     }
 };
 
-std::shared_ptr<webcraft::async::io::socket::detail::udp_socket_descriptor> webcraft::async::io::socket::detail::make_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version)
+std::shared_ptr<webcraft::async::io::socket::detail::udp_socket_descriptor> webcraft::async::io::socket::detail::make_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version, webcraft::async::io::socket::socket_options options)
 {
-    return std::make_shared<mock_udp_socket_descriptor>(version);
+    return std::make_shared<mock_udp_socket_descriptor>(version, std::move(options));
 }
 #elif defined(_WIN32)
 
@@ -381,6 +399,16 @@ private:
                 throw webcraft::async::detail::windows::overlapped_winsock2_runtime_error("Failed to create UDP socket");
             }
 
+            try
+            {
+                apply_socket_options(socket, options, socket_role::datagram);
+            }
+            catch (...)
+            {
+                close_socket();
+                throw;
+            }
+
             associate_with_iocp(socket);
         }
     }
@@ -392,7 +420,7 @@ private:
     }
 
 public:
-    iocp_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version) : webcraft::async::io::socket::detail::udp_socket_descriptor(version), socket(INVALID_SOCKET)
+    iocp_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version, webcraft::async::io::socket::socket_options options) : webcraft::async::io::socket::detail::udp_socket_descriptor(version, std::move(options)), socket(INVALID_SOCKET)
     {
         create_socket_if_not_exists(version);
     }
@@ -475,6 +503,16 @@ public:
         {
             throw webcraft::async::detail::windows::overlapped_winsock2_runtime_error("Failed to create UDP socket");
         }
+
+        try
+        {
+            apply_socket_options(this->socket, options, socket_role::datagram);
+        }
+        catch (...)
+        {
+            close_socket();
+            throw;
+        }
     }
 
     task<size_t> recvfrom(std::span<char> buffer, webcraft::async::io::socket::connection_info &info) override
@@ -649,9 +687,9 @@ public:
     }
 };
 
-std::shared_ptr<webcraft::async::io::socket::detail::udp_socket_descriptor> webcraft::async::io::socket::detail::make_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version)
+std::shared_ptr<webcraft::async::io::socket::detail::udp_socket_descriptor> webcraft::async::io::socket::detail::make_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version, webcraft::async::io::socket::socket_options options)
 {
-    return std::make_shared<iocp_udp_socket_descriptor>(version);
+    return std::make_shared<iocp_udp_socket_descriptor>(version, std::move(options));
 }
 
 #elif defined(__linux__)
@@ -696,6 +734,16 @@ private:
                 std::error_code ec(errno, std::system_category());
                 throw std::system_error(ec, "Failed to create UDP socket");
             }
+
+            try
+            {
+                apply_socket_options(socket, options, socket_role::datagram);
+            }
+            catch (...)
+            {
+                close_socket();
+                throw;
+            }
         }
     }
 
@@ -706,7 +754,7 @@ private:
     }
 
 public:
-    io_uring_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version) : webcraft::async::io::socket::detail::udp_socket_descriptor(version), socket(-1)
+    io_uring_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version, webcraft::async::io::socket::socket_options options) : webcraft::async::io::socket::detail::udp_socket_descriptor(version, std::move(options)), socket(-1)
     {
         create_socket_if_not_exists(version);
     }
@@ -765,8 +813,7 @@ public:
                 continue;
             }
 
-            int opt = 1;
-            if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0)
+            if (!apply_bind_options(fd, options))
             {
                 close_socket();
                 continue;
@@ -795,25 +842,73 @@ public:
             std::error_code ec(errno, std::system_category());
             throw std::system_error(ec, "Failed to create socket");
         }
+
+        try
+        {
+            apply_socket_options(this->socket, options, socket_role::datagram);
+        }
+        catch (...)
+        {
+            close_socket();
+            throw;
+        }
+    }
+
+    void bind(const webcraft::async::io::socket::socket_address &address) override
+    {
+        close_socket();
+
+        int fd = ::socket(address.family(), SOCK_DGRAM, IPPROTO_UDP);
+        if (fd < 0)
+        {
+            std::error_code ec(errno, std::system_category());
+            throw std::system_error(ec, "Failed to create UDP socket");
+        }
+
+        if (!apply_bind_options(fd, options) || ::bind(fd, address.data(), static_cast<socklen_t>(address.size())) < 0)
+        {
+            std::error_code ec(errno, std::system_category());
+            ::close(fd);
+            throw std::system_error(ec, "Failed to bind to " + address.to_string());
+        }
+        this->socket = fd;
+
+        try
+        {
+            apply_socket_options(this->socket, options, socket_role::datagram);
+        }
+        catch (...)
+        {
+            close_socket();
+            throw;
+        }
     }
 
     task<size_t> recvfrom(std::span<char> buffer, webcraft::async::io::socket::connection_info &info) override
+    {
+        webcraft::async::io::socket::socket_address from;
+        size_t received = co_await recvfrom(buffer, from);
+        if (!from.empty())
+        {
+            info = from.to_connection_info();
+        }
+        co_return received;
+    }
+
+    task<size_t> recvfrom(std::span<char> buffer, webcraft::async::io::socket::socket_address &from) override
     {
         if (closed)
             co_return 0;
 
-        sockaddr_storage addr;
-        socklen_t addr_len = sizeof(addr);
-
         // setup iovec for the buffer
         iovec iov;
         iov.iov_base = buffer.data();
         iov.iov_len = buffer.size();
 
-        // set up msghdr
+        // set up msghdr; the kernel writes the sender straight into `from`
         msghdr msg{};
-        msg.msg_name = &addr;
-        msg.msg_namelen = addr_len;
+        msg.msg_name = from.data();
+        msg.msg_namelen = static_cast<socklen_t>(from.capacity());
         msg.msg_iov = &iov;
         msg.msg_iovlen = 1;
         msg.msg_control = nullptr;
@@ -832,16 +927,11 @@ public:
 
         if (event.get_result() < 0)
         {
-            std::error_code ec(errno, std::system_category());
+            std::error_code ec(-event.get_result(), std::system_category());
             throw std::system_error(ec, "Failed to receive data");
         }
 
-        // Extract connection info
-        auto [host, port] = webcraft::net::util::addr_to_host_port(addr);
-
-        info.host = host;
-        info.port = port;
-
+        from.resize(msg.msg_namelen);
         co_return event.get_result();
     }
 
@@ -881,6 +971,32 @@ public:
         co_return bytes_sent;
     }
 
+    task<size_t> sendto(std::span<const char> buffer, const webcraft::async::io::socket::socket_address &to) override
+    {
+        if (closed)
+            co_return 0;
+
+        int socket = this->socket;
+        const sockaddr *addr = to.data();
+        socklen_t len = static_cast<socklen_t>(to.size());
+        auto event = webcraft::async::detail::as_awaitable(
+            webcraft::async::detail::linux::create_io_uring_event(
+                [socket, buffer, addr, len](struct io_uring_sqe *sqe)
+                {
+                    io_uring_prep_sendto(sqe, socket, buffer.data(), buffer.size(), 0, addr, len);
+                }));
+
+        co_await event;
+
+        if (event.get_result() < 0)
+        {
+            std::error_code ec(-event.get_result(), std::system_category());
+            throw std::system_error(ec, "Failed to send data to " + to.to_string());
+        }
+
+        co_return event.get_result();
+    }
+
     void join_group(const webcraft::async::io::socket::multicast_group &group, const webcraft::async::io::socket::multicast_join_options &) override
     {
         if (socket < 0) return;
@@ -940,9 +1056,9 @@ public:
     }
 };
 
-std::shared_ptr<webcraft::async::io::socket::detail::udp_socket_descriptor> webcraft::async::io::socket::detail::make_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version)
+std::shared_ptr<webcraft::async::io::socket::detail::udp_socket_descriptor> webcraft::async::io::socket::detail::make_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version, webcraft::async::io::socket::socket_options options)
 {
-    return std::make_shared<io_uring_udp_socket_descriptor>(version);
+    return std::make_shared<io_uring_udp_socket_descriptor>(version, std::move(options));
 }
 
 #elif defined(__APPLE__)
@@ -981,6 +1097,17 @@ private:
                 throw std::system_error(ec, "Failed to create UDP socket");
             }
 
+            try
+            {
+                apply_socket_options(socket, options, socket_role::datagram);
+            }
+            catch (...)
+            {
+                ::close(socket); // not registered with the queue yet
+                socket = -1;
+                throw;
+            }
+
             // Enable multicast loopback on macOS so that send/receive on the same host
             // works (e.g. TestMulticastSendReceive). Without this, multicast packets
             // sent by the sender are not delivered to local receivers.
@@ -1013,7 +1140,7 @@ private:
     }
 
 public:
-    kqueue_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version) : webcraft::async::io::socket::detail::udp_socket_descriptor(version), socket(-1)
+    kqueue_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version, webcraft::async::io::socket::socket_options options) : webcraft::async::io::socket::detail::udp_socket_descriptor(version, std::move(options)), socket(-1)
     {
         create_socket_if_not_exists(version);
     }
@@ -1073,8 +1200,7 @@ public:
             }
 
             // Reuse address is often useful for UDP
-            int on = 1;
-            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+            apply_bind_options(fd, options);
 
             // Await io_uring bind
             int result = ::bind(fd, addr, len);
@@ -1100,6 +1226,17 @@ public:
             throw std::system_error(ec, "Failed to create socket");
         }
 
+        try
+        {
+            apply_socket_options(this->socket, options, socket_role::datagram);
+        }
+        catch (...)
+        {
+            ::close(this->socket);
+            this->socket = -1;
+            throw;
+        }
+
         register_with_queue();
     }
 
@@ -1298,9 +1435,9 @@ public:
     }
 };
 
-std::shared_ptr<webcraft::async::io::socket::detail::udp_socket_descriptor> webcraft::async::io::socket::detail::make_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version)
+std::shared_ptr<webcraft::async::io::socket::detail::udp_socket_descriptor> webcraft::async::io::socket::detail::make_udp_socket_descriptor(std::optional<webcraft::async::io::socket::ip_version> version, webcraft::async::io::socket::socket_options options)
 {
-    return std::make_shared<kqueue_udp_socket_descriptor>(version);
+    return std::make_shared<kqueue_udp_socket_descriptor>(version, std::move(options));
 }
 
 #endif
\ No newline at end of file
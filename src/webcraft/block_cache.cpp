@@ -0,0 +1,450 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/block_cache.hpp>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace webcraft::async;
+using namespace webcraft::async::io;
+using namespace webcraft::async::io::fs;
+
+namespace
+{
+    struct block_key
+    {
+        uint64_t file;
+        uint64_t index;
+
+        bool operator==(const block_key &) const = default;
+    };
+
+    struct block_key_hash
+    {
+        size_t operator()(const block_key &key) const noexcept
+        {
+            // splitmix64 finaliser, so that consecutive blocks of one file land on different shards
+            uint64_t x = key.file * 0x9E3779B97F4A7C15ull + key.index;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+            return static_cast<size_t>(x ^ (x >> 31));
+        }
+    };
+
+    struct cached_block
+    {
+        std::vector<char> data; // shorter than a block only at the end of the file
+        std::exception_ptr error;
+        // both guarded by the shard's mutex until ready is set, after which data and error are read without it
+        bool ready{false};
+        bool abandoned{false}; // the fetch loading it was destroyed before the read finished
+        std::vector<std::coroutine_handle<>> waiters;
+    };
+
+    struct cache_shard
+    {
+        struct slot
+        {
+            block_key key;
+            std::shared_ptr<cached_block> block;
+            bool referenced;
+        };
+
+        std::mutex mutex;
+        std::list<slot> ring;
+        std::list<slot>::iterator hand{ring.end()};
+        std::unordered_map<block_key, std::list<slot>::iterator, block_key_hash> index;
+        size_t bytes{0};   // blocks being read count as a whole block until they are done
+        size_t budget{0};
+    };
+}
+
+struct webcraft::async::io::fs::detail::block_cache_state
+{
+    block_cache_options options;
+    std::vector<std::unique_ptr<cache_shard>> shards;
+
+    std::mutex files_mutex;
+    std::unordered_map<std::string, uint64_t> file_ids;
+    uint64_t next_file_id{1};
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> coalesced{0};
+    std::atomic<uint64_t> evictions{0};
+
+    cache_shard &shard_for(const block_key &key) noexcept
+    {
+        return *shards[block_key_hash{}(key) & (shards.size() - 1)];
+    }
+
+    uint64_t id_for(const std::filesystem::path &p, bool fresh)
+    {
+        std::string key = std::filesystem::absolute(p).lexically_normal().string();
+        std::lock_guard lock(files_mutex);
+        auto [it, inserted] = file_ids.try_emplace(key, 0);
+        if (inserted || fresh)
+        {
+            it->second = next_file_id++;
+        }
+        return it->second;
+    }
+};
+
+namespace
+{
+    using webcraft::async::io::fs::detail::block_cache_state;
+
+    // makes room for `incoming` bytes by sweeping the hand over the ring: a referenced block has its bit cleared and
+    // is passed over once, an unreferenced one is dropped, a block still being read is left alone
+    void evict(block_cache_state &state, cache_shard &shard, size_t incoming)
+    {
+        size_t steps = 2 * shard.ring.size();
+        while (shard.bytes + incoming > shard.budget && !shard.ring.empty() && steps-- > 0)
+        {
+            if (shard.hand == shard.ring.end())
+            {
+                shard.hand = shard.ring.begin();
+            }
+
+            auto &slot = *shard.hand;
+            if (!slot.block->ready || slot.referenced)
+            {
+                slot.referenced = false;
+                ++shard.hand;
+                continue;
+            }
+
+            shard.bytes -= slot.block->data.size();
+            shard.index.erase(slot.key);
+            shard.hand = shard.ring.erase(shard.hand);
+            state.evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // publishes the outcome of a read and resumes whoever coalesced onto it, on this thread and without the lock;
+    // they are taken one at a time, so a waiter destroyed by an earlier one's resumption is already off the list
+    void complete(block_cache_state &state, cache_shard &shard, const block_key &key, const std::shared_ptr<cached_block> &block)
+    {
+        {
+            std::lock_guard lock(shard.mutex);
+            block->ready = true;
+
+            auto it = shard.index.find(key);
+            if (it != shard.index.end() && it->second->block == block)
+            {
+                shard.bytes -= state.options.block_size;
+                if (block->error)
+                {
+                    // not cached, so that the next read tries again
+                    if (shard.hand == it->second)
+                    {
+                        ++shard.hand;
+                    }
+                    shard.ring.erase(it->second);
+                    shard.index.erase(it);
+                }
+                else
+                {
+                    shard.bytes += block->data.size();
+                    evict(state, shard, 0);
+                }
+            }
+        }
+
+        while (true)
+        {
+            std::coroutine_handle<> waiter;
+            {
+                std::lock_guard lock(shard.mutex);
+                if (block->waiters.empty())
+                {
+                    break;
+                }
+                waiter = block->waiters.front();
+                block->waiters.erase(block->waiters.begin());
+            }
+            waiter.resume();
+        }
+    }
+
+    // completes the block however the load ends; a loading fetch destroyed mid-read fails it, so it leaves the index and
+    // the readers that coalesced onto it wake up and start a read of their own
+    struct block_load
+    {
+        block_cache_state &state;
+        cache_shard &shard;
+        const block_key &key;
+        const std::shared_ptr<cached_block> &block;
+        bool completed{false};
+
+        block_load(block_cache_state &state, cache_shard &shard, const block_key &key, const std::shared_ptr<cached_block> &block)
+            : state(state), shard(shard), key(key), block(block) {}
+        block_load(const block_load &) = delete;
+        block_load &operator=(const block_load &) = delete;
+
+        ~block_load()
+        {
+            if (!completed)
+            {
+                block->abandoned = true;
+                block->error = std::make_exception_ptr(std::system_error(std::make_error_code(std::errc::operation_canceled), "The read loading this block was dropped"));
+                complete(state, shard, key, block);
+            }
+        }
+
+        void finish()
+        {
+            completed = true;
+            complete(state, shard, key, block);
+        }
+    };
+
+    struct block_ready
+    {
+        cache_shard &shard;
+        cached_block &block;
+        std::coroutine_handle<> waiter{};
+
+        block_ready(cache_shard &shard, cached_block &block) : shard(shard), block(block) {}
+        block_ready(const block_ready &) = delete;
+        block_ready &operator=(const block_ready &) = delete;
+
+        // a coalesced read dropped while waiting must not be left behind for complete() to resume
+        ~block_ready()
+        {
+            if (waiter)
+            {
+                std::lock_guard lock(shard.mutex);
+                std::erase(block.waiters, waiter);
+            }
+        }
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            std::lock_guard lock(shard.mutex);
+            if (block.ready)
+            {
+                return false;
+            }
+            block.waiters.push_back(h);
+            waiter = h;
+            return true;
+        }
+
+        void await_resume() noexcept
+        {
+            waiter = {};
+        }
+    };
+
+    task<std::shared_ptr<cached_block>> fetch(block_cache_state &state, random_access_file &file, block_key key)
+    {
+        cache_shard &shard = state.shard_for(key);
+        while (true)
+        {
+            std::shared_ptr<cached_block> block;
+            bool load = false;
+            bool ready = false;
+            {
+                std::lock_guard lock(shard.mutex);
+                auto it = shard.index.find(key);
+                if (it != shard.index.end())
+                {
+                    it->second->referenced = true;
+                    block = it->second->block;
+                    ready = block->ready;
+                }
+                else
+                {
+                    evict(state, shard, state.options.block_size);
+                    block = std::make_shared<cached_block>();
+                    // behind the hand, so the new block is the last the next sweep reaches
+                    auto slot = shard.ring.insert(shard.hand, {key, block, false});
+                    shard.index.emplace(key, slot);
+                    shard.bytes += state.options.block_size;
+                    load = true;
+                }
+            }
+
+            if (load)
+            {
+                state.misses.fetch_add(1, std::memory_order_relaxed);
+                block_load loading{state, shard, key, block};
+                try
+                {
+                    block->data.resize(state.options.block_size);
+                    size_t received = co_await file.read_at(key.index * state.options.block_size, block->data);
+                    block->data.resize(received);
+                    block->data.shrink_to_fit();
+                }
+                catch (...)
+                {
+                    block->error = std::current_exception();
+                }
+                loading.finish();
+            }
+            else if (ready)
+            {
+                state.hits.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                state.coalesced.fetch_add(1, std::memory_order_relaxed);
+                block_ready wait{shard, *block};
+                co_await wait;
+                if (block->abandoned)
+                {
+                    continue; // the read this one was waiting on was dropped, so start one of its own
+                }
+            }
+
+            if (block->error)
+            {
+                std::rethrow_exception(block->error);
+            }
+            co_return block;
+        }
+    }
+}
+
+block_cache::block_cache(block_cache_options options)
+{
+    if (options.block_size == 0)
+    {
+        throw std::invalid_argument("The block cache needs a non-zero block size");
+    }
+
+    size_t shards = options.shards ? options.shards : std::max(1u, std::thread::hardware_concurrency());
+    shards = std::bit_ceil(shards);
+
+    state = std::make_shared<detail::block_cache_state>();
+    state->options = options;
+    state->shards.reserve(shards);
+    for (size_t i = 0; i < shards; i++)
+    {
+        auto shard = std::make_unique<cache_shard>();
+        // every shard can hold at least one block, otherwise a tiny budget would cache nothing at all
+        shard->budget = std::max(options.capacity / shards, options.block_size);
+        state->shards.push_back(std::move(shard));
+    }
+}
+
+task<cached_file> block_cache::open(file f)
+{
+    uint64_t id = state->id_for(f.get_path(), false);
+    auto opened = co_await f.open_random_access();
+    co_return cached_file(std::move(opened), state, id);
+}
+
+task<cached_rstream> block_cache::open_readable_stream(file f, uint64_t offset)
+{
+    auto opened = co_await open(std::move(f));
+    co_return cached_rstream(std::move(opened), offset);
+}
+
+void block_cache::invalidate(const std::filesystem::path &p)
+{
+    state->id_for(p, true);
+}
+
+block_cache_stats block_cache::stats() const
+{
+    block_cache_stats stats{
+        .hits = state->hits.load(std::memory_order_relaxed),
+        .misses = state->misses.load(std::memory_order_relaxed),
+        .coalesced = state->coalesced.load(std::memory_order_relaxed),
+        .evictions = state->evictions.load(std::memory_order_relaxed),
+        .bytes = 0,
+    };
+    for (auto &shard : state->shards)
+    {
+        std::lock_guard lock(shard->mutex);
+        stats.bytes += shard->bytes;
+    }
+    return stats;
+}
+
+size_t block_cache::block_size() const noexcept
+{
+    return state->options.block_size;
+}
+
+task<size_t> cached_file::read_at(uint64_t offset, std::span<char> buffer)
+{
+    if (buffer.empty())
+    {
+        co_return 0;
+    }
+
+    const size_t block_size = cache->options.block_size;
+    const uint64_t first = offset / block_size;
+    const uint64_t last = (offset + buffer.size() - 1) / block_size;
+
+    // every block is requested before any is awaited, so the misses of one range are read concurrently
+    std::vector<task<std::shared_ptr<cached_block>>> blocks;
+    blocks.reserve(last - first + 1);
+    for (uint64_t index = first; index <= last; index++)
+    {
+        blocks.push_back(fetch(*cache, file, {id, index}));
+    }
+
+    // all of them are awaited even past the end of the file or an error: a read that is given up on would leave the
+    // block pending, and anyone coalescing onto it waiting forever
+    size_t copied = 0;
+    bool done = false;
+    std::exception_ptr error;
+    for (size_t i = 0; i < blocks.size(); i++)
+    {
+        auto &pending = blocks[i];
+        std::shared_ptr<cached_block> block;
+        try
+        {
+            block = co_await pending;
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            continue;
+        }
+
+        if (done || error)
+        {
+            continue;
+        }
+
+        size_t start = i == 0 ? offset % block_size : 0;
+        if (start < block->data.size())
+        {
+            size_t count = std::min(block->data.size() - start, buffer.size() - copied);
+            std::memcpy(buffer.data() + copied, block->data.data() + start, count);
+            copied += count;
+        }
+        done = block->data.size() < block_size;
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    co_return copied;
+}
@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/checksum.hpp>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define WEBCRAFT_CRC32C_SSE42
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define WEBCRAFT_CRC32C_ARM
+#include <arm_acle.h>
+#endif
+
+using namespace webcraft::async::io;
+
+namespace
+{
+    uint64_t read_u64(const std::byte *p) noexcept
+    {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        if constexpr (std::endian::native == std::endian::big)
+        {
+            value = std::byteswap(value);
+        }
+        return value;
+    }
+
+    uint32_t read_u32(const std::byte *p) noexcept
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        if constexpr (std::endian::native == std::endian::big)
+        {
+            value = std::byteswap(value);
+        }
+        return value;
+    }
+
+    // slicing-by-8 tables for the reflected Castagnoli polynomial
+    constexpr std::array<std::array<uint32_t, 256>, 8> make_crc32c_tables()
+    {
+        std::array<std::array<uint32_t, 256>, 8> tables{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+            {
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+            }
+            tables[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            for (size_t t = 1; t < 8; t++)
+            {
+                tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+            }
+        }
+        return tables;
+    }
+
+    constexpr auto crc32c_tables = make_crc32c_tables();
+
+    uint32_t crc32c_software(uint32_t crc, const std::byte *data, size_t size) noexcept
+    {
+        while (size >= 8)
+        {
+            uint64_t word = read_u64(data) ^ crc;
+            crc = crc32c_tables[7][word & 0xFF] ^
+                  crc32c_tables[6][(word >> 8) & 0xFF] ^
+                  crc32c_tables[5][(word >> 16) & 0xFF] ^
+                  crc32c_tables[4][(word >> 24) & 0xFF] ^
+                  crc32c_tables[3][(word >> 32) & 0xFF] ^
+                  crc32c_tables[2][(word >> 40) & 0xFF] ^
+                  crc32c_tables[1][(word >> 48) & 0xFF] ^
+                  crc32c_tables[0][word >> 56];
+            data += 8;
+            size -= 8;
+        }
+        while (size-- > 0)
+        {
+            crc = (crc >> 8) ^ crc32c_tables[0][(crc ^ std::to_integer<uint32_t>(*data++)) & 0xFF];
+        }
+        return crc;
+    }
+
+#if defined(WEBCRAFT_CRC32C_SSE42)
+
+#if !defined(_MSC_VER)
+    __attribute__((target("sse4.2")))
+#endif
+    uint32_t crc32c_hardware(uint32_t crc, const std::byte *data, size_t size) noexcept
+    {
+        uint64_t crc64 = crc;
+        while (size >= 8)
+        {
+            crc64 = _mm_crc32_u64(crc64, read_u64(data));
+            data += 8;
+            size -= 8;
+        }
+        crc = static_cast<uint32_t>(crc64);
+        while (size-- > 0)
+        {
+            crc = _mm_crc32_u8(crc, std::to_integer<uint8_t>(*data++));
+        }
+        return crc;
+    }
+
+    bool cpu_has_crc32c() noexcept
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 20)) != 0;
+#else
+        return __builtin_cpu_supports("sse4.2");
+#endif
+    }
+
+#elif defined(WEBCRAFT_CRC32C_ARM)
+
+    uint32_t crc32c_hardware(uint32_t crc, const std::byte *data, size_t size) noexcept
+    {
+        while (size >= 8)
+        {
+            crc = __crc32cd(crc, read_u64(data));
+            data += 8;
+            size -= 8;
+        }
+        while (size-- > 0)
+        {
+            crc = __crc32cb(crc, std::to_integer<uint8_t>(*data++));
+        }
+        return crc;
+    }
+
+    // the compiler only defines __ARM_FEATURE_CRC32 when the target is guaranteed to have it
+    bool cpu_has_crc32c() noexcept
+    {
+        return true;
+    }
+
+#endif
+
+    using crc32c_function = uint32_t (*)(uint32_t, const std::byte *, size_t) noexcept;
+
+    crc32c_function select_crc32c() noexcept
+    {
+#if defined(WEBCRAFT_CRC32C_SSE42) || defined(WEBCRAFT_CRC32C_ARM)
+        if (cpu_has_crc32c())
+        {
+            return crc32c_hardware;
+        }
+#endif
+        return crc32c_software;
+    }
+
+    const crc32c_function crc32c_impl = select_crc32c();
+
+    constexpr uint64_t prime64_1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t prime64_2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t prime64_3 = 0x165667B19E3779F9ull;
+    constexpr uint64_t prime64_4 = 0x85EBCA77C2B2AE63ull;
+    constexpr uint64_t prime64_5 = 0x27D4EB2F165667C5ull;
+
+    uint64_t xxh64_round(uint64_t acc, uint64_t input) noexcept
+    {
+        acc += input * prime64_2;
+        acc = std::rotl(acc, 31);
+        return acc * prime64_1;
+    }
+
+    uint64_t xxh64_merge_round(uint64_t acc, uint64_t lane) noexcept
+    {
+        acc ^= xxh64_round(0, lane);
+        return acc * prime64_1 + prime64_4;
+    }
+
+    // consumes whole 32 byte stripes, the four lanes are independent so the loop pipelines well
+    const std::byte *xxh64_stripes(std::array<uint64_t, 4> &lanes, const std::byte *data, size_t stripes) noexcept
+    {
+        uint64_t v1 = lanes[0], v2 = lanes[1], v3 = lanes[2], v4 = lanes[3];
+        for (size_t i = 0; i < stripes; i++)
+        {
+            v1 = xxh64_round(v1, read_u64(data));
+            v2 = xxh64_round(v2, read_u64(data + 8));
+            v3 = xxh64_round(v3, read_u64(data + 16));
+            v4 = xxh64_round(v4, read_u64(data + 24));
+            data += 32;
+        }
+        lanes = {v1, v2, v3, v4};
+        return data;
+    }
+}
+
+void crc32c::update(std::span<const std::byte> data) noexcept
+{
+    state = crc32c_impl(state, data.data(), data.size());
+}
+
+bool crc32c::hardware_accelerated() noexcept
+{
+    return crc32c_impl != crc32c_software;
+}
+
+void xxh64::reset() noexcept
+{
+    lanes = {seed + prime64_1 + prime64_2, seed + prime64_2, seed, seed - prime64_1};
+    buffered = 0;
+    total_length = 0;
+}
+
+void xxh64::update(std::span<const std::byte> data) noexcept
+{
+    total_length += data.size();
+    const std::byte *p = data.data();
+    size_t size = data.size();
+
+    if (buffered + size < buffer.size())
+    {
+        std::memcpy(buffer.data() + buffered, p, size);
+        buffered += size;
+        return;
+    }
+
+    if (buffered > 0)
+    {
+        size_t fill = buffer.size() - buffered;
+        std::memcpy(buffer.data() + buffered, p, fill);
+        xxh64_stripes(lanes, buffer.data(), 1);
+        p += fill;
+        size -= fill;
+        buffered = 0;
+    }
+
+    p = xxh64_stripes(lanes, p, size / 32);
+    buffered = size % 32;
+    std::memcpy(buffer.data(), p, buffered);
+}
+
+xxh64::value_type xxh64::digest() const noexcept
+{
+    uint64_t h;
+    if (total_length >= 32)
+    {
+        h = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+        for (uint64_t lane : lanes)
+        {
+            h = xxh64_merge_round(h, lane);
+        }
+    }
+    else
+    {
+        h = seed + prime64_5;
+    }
+    h += total_length;
+
+    const std::byte *p = buffer.data();
+    size_t size = buffered;
+    while (size >= 8)
+    {
+        h ^= xxh64_round(0, read_u64(p));
+        h = std::rotl(h, 27) * prime64_1 + prime64_4;
+        p += 8;
+        size -= 8;
+    }
+    if (size >= 4)
+    {
+        h ^= static_cast<uint64_t>(read_u32(p)) * prime64_1;
+        h = std::rotl(h, 23) * prime64_2 + prime64_3;
+        p += 4;
+        size -= 4;
+    }
+    while (size-- > 0)
+    {
+        h ^= std::to_integer<uint64_t>(*p++) * prime64_5;
+        h = std::rotl(h, 11) * prime64_1;
+    }
+
+    h ^= h >> 33;
+    h *= prime64_2;
+    h ^= h >> 29;
+    h *= prime64_3;
+    h ^= h >> 32;
+    return h;
+}
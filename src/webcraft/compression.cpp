@@ -0,0 +1,557 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/compression.hpp>
+#include <string>
+#include <limits>
+
+#if defined(WEBCRAFT_HAS_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(WEBCRAFT_HAS_ZSTD)
+#include <zstd.h>
+#endif
+
+#if defined(WEBCRAFT_HAS_LZ4)
+#include <lz4frame.h>
+#endif
+
+using namespace webcraft::async::io::compression;
+
+namespace
+{
+    constexpr size_t output_step = 64 * 1024;
+
+    // grows `output` by `step` bytes and returns where the codec may write
+    char *reserve_output(std::vector<char> &output, size_t step)
+    {
+        size_t used = output.size();
+        output.resize(used + step);
+        return output.data() + used;
+    }
+
+#if defined(WEBCRAFT_HAS_ZLIB)
+
+    // deflate uses the zlib wrapper, gzip adds 16 to the window bits
+    int zlib_window_bits(codec c)
+    {
+        return c == codec::gzip ? MAX_WBITS + 16 : MAX_WBITS;
+    }
+
+    class zlib_compressor : public codec_context
+    {
+    private:
+        z_stream stream{};
+
+    public:
+        zlib_compressor(codec c, std::optional<int> level)
+        {
+            if (deflateInit2(&stream, level.value_or(Z_DEFAULT_COMPRESSION), Z_DEFLATED, zlib_window_bits(c), 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            {
+                throw compression_error("deflateInit2 failed");
+            }
+        }
+
+        ~zlib_compressor() override
+        {
+            deflateEnd(&stream);
+        }
+
+        void process(std::span<const char> input, std::vector<char> &output, flush_mode mode) override
+        {
+            const int flush = mode == flush_mode::finish ? Z_FINISH : mode == flush_mode::flush ? Z_SYNC_FLUSH
+                                                                                                : Z_NO_FLUSH;
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+            stream.avail_in = static_cast<uInt>(input.size());
+
+            while (true)
+            {
+                stream.next_out = reinterpret_cast<Bytef *>(reserve_output(output, output_step));
+                stream.avail_out = static_cast<uInt>(output_step);
+
+                int ret = deflate(&stream, flush);
+                output.resize(output.size() - stream.avail_out);
+
+                if (ret == Z_STREAM_ERROR)
+                {
+                    throw compression_error("deflate failed");
+                }
+                if (mode == flush_mode::finish ? ret == Z_STREAM_END : (stream.avail_in == 0 && stream.avail_out != 0))
+                {
+                    break;
+                }
+            }
+        }
+
+        void reset() override
+        {
+            deflateReset(&stream);
+        }
+    };
+
+    class zlib_decompressor : public codec_context
+    {
+    private:
+        z_stream stream{};
+        bool ended{false};
+        bool started{false};
+
+    public:
+        explicit zlib_decompressor(codec c)
+        {
+            if (inflateInit2(&stream, zlib_window_bits(c)) != Z_OK)
+            {
+                throw compression_error("inflateInit2 failed");
+            }
+        }
+
+        ~zlib_decompressor() override
+        {
+            inflateEnd(&stream);
+        }
+
+        void process(std::span<const char> input, std::vector<char> &output, flush_mode mode) override
+        {
+            stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+            stream.avail_in = static_cast<uInt>(input.size());
+
+            // keep going while there is input, or while the last call filled the buffer and may hold more output
+            bool output_full = false;
+            while (stream.avail_in > 0 || output_full)
+            {
+                if (ended && stream.avail_in > 0)
+                {
+                    // another gzip member (or trailing data) follows the end of the previous one
+                    inflateReset(&stream);
+                    ended = false;
+                }
+                started = true;
+
+                stream.next_out = reinterpret_cast<Bytef *>(reserve_output(output, output_step));
+                stream.avail_out = static_cast<uInt>(output_step);
+
+                int ret = inflate(&stream, Z_NO_FLUSH);
+                output.resize(output.size() - stream.avail_out);
+                output_full = stream.avail_out == 0;
+
+                if (ret == Z_STREAM_END)
+                {
+                    ended = true;
+                }
+                else if (ret != Z_OK && ret != Z_BUF_ERROR)
+                {
+                    throw compression_error(std::string("inflate failed: ") + (stream.msg ? stream.msg : "corrupt input"));
+                }
+            }
+
+            if (mode == flush_mode::finish && started && !ended)
+            {
+                throw compression_error("compressed stream is truncated");
+            }
+        }
+
+        void reset() override
+        {
+            inflateReset(&stream);
+            ended = false;
+            started = false;
+        }
+    };
+
+#endif
+
+#if defined(WEBCRAFT_HAS_ZSTD)
+
+    class zstd_compressor : public codec_context
+    {
+    private:
+        ZSTD_CCtx *context;
+
+    public:
+        explicit zstd_compressor(std::optional<int> level) : context(ZSTD_createCCtx())
+        {
+            if (!context)
+            {
+                throw compression_error("ZSTD_createCCtx failed");
+            }
+            ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, level.value_or(ZSTD_CLEVEL_DEFAULT));
+        }
+
+        ~zstd_compressor() override
+        {
+            ZSTD_freeCCtx(context);
+        }
+
+        void process(std::span<const char> input, std::vector<char> &output, flush_mode mode) override
+        {
+            const ZSTD_EndDirective directive = mode == flush_mode::finish ? ZSTD_e_end : mode == flush_mode::flush ? ZSTD_e_flush
+                                                                                                                    : ZSTD_e_continue;
+            ZSTD_inBuffer in{input.data(), input.size(), 0};
+            const size_t step = ZSTD_CStreamOutSize();
+
+            while (true)
+            {
+                ZSTD_outBuffer out{reserve_output(output, step), step, 0};
+                size_t remaining = ZSTD_compressStream2(context, &out, &in, directive);
+                output.resize(output.size() - step + out.pos);
+
+                if (ZSTD_isError(remaining))
+                {
+                    throw compression_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(remaining));
+                }
+                if (directive == ZSTD_e_continue ? in.pos == in.size : remaining == 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        void reset() override
+        {
+            ZSTD_CCtx_reset(context, ZSTD_reset_session_only);
+        }
+    };
+
+    class zstd_decompressor : public codec_context
+    {
+    private:
+        ZSTD_DCtx *context;
+        bool frame_open{false};
+
+    public:
+        zstd_decompressor() : context(ZSTD_createDCtx())
+        {
+            if (!context)
+            {
+                throw compression_error("ZSTD_createDCtx failed");
+            }
+        }
+
+        ~zstd_decompressor() override
+        {
+            ZSTD_freeDCtx(context);
+        }
+
+        void process(std::span<const char> input, std::vector<char> &output, flush_mode mode) override
+        {
+            ZSTD_inBuffer in{input.data(), input.size(), 0};
+            const size_t step = ZSTD_DStreamOutSize();
+
+            // keep going while there is input, or while the last call filled the buffer and may hold more output
+            bool output_full = false;
+            while (in.pos < in.size || output_full)
+            {
+                ZSTD_outBuffer out{reserve_output(output, step), step, 0};
+                size_t ret = ZSTD_decompressStream(context, &out, &in);
+                output.resize(output.size() - step + out.pos);
+
+                if (ZSTD_isError(ret))
+                {
+                    throw compression_error(std::string("zstd decompression failed: ") + ZSTD_getErrorName(ret));
+                }
+                frame_open = ret != 0;
+                output_full = out.pos == out.size;
+            }
+
+            if (mode == flush_mode::finish && frame_open)
+            {
+                throw compression_error("compressed stream is truncated");
+            }
+        }
+
+        void reset() override
+        {
+            ZSTD_DCtx_reset(context, ZSTD_reset_session_only);
+            frame_open = false;
+        }
+    };
+
+#endif
+
+#if defined(WEBCRAFT_HAS_LZ4)
+
+    void check_lz4(size_t ret, const char *what)
+    {
+        if (LZ4F_isError(ret))
+        {
+            throw compression_error(std::string(what) + " failed: " + LZ4F_getErrorName(ret));
+        }
+    }
+
+    class lz4_compressor : public codec_context
+    {
+    private:
+        LZ4F_cctx *context{nullptr};
+        LZ4F_preferences_t preferences{};
+        bool started{false};
+
+        // runs one lz4 call that writes at most `bound` bytes to the end of `output`
+        template <typename F>
+        void append(std::vector<char> &output, size_t bound, const char *what, F &&call)
+        {
+            size_t written = call(reserve_output(output, bound), bound);
+            output.resize(output.size() - bound + (LZ4F_isError(written) ? 0 : written));
+            check_lz4(written, what);
+        }
+
+    public:
+        explicit lz4_compressor(std::optional<int> level)
+        {
+            check_lz4(LZ4F_createCompressionContext(&context, LZ4F_VERSION), "LZ4F_createCompressionContext");
+            preferences.compressionLevel = level.value_or(0);
+        }
+
+        ~lz4_compressor() override
+        {
+            LZ4F_freeCompressionContext(context);
+        }
+
+        void process(std::span<const char> input, std::vector<char> &output, flush_mode mode) override
+        {
+            if (!started)
+            {
+                append(output, LZ4F_HEADER_SIZE_MAX, "LZ4F_compressBegin", [&](char *dst, size_t capacity)
+                       { return LZ4F_compressBegin(context, dst, capacity, &preferences); });
+                started = true;
+            }
+
+            if (!input.empty())
+            {
+                append(output, LZ4F_compressBound(input.size(), &preferences), "LZ4F_compressUpdate", [&](char *dst, size_t capacity)
+                       { return LZ4F_compressUpdate(context, dst, capacity, input.data(), input.size(), nullptr); });
+            }
+
+            if (mode == flush_mode::flush)
+            {
+                append(output, LZ4F_compressBound(0, &preferences), "LZ4F_flush", [&](char *dst, size_t capacity)
+                       { return LZ4F_flush(context, dst, capacity, nullptr); });
+            }
+            else if (mode == flush_mode::finish)
+            {
+                append(output, LZ4F_compressBound(0, &preferences), "LZ4F_compressEnd", [&](char *dst, size_t capacity)
+                       { return LZ4F_compressEnd(context, dst, capacity, nullptr); });
+                started = false;
+            }
+        }
+
+        void reset() override
+        {
+            // LZ4F_compressBegin starts a new frame on the same context
+            started = false;
+        }
+    };
+
+    class lz4_decompressor : public codec_context
+    {
+    private:
+        LZ4F_dctx *context{nullptr};
+        bool frame_open{false};
+
+    public:
+        lz4_decompressor()
+        {
+            check_lz4(LZ4F_createDecompressionContext(&context, LZ4F_VERSION), "LZ4F_createDecompressionContext");
+        }
+
+        ~lz4_decompressor() override
+        {
+            LZ4F_freeDecompressionContext(context);
+        }
+
+        void process(std::span<const char> input, std::vector<char> &output, flush_mode mode) override
+        {
+            const char *src = input.data();
+            size_t left = input.size();
+
+            bool output_full = false;
+            while (left > 0 || output_full)
+            {
+                size_t dst_size = output_step;
+                size_t src_size = left;
+                char *dst = reserve_output(output, output_step);
+                size_t ret = LZ4F_decompress(context, dst, &dst_size, src, &src_size, nullptr);
+                output.resize(output.size() - output_step + (LZ4F_isError(ret) ? 0 : dst_size));
+                check_lz4(ret, "LZ4F_decompress");
+
+                src += src_size;
+                left -= src_size;
+                frame_open = ret != 0;
+                output_full = dst_size == output_step;
+            }
+
+            if (mode == flush_mode::finish && frame_open)
+            {
+                throw compression_error("compressed stream is truncated");
+            }
+        }
+
+        void reset() override
+        {
+            LZ4F_resetDecompressionContext(context);
+            frame_open = false;
+        }
+    };
+
+#endif
+
+    [[noreturn]] void throw_unsupported(codec c)
+    {
+        static const char *names[] = {"deflate", "gzip", "zstd", "lz4"};
+        throw std::invalid_argument(std::string(names[static_cast<int>(c)]) + " support was not compiled into WebCraft");
+    }
+}
+
+bool webcraft::async::io::compression::is_supported(codec c) noexcept
+{
+    switch (c)
+    {
+    case codec::deflate:
+    case codec::gzip:
+#if defined(WEBCRAFT_HAS_ZLIB)
+        return true;
+#else
+        return false;
+#endif
+    case codec::zstd:
+#if defined(WEBCRAFT_HAS_ZSTD)
+        return true;
+#else
+        return false;
+#endif
+    case codec::lz4:
+#if defined(WEBCRAFT_HAS_LZ4)
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+std::unique_ptr<codec_context> webcraft::async::io::compression::make_compressor(codec c, std::optional<int> level)
+{
+    switch (c)
+    {
+#if defined(WEBCRAFT_HAS_ZLIB)
+    case codec::deflate:
+    case codec::gzip:
+        return std::make_unique<zlib_compressor>(c, level);
+#endif
+#if defined(WEBCRAFT_HAS_ZSTD)
+    case codec::zstd:
+        return std::make_unique<zstd_compressor>(level);
+#endif
+#if defined(WEBCRAFT_HAS_LZ4)
+    case codec::lz4:
+        return std::make_unique<lz4_compressor>(level);
+#endif
+    default:
+        throw_unsupported(c);
+    }
+}
+
+std::unique_ptr<codec_context> webcraft::async::io::compression::make_decompressor(codec c)
+{
+    switch (c)
+    {
+#if defined(WEBCRAFT_HAS_ZLIB)
+    case codec::deflate:
+    case codec::gzip:
+        return std::make_unique<zlib_decompressor>(c);
+#endif
+#if defined(WEBCRAFT_HAS_ZSTD)
+    case codec::zstd:
+        return std::make_unique<zstd_decompressor>();
+#endif
+#if defined(WEBCRAFT_HAS_LZ4)
+    case codec::lz4:
+        return std::make_unique<lz4_decompressor>();
+#endif
+    default:
+        throw_unsupported(c);
+    }
+}
+
+pooled_context &pooled_context::operator=(pooled_context &&other) noexcept
+{
+    if (this != &other)
+    {
+        if (pool && context)
+        {
+            pool->release(key, std::move(context));
+        }
+        context = std::move(other.context);
+        pool = std::exchange(other.pool, nullptr);
+        key = other.key;
+    }
+    return *this;
+}
+
+pooled_context::~pooled_context()
+{
+    if (pool && context)
+    {
+        pool->release(key, std::move(context));
+    }
+}
+
+void context_pool::release(pooled_context::key_type key, std::unique_ptr<codec_context> context)
+{
+    try
+    {
+        context->reset();
+
+        std::lock_guard lock(mutex);
+        auto &contexts = idle[key];
+        if (contexts.size() < max_idle_per_kind)
+        {
+            contexts.push_back(std::move(context));
+        }
+    }
+    catch (...)
+    {
+        // a context that cannot be reset or stored is simply freed
+    }
+}
+
+pooled_context context_pool::acquire_compressor(codec c, std::optional<int> level)
+{
+    // level INT_MIN stands for the codec default so that it never collides with a real level
+    pooled_context::key_type key{c, true, level.value_or(std::numeric_limits<int>::min())};
+    {
+        std::lock_guard lock(mutex);
+        auto it = idle.find(key);
+        if (it != idle.end() && !it->second.empty())
+        {
+            auto context = std::move(it->second.back());
+            it->second.pop_back();
+            return pooled_context(std::move(context), this, key);
+        }
+    }
+    return pooled_context(make_compressor(c, level), this, key);
+}
+
+pooled_context context_pool::acquire_decompressor(codec c)
+{
+    pooled_context::key_type key{c, false, 0};
+    {
+        std::lock_guard lock(mutex);
+        auto it = idle.find(key);
+        if (it != idle.end() && !it->second.empty())
+        {
+            auto context = std::move(it->second.back());
+            it->second.pop_back();
+            return pooled_context(std::move(context), this, key);
+        }
+    }
+    return pooled_context(make_decompressor(c), this, key);
+}
+
+context_pool &context_pool::shared()
+{
+    static context_pool pool;
+    return pool;
+}
@@ -0,0 +1,427 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/connection_pool.hpp>
+#include <webcraft/async/fire_and_forget_task.hpp>
+#include <webcraft/async/runtime.hpp>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stop_token>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <cerrno>
+#include <sys/socket.h>
+#endif
+
+using namespace webcraft::async;
+using namespace webcraft::async::io::socket;
+
+namespace
+{
+    using clock = std::chrono::steady_clock;
+
+    // a non-blocking peek: an idle connection has nothing to read, so a close or any data from the peer makes it stale
+    bool still_usable(tcp_socket &connection)
+    {
+#if defined(__linux__) || defined(__APPLE__)
+        int fd = connection.get_readable_stream().get_descriptor()->native_handle();
+        if (fd < 0)
+        {
+            return true; // nothing to look at, the caller finds out on first use
+        }
+
+        char byte;
+        ssize_t received = ::recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+        return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+#else
+        return true;
+#endif
+    }
+
+    std::string endpoint_key(const connection_info &endpoint)
+    {
+        return endpoint.host + ":" + std::to_string(endpoint.port);
+    }
+}
+
+struct webcraft::async::io::socket::detail::connection_pool_state
+{
+    struct idle_connection
+    {
+        tcp_socket connection;
+        clock::time_point since;
+    };
+
+    struct endpoint
+    {
+        std::deque<idle_connection> idle; // most recently released last
+        size_t open{0};                   // idle, in use and being connected
+        std::deque<std::coroutine_handle<>> waiters;
+    };
+
+    connection_pool_options options;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, endpoint> endpoints;
+    bool sweeper_started{false};
+    std::stop_source stop;
+
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t stale{0};
+    uint64_t evictions{0};
+    uint64_t waits{0};
+
+    ~connection_pool_state()
+    {
+        stop.request_stop();
+    }
+
+    // the caller holds the lock: one connection of `ep` went away, so a waiter may open another
+    std::coroutine_handle<> closed_one(endpoint &ep)
+    {
+        ep.open--;
+        return take_waiter(ep);
+    }
+
+    std::coroutine_handle<> take_waiter(endpoint &ep)
+    {
+        if (ep.waiters.empty())
+        {
+            return {};
+        }
+        auto waiter = ep.waiters.front();
+        ep.waiters.pop_front();
+        return waiter;
+    }
+
+    // the caller lets `closing` and `woken` go after releasing the lock, so no socket is closed and no waiter resumed under it
+    void evict_expired(clock::time_point now, std::vector<tcp_socket> &closing, std::vector<std::coroutine_handle<>> &woken)
+    {
+        for (auto it = endpoints.begin(); it != endpoints.end();)
+        {
+            auto &ep = it->second;
+            while (!ep.idle.empty() && now - ep.idle.front().since >= options.idle_timeout)
+            {
+                closing.push_back(std::move(ep.idle.front().connection));
+                ep.idle.pop_front();
+                evictions++;
+                if (auto waiter = closed_one(ep))
+                {
+                    woken.push_back(waiter);
+                }
+            }
+
+            if (ep.open == 0 && ep.waiters.empty())
+            {
+                it = endpoints.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+};
+
+namespace
+{
+    using webcraft::async::io::socket::detail::connection_pool_state;
+
+    void resume_all(const std::vector<std::coroutine_handle<>> &woken)
+    {
+        for (auto waiter : woken)
+        {
+            waiter.resume();
+        }
+    }
+
+    // closes idle connections that outlived the timeout, checking twice per timeout, until the pool is gone
+    task<void> sweep_idle(std::weak_ptr<connection_pool_state> weak, clock::duration period, std::stop_token token)
+    {
+        while (!token.stop_requested())
+        {
+            try
+            {
+                co_await sleep_for(period, token);
+            }
+            catch (...)
+            {
+                break;
+            }
+
+            auto state = weak.lock();
+            if (!state || token.stop_requested())
+            {
+                break;
+            }
+
+            std::vector<tcp_socket> closing;
+            std::vector<std::coroutine_handle<>> woken;
+            {
+                std::lock_guard lock(state->mutex);
+                state->evict_expired(clock::now(), closing, woken);
+            }
+            closing.clear();
+            resume_all(woken);
+        }
+    }
+
+    // suspends until the endpoint has an idle connection or room for a new one
+    struct endpoint_available
+    {
+        connection_pool_state &state;
+        const std::string &key;
+        std::coroutine_handle<> waiter{};
+
+        endpoint_available(connection_pool_state &state, const std::string &key) : state(state), key(key) {}
+        endpoint_available(const endpoint_available &) = delete;
+        endpoint_available &operator=(const endpoint_available &) = delete;
+
+        // an acquire dropped while waiting must not be left in the queue for the next release to resume
+        ~endpoint_available()
+        {
+            if (!waiter)
+            {
+                return;
+            }
+
+            std::lock_guard lock(state.mutex);
+            auto it = state.endpoints.find(key);
+            if (it != state.endpoints.end())
+            {
+                std::erase(it->second.waiters, waiter);
+            }
+        }
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            std::lock_guard lock(state.mutex);
+            auto &ep = state.endpoints[key];
+            if (!ep.idle.empty() || ep.open < state.options.max_per_endpoint)
+            {
+                return false;
+            }
+            ep.waiters.push_back(h);
+            waiter = h;
+            return true;
+        }
+
+        void await_resume() const noexcept {}
+    };
+}
+
+void pooled_connection::release()
+{
+    if (!connection || !state)
+    {
+        return;
+    }
+
+    std::optional<tcp_socket> closing;
+    std::coroutine_handle<> waiter;
+    {
+        std::lock_guard lock(state->mutex);
+        auto &ep = state->endpoints[key];
+        if (ep.idle.size() < state->options.max_idle_per_endpoint)
+        {
+            ep.idle.push_back({std::move(*connection), clock::now()});
+            waiter = state->take_waiter(ep);
+        }
+        else
+        {
+            closing = std::move(*connection);
+            state->evictions++;
+            waiter = state->closed_one(ep);
+        }
+    }
+    connection.reset();
+    closing.reset();
+
+    if (waiter)
+    {
+        waiter.resume();
+    }
+}
+
+void pooled_connection::discard()
+{
+    if (!connection || !state)
+    {
+        return;
+    }
+
+    std::coroutine_handle<> waiter;
+    {
+        std::lock_guard lock(state->mutex);
+        waiter = state->closed_one(state->endpoints[key]);
+    }
+    connection.reset();
+
+    if (waiter)
+    {
+        waiter.resume();
+    }
+}
+
+connection_pool::connection_pool(connection_pool_options options)
+    : state(std::make_shared<detail::connection_pool_state>())
+{
+    state->options = std::move(options);
+}
+
+task<pooled_connection> connection_pool::acquire(connection_info endpoint)
+{
+    std::string key = endpoint_key(endpoint);
+
+    bool start_sweeper = false;
+    {
+        std::lock_guard lock(state->mutex);
+        if (state->options.idle_timeout > clock::duration::zero() && !state->sweeper_started)
+        {
+            state->sweeper_started = true;
+            start_sweeper = true;
+        }
+    }
+    if (start_sweeper)
+    {
+        fire_and_forget(sweep_idle(state, state->options.idle_timeout / 2, state->stop.get_token()));
+    }
+
+    bool waited = false;
+    while (true)
+    {
+        std::optional<tcp_socket> candidate;
+        bool open_new = false;
+        {
+            std::lock_guard lock(state->mutex);
+            auto &ep = state->endpoints[key];
+            if (!ep.idle.empty())
+            {
+                candidate = std::move(ep.idle.back().connection);
+                ep.idle.pop_back();
+            }
+            else if (state->options.max_per_endpoint == 0 || ep.open < state->options.max_per_endpoint)
+            {
+                ep.open++;
+                state->misses++;
+                open_new = true;
+                if (waited)
+                {
+                    state->waits++;
+                }
+            }
+        }
+
+        if (candidate)
+        {
+            // the peek is a syscall, so it is made without the lock; the connection is off the idle list by now
+            bool usable = still_usable(*candidate);
+            {
+                std::lock_guard lock(state->mutex);
+                if (usable)
+                {
+                    state->hits++;
+                    if (waited)
+                    {
+                        state->waits++;
+                    }
+                }
+                else
+                {
+                    // its place is free again, and this caller goes round to take another idle one or open a connection
+                    state->endpoints[key].open--;
+                    state->stale++;
+                }
+            }
+
+            if (usable)
+            {
+                co_return pooled_connection(state, key, std::move(*candidate), true);
+            }
+            candidate.reset();
+            continue;
+        }
+
+        if (open_new)
+        {
+            std::exception_ptr error;
+            try
+            {
+                tcp_socket connection = make_tcp_socket(state->options.socket);
+                co_await connection.connect(endpoint);
+                co_return pooled_connection(state, key, std::move(connection), false);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            std::coroutine_handle<> waiter;
+            {
+                std::lock_guard lock(state->mutex);
+                waiter = state->closed_one(state->endpoints[key]);
+            }
+            if (waiter)
+            {
+                waiter.resume();
+            }
+            std::rethrow_exception(error);
+        }
+
+        co_await endpoint_available{*state, key};
+        waited = true;
+    }
+}
+
+void connection_pool::clear()
+{
+    std::vector<tcp_socket> closing;
+    std::vector<std::coroutine_handle<>> woken;
+    {
+        std::lock_guard lock(state->mutex);
+        for (auto &[key, ep] : state->endpoints)
+        {
+            while (!ep.idle.empty())
+            {
+                closing.push_back(std::move(ep.idle.front().connection));
+                ep.idle.pop_front();
+                if (auto waiter = state->closed_one(ep))
+                {
+                    woken.push_back(waiter);
+                }
+            }
+        }
+    }
+    closing.clear();
+    resume_all(woken);
+}
+
+connection_pool_stats connection_pool::stats() const
+{
+    std::lock_guard lock(state->mutex);
+    size_t idle = 0;
+    size_t open = 0;
+    for (const auto &[key, ep] : state->endpoints)
+    {
+        idle += ep.idle.size();
+        open += ep.open;
+    }
+    return {
+        .hits = state->hits,
+        .misses = state->misses,
+        .stale = state->stale,
+        .evictions = state->evictions,
+        .waits = state->waits,
+        .idle = idle,
+        .open = open,
+    };
+}
@@ -0,0 +1,15 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <webcraft/async/thread_pool.hpp>
+
+namespace webcraft::async::io::fs::detail
+{
+    // runs the file system calls that have no asynchronous form: directory reads, copy_file_range(), and metadata
+    // calls outside Linux; one pool for all of them, so none of them keeps idle threads of its own
+    webcraft::async::thread_pool &blocking_pool();
+}
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/fs.hpp>
+#include <algorithm>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace webcraft::async::io::fs;
+using namespace webcraft::async::io::fs::detail;
+
+#if defined(_WIN32)
+
+file_mapping::file_mapping(const std::filesystem::path &p)
+{
+    HANDLE handle = ::CreateFileW(p.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        throw std::system_error(static_cast<int>(::GetLastError()), std::system_category(), "Failed to open file: " + p.string());
+    }
+
+    LARGE_INTEGER size{};
+    if (!::GetFileSizeEx(handle, &size))
+    {
+        DWORD error = ::GetLastError();
+        ::CloseHandle(handle);
+        throw std::system_error(static_cast<int>(error), std::system_category(), "Failed to get the size of file: " + p.string());
+    }
+
+    length = static_cast<size_t>(size.QuadPart);
+    if (length == 0)
+    {
+        // an empty file cannot be mapped and needs no mapping
+        ::CloseHandle(handle);
+        return;
+    }
+
+    // the view keeps the file mapping and the file alive, so both handles can go right away
+    HANDLE mapping = ::CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    ::CloseHandle(handle);
+    if (mapping == nullptr)
+    {
+        throw std::system_error(static_cast<int>(::GetLastError()), std::system_category(), "Failed to map file: " + p.string());
+    }
+
+    base = static_cast<const char *>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    DWORD error = ::GetLastError();
+    ::CloseHandle(mapping);
+    if (base == nullptr)
+    {
+        throw std::system_error(static_cast<int>(error), std::system_category(), "Failed to map file: " + p.string());
+    }
+}
+
+file_mapping::~file_mapping()
+{
+    if (base)
+    {
+        ::UnmapViewOfFile(base);
+    }
+}
+
+// Windows has no access pattern hint for views, only explicit prefetching
+void file_mapping::advise(access_pattern pattern) noexcept
+{
+}
+
+void file_mapping::prefetch(size_t offset, size_t size) noexcept
+{
+    if (!base || size == 0 || offset >= length)
+    {
+        return;
+    }
+
+    WIN32_MEMORY_RANGE_ENTRY range{const_cast<char *>(base) + offset, std::min(length - offset, size)};
+    ::PrefetchVirtualMemory(::GetCurrentProcess(), 1, &range, 0);
+}
+
+#else
+
+file_mapping::file_mapping(const std::filesystem::path &p)
+{
+    int fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::system_error(errno, std::system_category(), "Failed to open file: " + p.string());
+    }
+
+    struct stat info{};
+    if (::fstat(fd, &info) < 0)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::system_category(), "Failed to get the size of file: " + p.string());
+    }
+
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0)
+    {
+        // mmap() rejects empty mappings and an empty file needs none
+        ::close(fd);
+        return;
+    }
+
+    // the mapping holds its own reference to the file, so the descriptor can go right away
+    void *address = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    ::close(fd);
+    if (address == MAP_FAILED)
+    {
+        throw std::system_error(error, std::system_category(), "Failed to map file: " + p.string());
+    }
+    base = static_cast<const char *>(address);
+}
+
+file_mapping::file_mapping(int fd, size_t length) : length(length)
+{
+    if (length == 0)
+    {
+        return;
+    }
+
+    void *address = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED)
+    {
+        throw std::system_error(errno, std::system_category(), "Failed to map file");
+    }
+    base = static_cast<const char *>(address);
+}
+
+file_mapping::~file_mapping()
+{
+    if (base)
+    {
+        ::munmap(const_cast<char *>(base), length);
+    }
+}
+
+void file_mapping::advise(access_pattern pattern) noexcept
+{
+    if (!base)
+    {
+        return;
+    }
+
+    int advice = MADV_NORMAL;
+    switch (pattern)
+    {
+    case access_pattern::sequential:
+        advice = MADV_SEQUENTIAL;
+        break;
+    case access_pattern::random:
+        advice = MADV_RANDOM;
+        break;
+    case access_pattern::normal:
+        break;
+    }
+    ::madvise(const_cast<char *>(base), length, advice);
+}
+
+void file_mapping::prefetch(size_t offset, size_t size) noexcept
+{
+    if (!base || size == 0 || offset >= length)
+    {
+        return;
+    }
+
+    // madvise() wants a page aligned start, the mapping itself always begins on a page
+    static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t start = offset - offset % page_size;
+    size = std::min(length - start, size + (offset - start));
+
+    // MADV_WILLNEED only queues read-ahead for the range and returns without waiting for it
+    ::madvise(const_cast<char *>(base) + start, size, MADV_WILLNEED);
+}
+
+#endif
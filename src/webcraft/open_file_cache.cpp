@@ -0,0 +1,380 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/open_file_cache.hpp>
+#include <webcraft/async/fire_and_forget_task.hpp>
+#include <webcraft/async/runtime.hpp>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+#include <webcraft/async/runtime/linux.event.hpp>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+using namespace webcraft::async;
+using namespace webcraft::async::io::fs;
+
+namespace
+{
+    task<void> close_descriptor(std::shared_ptr<webcraft::async::io::fs::detail::file_descriptor> fd)
+    {
+        co_await fd->close();
+    }
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+    // what makes a cached descriptor or its status stale: new contents, new metadata, or the path no longer leading to it
+    constexpr uint32_t watch_mask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF;
+
+    int create_notifier() noexcept
+    {
+        // blocking, so that a read through the ring waits for events instead of failing with EAGAIN
+        return ::inotify_init1(IN_CLOEXEC);
+    }
+
+    int add_watch(int notifier, const std::filesystem::path &p) noexcept
+    {
+        return ::inotify_add_watch(notifier, p.c_str(), watch_mask);
+    }
+
+    void remove_watch(int notifier, int watch) noexcept
+    {
+        ::inotify_rm_watch(notifier, watch);
+    }
+#else
+    int create_notifier() noexcept { return -1; }
+    int add_watch(int, const std::filesystem::path &) noexcept { return -1; }
+    void remove_watch(int, int) noexcept {}
+#endif
+}
+
+webcraft::async::io::fs::detail::open_file_entry::~open_file_entry() noexcept
+{
+    if (fd)
+        fire_and_forget(close_descriptor(std::move(fd)));
+}
+
+struct webcraft::async::io::fs::detail::open_file_cache_state
+{
+    struct slot
+    {
+        std::string key;
+        std::shared_ptr<open_file_entry> entry;
+        std::chrono::steady_clock::time_point expires;
+        int watch;
+    };
+
+    struct watch_record
+    {
+        std::vector<std::string> keys; // the cached paths that lead to the watched file
+        uint64_t events{0};
+        size_t pins{0}; // misses that set the watch up and are still opening the file
+    };
+
+    open_file_cache_options options;
+
+    std::mutex mutex;
+    std::list<slot> lru; // most recently used first
+    std::unordered_map<std::string, std::list<slot>::iterator> index;
+    std::unordered_map<int, watch_record> watches;
+    int notifier{-1};
+    bool watcher_started{false};
+    std::stop_source stop;
+
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t invalidations{0};
+    uint64_t evictions{0};
+
+    ~open_file_cache_state()
+    {
+        stop.request_stop(); // the watcher owns the notifier and closes it on its way out
+    }
+
+    // the caller holds the lock; the watch goes once nothing refers to it any more
+    void release_watch(int watch)
+    {
+        auto it = watches.find(watch);
+        if (it != watches.end() && it->second.keys.empty() && it->second.pins == 0)
+        {
+            remove_watch(notifier, watch);
+            watches.erase(it);
+        }
+    }
+
+    // the caller holds the lock and lets `dropped` go after releasing it, so no descriptor is closed under the lock
+    void remove(std::list<slot>::iterator it, std::list<slot> &dropped)
+    {
+        if (it->watch >= 0)
+        {
+            if (auto watch = watches.find(it->watch); watch != watches.end())
+            {
+                std::erase(watch->second.keys, it->key);
+            }
+            release_watch(it->watch);
+        }
+        index.erase(it->key);
+        dropped.splice(dropped.end(), lru, it);
+    }
+
+    void drop_all(std::list<slot> &dropped)
+    {
+        while (!lru.empty())
+        {
+            remove(lru.begin(), dropped);
+            invalidations++;
+        }
+    }
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+    void apply_events(std::span<const char> data)
+    {
+        std::list<slot> dropped;
+        std::lock_guard lock(mutex);
+        for (size_t at = 0; at + sizeof(inotify_event) <= data.size();)
+        {
+            inotify_event event;
+            std::memcpy(&event, data.data() + at, sizeof(event));
+            at += sizeof(inotify_event) + event.len;
+
+            if (event.mask & IN_Q_OVERFLOW)
+            {
+                // events were lost, so anything may have changed
+                for (auto &[watch, record] : watches)
+                {
+                    record.events++;
+                }
+                drop_all(dropped);
+                continue;
+            }
+
+            auto watch = watches.find(event.wd);
+            if (watch == watches.end())
+            {
+                continue;
+            }
+
+            watch->second.events++;
+            std::vector<std::string> keys = watch->second.keys;
+            if (event.mask & IN_IGNORED)
+            {
+                // the kernel already dropped the watch, so nothing must remove it again
+                for (const auto &key : keys)
+                {
+                    index.at(key)->watch = -1;
+                }
+                watches.erase(watch);
+            }
+
+            for (const auto &key : keys)
+            {
+                remove(index.at(key), dropped);
+                invalidations++;
+            }
+        }
+    }
+#endif
+};
+
+namespace
+{
+    using webcraft::async::io::fs::detail::open_file_cache_state;
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+    // reads inotify events through the ring for as long as the cache is alive; the cache stopping it cancels the read
+    task<void> watch_changes(std::weak_ptr<open_file_cache_state> weak, int notifier, std::stop_token token)
+    {
+        std::vector<char> buffer(64 * 1024);
+        while (!token.stop_requested())
+        {
+            char *out = buffer.data();
+            unsigned size = static_cast<unsigned>(buffer.size());
+            auto event = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([notifier, out, size](struct io_uring_sqe *sqe)
+                                                                                                                  { io_uring_prep_read(sqe, notifier, out, size, -1); }, token));
+
+            co_await event;
+
+            int result = event.get_result();
+            if (event.is_cancelled())
+            {
+                break;
+            }
+            if (result == -EINTR || result == -EAGAIN)
+            {
+                continue;
+            }
+            if (result <= 0)
+            {
+                break; // entries still expire by their TTL
+            }
+
+            auto state = weak.lock();
+            if (!state)
+            {
+                break;
+            }
+            state->apply_events(std::span<const char>(out, static_cast<size_t>(result)));
+        }
+        ::close(notifier);
+    }
+#endif
+}
+
+open_file_cache::open_file_cache(open_file_cache_options options)
+    : state(std::make_shared<detail::open_file_cache_state>())
+{
+    state->options = options;
+}
+
+task<open_file_handle> open_file_cache::acquire(std::filesystem::path p)
+{
+    std::string key = p.lexically_normal().string();
+    auto now = std::chrono::steady_clock::now();
+
+    int watch = -1;
+    uint64_t events = 0;
+    bool start_watcher = false;
+    {
+        std::list<detail::open_file_cache_state::slot> dropped;
+        std::lock_guard lock(state->mutex);
+        if (auto it = state->index.find(key); it != state->index.end())
+        {
+            auto slot = it->second;
+            if (state->options.ttl == std::chrono::steady_clock::duration::zero() || now < slot->expires)
+            {
+                state->lru.splice(state->lru.begin(), state->lru, slot);
+                state->hits++;
+                co_return open_file_handle(slot->entry);
+            }
+            state->remove(slot, dropped);
+            state->invalidations++;
+        }
+        state->misses++;
+
+        if (state->options.watch && !state->watcher_started)
+        {
+            state->watcher_started = true;
+            state->notifier = create_notifier();
+            start_watcher = state->notifier >= 0;
+        }
+
+        // watched before it is opened, so that a change racing with the open is seen rather than cached
+        if (state->notifier >= 0)
+        {
+            watch = add_watch(state->notifier, p);
+            if (watch >= 0)
+            {
+                auto &record = state->watches[watch];
+                record.pins++;
+                events = record.events;
+            }
+        }
+    }
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+    if (start_watcher)
+    {
+        fire_and_forget(watch_changes(state, state->notifier, state->stop.get_token()));
+    }
+#endif
+
+    std::shared_ptr<detail::open_file_entry> entry;
+    std::exception_ptr error;
+    try
+    {
+        auto fd = co_await detail::make_file_descriptor(p, std::ios::in);
+        entry = std::make_shared<detail::open_file_entry>(p, std::move(fd), file_status{});
+        entry->status = co_await detail::stat_descriptor(entry->fd, p);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    {
+        std::list<detail::open_file_cache_state::slot> dropped;
+        std::lock_guard lock(state->mutex);
+        bool changed = false;
+        if (watch >= 0)
+        {
+            auto record = state->watches.find(watch);
+            changed = record == state->watches.end() || record->second.events != events;
+            if (record != state->watches.end())
+            {
+                record->second.pins--;
+            }
+        }
+
+        if (!error && !changed && state->options.max_entries > 0)
+        {
+            if (auto it = state->index.find(key); it != state->index.end())
+            {
+                state->remove(it->second, dropped); // a concurrent miss got there first, the newer open wins
+            }
+
+            state->lru.push_front({key, entry, now + state->options.ttl, watch});
+            state->index.emplace(key, state->lru.begin());
+            if (watch >= 0)
+            {
+                state->watches[watch].keys.push_back(key);
+            }
+
+            while (state->lru.size() > state->options.max_entries)
+            {
+                state->remove(std::prev(state->lru.end()), dropped);
+                state->evictions++;
+            }
+        }
+
+        if (watch >= 0)
+        {
+            state->release_watch(watch);
+        }
+    }
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    co_return open_file_handle(std::move(entry));
+}
+
+void open_file_cache::invalidate(const std::filesystem::path &p)
+{
+    std::list<detail::open_file_cache_state::slot> dropped;
+    std::lock_guard lock(state->mutex);
+    if (auto it = state->index.find(p.lexically_normal().string()); it != state->index.end())
+    {
+        state->remove(it->second, dropped);
+        state->invalidations++;
+    }
+}
+
+void open_file_cache::clear()
+{
+    std::list<detail::open_file_cache_state::slot> dropped;
+    std::lock_guard lock(state->mutex);
+    state->drop_all(dropped);
+}
+
+open_file_cache_stats open_file_cache::stats() const
+{
+    std::lock_guard lock(state->mutex);
+    return {
+        .hits = state->hits,
+        .misses = state->misses,
+        .invalidations = state->invalidations,
+        .evictions = state->evictions,
+        .entries = state->lru.size(),
+    };
+}
@@ -0,0 +1,186 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/fs.hpp>
+#include <webcraft/async/runtime.hpp>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <system_error>
+
+using namespace webcraft::async;
+using namespace webcraft::async::io::fs;
+
+namespace
+{
+    // the read loop behind every platform, and behind Linux when the file outgrew its statx: reads at growing offsets
+    // into a buffer sized for `expected` bytes plus one, so that a file of the expected size needs no reallocation
+    task<file_contents> read_through_descriptor(std::filesystem::path p, uint64_t expected, io_priority priority)
+    {
+        auto fd = co_await webcraft::async::io::fs::detail::make_file_descriptor(p, std::ios::in);
+        fd->set_priority(priority);
+
+        size_t capacity = static_cast<size_t>(expected) + 1;
+        size_t length = 0;
+        auto buffer = std::make_unique_for_overwrite<char[]>(capacity);
+        std::exception_ptr error;
+        try
+        {
+            while (true)
+            {
+                size_t received = co_await fd->read_at(length, std::span<char>(buffer.get() + length, capacity - length));
+                if (received == 0)
+                {
+                    break;
+                }
+
+                length += received;
+                if (length == capacity)
+                {
+                    capacity *= 2;
+                    auto grown = std::make_unique_for_overwrite<char[]>(capacity);
+                    std::memcpy(grown.get(), buffer.get(), length);
+                    buffer = std::move(grown);
+                }
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        co_await fd->close();
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        co_return file_contents(std::move(buffer), length);
+    }
+}
+
+#if defined(__linux__) && !defined(WEBCRAFT_MOCK_FS_TESTS)
+
+#include <webcraft/async/runtime/linux.event.hpp>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace
+{
+    using webcraft::async::detail::linux::io_uring_linked_pair_event;
+
+    void throw_if_failed(int result, const char *message, const std::filesystem::path &p)
+    {
+        if (result < 0)
+        {
+            throw std::system_error(-result, std::system_category(), message + p.string());
+        }
+    }
+
+    // a single read returns at most this much, larger files take the read loop
+    constexpr uint64_t max_single_read = 0x7ffff000;
+}
+
+task<file_contents> webcraft::async::io::fs::read_all(std::filesystem::path p, read_all_options options)
+{
+    struct statx status{};
+    struct statx *out = &status;
+
+    auto opened = webcraft::async::detail::as_awaitable(std::make_unique<io_uring_linked_pair_event>([p, out](struct io_uring_sqe *sqe)
+                                                                                                     { io_uring_prep_statx(sqe, AT_FDCWD, p.c_str(), 0, STATX_TYPE | STATX_SIZE, out); },
+                                                                                                     [p](struct io_uring_sqe *sqe)
+                                                                                                     { io_uring_prep_openat(sqe, AT_FDCWD, p.c_str(), O_RDONLY | O_CLOEXEC, 0); },
+                                                                                                     options.priority));
+    co_await opened;
+
+    int fd = opened.get_result();
+    throw_if_failed(fd, "Failed to open file: ", p);
+
+    // special files report no useful size, they start from an empty buffer and grow
+    bool regular = opened.event->first_result() == 0 && S_ISREG(status.stx_mode);
+    uint64_t size = regular ? status.stx_size : 0;
+
+    bool map = regular && size > 0 && size >= options.mmap_threshold;
+    if (map || size + 1 > max_single_read)
+    {
+        // the descriptor the openat returned is mapped before it is closed, the mapping keeps its own reference
+        std::shared_ptr<webcraft::async::io::fs::detail::file_mapping> mapping;
+        std::exception_ptr error;
+        if (map)
+        {
+            try
+            {
+                mapping = std::make_shared<webcraft::async::io::fs::detail::file_mapping>(fd, static_cast<size_t>(size));
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        }
+
+        auto closing = webcraft::async::detail::as_awaitable(webcraft::async::detail::linux::create_io_uring_event([fd](struct io_uring_sqe *sqe)
+                                                                                                                { io_uring_prep_close(sqe, fd); }, {}, options.priority));
+        co_await closing;
+
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        if (mapping)
+        {
+            co_return file_contents(std::move(mapping));
+        }
+        file_contents contents = co_await read_through_descriptor(p, size, options.priority);
+        co_return contents;
+    }
+
+    size_t capacity = static_cast<size_t>(size) + 1; // one byte more tells a file that grew from one that did not
+    auto buffer = std::make_unique_for_overwrite<char[]>(capacity);
+    char *data = buffer.get();
+
+    uint16_t ioprio = options.priority.native();
+    auto read = webcraft::async::detail::as_awaitable(std::make_unique<io_uring_linked_pair_event>([fd, data, capacity, ioprio](struct io_uring_sqe *sqe)
+                                                                                                   { io_uring_prep_read(sqe, fd, data, static_cast<unsigned>(capacity), 0);
+                                                                                                     sqe->ioprio = ioprio; },
+                                                                                                   [fd](struct io_uring_sqe *sqe)
+                                                                                                   { io_uring_prep_close(sqe, fd); },
+                                                                                                   options.priority));
+    co_await read;
+
+    int received = read.event->first_result();
+    throw_if_failed(received, "Failed to read file: ", p);
+
+    if (static_cast<size_t>(received) < capacity)
+    {
+        co_return file_contents(std::move(buffer), static_cast<size_t>(received));
+    }
+
+    // it grew since the statx, start over without trusting the size
+    file_contents contents = co_await read_through_descriptor(p, std::max<uint64_t>(size * 2, 4096), options.priority);
+    co_return contents;
+}
+
+#else
+
+task<file_contents> webcraft::async::io::fs::read_all(std::filesystem::path p, read_all_options options)
+{
+    // a missing file fails here, as a filesystem_error carrying the same error code as on Linux
+    file_status status = co_await stat(p);
+    if (status.type == std::filesystem::file_type::directory)
+    {
+        throw std::filesystem::filesystem_error("Failed to read file", p, std::make_error_code(std::errc::is_a_directory));
+    }
+    uint64_t size = status.type == std::filesystem::file_type::regular ? status.size : 0;
+
+    if (size > 0 && size >= options.mmap_threshold)
+    {
+        co_return file_contents(std::make_shared<webcraft::async::io::fs::detail::file_mapping>(p));
+    }
+
+    file_contents contents = co_await read_through_descriptor(p, size, options.priority);
+    co_return contents;
+}
+
+#endif
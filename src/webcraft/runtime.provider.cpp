@@ -53,12 +53,27 @@ void webcraft::async::detail::initialize_runtime() noexcept
 #include <liburing.h>
 #include <webcraft/async/runtime/linux.event.hpp>
 
+#include <deque>
+#include <unordered_set>
+
 int evfd = 0;
 uint64_t evfd_buffer = 0;
 moodycamel::ConcurrentQueue<webcraft::async::detail::io_uring_operation> operation_queue{};
+moodycamel::ConcurrentQueue<webcraft::async::detail::io_uring_operation> urgent_queue{};     // realtime class, drained first
+moodycamel::ConcurrentQueue<webcraft::async::detail::io_uring_operation> background_queue{}; // idle class
 const uint64_t EVFD_TOKEN = 0xDEADBEEF;
+constexpr unsigned ring_entries = 1024;
+// SQ slots that idle operations never take, so a backed-up queue still has room for everything else
+constexpr unsigned reserved_slots = ring_entries / 4;
+// the most SQEs one queued operation takes: the linked pairs of read_all and write_at_and_sync take two
+constexpr unsigned max_sqes_per_operation = 2;
 static io_uring global_ring;
 alignas(64) std::atomic<bool> is_sleeping{false};
+std::atomic<size_t> background_io_limit{16};
+
+// only touched by the run loop: idle operations waiting for room, and those the kernel has not completed yet
+std::deque<webcraft::async::detail::io_uring_operation> waiting_background;
+std::unordered_set<uint64_t> background_in_flight;
 
 uint64_t webcraft::async::detail::get_native_handle()
 {
@@ -73,10 +88,8 @@ void arm_eventfd()
     io_uring_submit(&global_ring);
 }
 
-void webcraft::async::detail::submit_runtime_operation(io_uring_operation op)
+void wake_run_loop()
 {
-    operation_queue.enqueue(std::move(op));
-
     if (is_sleeping.load(std::memory_order_acquire))
     {
         // Wake up the io_uring loop by writing to the eventfd
@@ -85,7 +98,108 @@ void webcraft::async::detail::submit_runtime_operation(io_uring_operation op)
     }
 }
 
-void drain_pending_queue()
+void webcraft::async::detail::submit_runtime_operation(io_uring_operation op)
+{
+    operation_queue.enqueue(std::move(op));
+    wake_run_loop();
+}
+
+void webcraft::async::detail::submit_runtime_operation(io_uring_operation op, io_priority priority)
+{
+    switch (priority.io_class)
+    {
+    case io_priority_class::realtime:
+        urgent_queue.enqueue(std::move(op));
+        break;
+    case io_priority_class::idle:
+        background_queue.enqueue(std::move(op));
+        break;
+    default:
+        operation_queue.enqueue(std::move(op));
+        break;
+    }
+    wake_run_loop();
+}
+
+void webcraft::async::set_background_io_limit(size_t limit) noexcept
+{
+    background_io_limit.store(limit, std::memory_order_relaxed);
+}
+
+bool has_queued_operations()
+{
+    return operation_queue.size_approx() > 0 || urgent_queue.size_approx() > 0 || background_queue.size_approx() > 0;
+}
+
+// an SQE for the next operation with room for the rest of it, flushing the ring first if it is nearly full; nullptr if
+// the kernel did not take anything off it
+struct io_uring_sqe *reserve_sqe()
+{
+    if (io_uring_sq_space_left(&global_ring) < max_sqes_per_operation)
+    {
+        io_uring_submit(&global_ring);
+        if (io_uring_sq_space_left(&global_ring) < max_sqes_per_operation)
+        {
+            return nullptr;
+        }
+    }
+    return io_uring_get_sqe(&global_ring);
+}
+
+// a receive, accept, connect or poll stays in flight until the peer acts, which may be never, so it does not hold one of
+// the background slots that bounded file operations take turns on
+bool waits_on_peer(const struct io_uring_sqe *sqe)
+{
+    switch (sqe->opcode)
+    {
+    case IORING_OP_RECV:
+    case IORING_OP_RECVMSG:
+    case IORING_OP_ACCEPT:
+    case IORING_OP_CONNECT:
+    case IORING_OP_POLL_ADD:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// idle operations take SQEs last, only while fewer than the limit are in flight and the reserved slots stay free
+bool drain_background_queue()
+{
+    webcraft::async::detail::io_uring_operation bulk_buf[64];
+    size_t count = 0;
+    while ((count = background_queue.try_dequeue_bulk(bulk_buf, 64)) != 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            waiting_background.push_back(std::move(bulk_buf[i]));
+        }
+    }
+
+    bool did_work = false;
+    size_t limit = background_io_limit.load(std::memory_order_relaxed);
+    while (!waiting_background.empty() && (limit == 0 || background_in_flight.size() < limit) &&
+           io_uring_sq_space_left(&global_ring) > reserved_slots)
+    {
+        struct io_uring_sqe *sqe = reserve_sqe();
+        if (sqe == nullptr)
+        {
+            break;
+        }
+
+        auto op = std::move(waiting_background.front());
+        waiting_background.pop_front();
+        op(sqe);
+        if (sqe->user_data != 0 && !waits_on_peer(sqe))
+        {
+            background_in_flight.insert(sqe->user_data);
+        }
+        did_work = true;
+    }
+    return did_work;
+}
+
+bool drain_queue(moodycamel::ConcurrentQueue<webcraft::async::detail::io_uring_operation> &queue)
 {
 
     webcraft::async::detail::io_uring_operation bulk_buf[64];
@@ -93,14 +207,23 @@ void drain_pending_queue()
     bool did_work = false;
 
     // try_dequeue_bulk is much faster than individual pops
-    while ((count = operation_queue.try_dequeue_bulk(bulk_buf, 64)) != 0)
+    while ((count = queue.try_dequeue_bulk(bulk_buf, 64)) != 0)
     {
         did_work = true;
         for (size_t i = 0; i < count; ++i)
         {
             // Convert Task to Ring Submission
             // (This usually calls io_uring_get_sqe + prep_read/write)
-            struct io_uring_sqe *sqe = io_uring_get_sqe(&global_ring);
+            struct io_uring_sqe *sqe = reserve_sqe();
+            if (sqe == nullptr)
+            {
+                // the ring is stuck full: hand the rest back for the next pass of the run loop
+                for (size_t j = i; j < count; ++j)
+                {
+                    queue.enqueue(std::move(bulk_buf[j]));
+                }
+                return did_work;
+            }
             bulk_buf[i](sqe);
         }
 
@@ -111,6 +234,15 @@ void drain_pending_queue()
         }
     }
 
+    return did_work;
+}
+
+void drain_pending_queue()
+{
+    bool did_work = drain_queue(urgent_queue);
+    did_work |= drain_queue(operation_queue);
+    did_work |= drain_background_queue();
+
     // Final flush of any pending SQEs
     if (did_work)
     {
@@ -129,6 +261,11 @@ void process_io_uring_ops(struct io_uring_cqe *initial_cqe)
     {
         count++;
 
+        if (!background_in_flight.empty())
+        {
+            background_in_flight.erase(cqe->user_data);
+        }
+
         if (cqe->user_data == EVFD_TOKEN)
         {
             // Rearm the eventfd read
@@ -139,7 +276,7 @@ void process_io_uring_ops(struct io_uring_cqe *initial_cqe)
             // Normal completion event
             auto user_data = cqe->user_data;
             // Call the callback or handle the event based on user_data
-            auto *event = reinterpret_cast<webcraft::async::detail::runtime_event *>(user_data);
+            auto *event = reinterpret_cast<webcraft::async::detail::runtime_callback *>(user_data);
             if (event)
             {
                 // Call the callback function
@@ -160,7 +297,8 @@ void run_loop(std::stop_token token)
         drain_pending_queue();
         is_sleeping.store(true, std::memory_order_release);
 
-        if (operation_queue.size_approx() > 0)
+        // idle operations that are held back only for lack of SQ slots have nothing in flight to wake the loop up
+        if (has_queued_operations() || (!waiting_background.empty() && background_in_flight.empty()))
         {
             is_sleeping.store(false, std::memory_order_release);
             continue; // New operations added, skip waiting
@@ -189,7 +327,7 @@ void run_loop(std::stop_token token)
 
 bool start_runtime_async() noexcept
 {
-    auto ret = io_uring_queue_init(1024, &global_ring, 0);
+    auto ret = io_uring_queue_init(ring_entries, &global_ring, 0);
 
     if (ret < 0)
     {
@@ -496,6 +634,13 @@ std::unique_ptr<webcraft::async::detail::runtime_event> webcraft::async::detail:
 
 #endif
 
+#ifndef __linux__
+// only the io_uring loop schedules by I/O priority
+void webcraft::async::set_background_io_limit([[maybe_unused]] size_t limit) noexcept
+{
+}
+#endif
+
 void webcraft::async::detail::shutdown_runtime() noexcept
 {
     if (!is_running.exchange(false))
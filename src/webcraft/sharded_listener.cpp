@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/sharded_listener.hpp>
+#include <algorithm>
+#include <iterator>
+#include <system_error>
+#include <thread>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <cerrno>
+#include <sys/socket.h>
+#endif
+
+#if defined(__linux__)
+#include <linux/filter.h>
+#endif
+
+using namespace webcraft::async::io::socket;
+
+namespace
+{
+    // the port a bound listener ended up on, which is the one the kernel picked if it was asked for port 0
+    uint16_t bound_port(const tcp_listener &listener)
+    {
+#if defined(__linux__) || defined(__APPLE__)
+        int fd = listener.get_descriptor()->native_handle();
+        socket_address address;
+        socklen_t length = static_cast<socklen_t>(address.capacity());
+        if (fd >= 0 && ::getsockname(fd, address.data(), &length) == 0)
+        {
+            address.resize(length);
+            return address.port();
+        }
+#endif
+        return 0;
+    }
+
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    // the program belongs to the whole reuseport group, and the index it returns is the position of a socket in the
+    // group, which is the order the shards were bound in
+    void steer_to_cpu(const tcp_listener &listener, size_t shards)
+    {
+        struct sock_filter code[] = {
+            {BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+            {BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(shards)},
+            {BPF_RET | BPF_A, 0, 0, 0},
+        };
+        struct sock_fprog program{static_cast<unsigned short>(std::size(code)), code};
+
+        int fd = listener.get_descriptor()->native_handle();
+        if (::setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) != 0)
+        {
+            throw std::system_error(errno, std::system_category(), "Failed to set SO_ATTACH_REUSEPORT_CBPF");
+        }
+    }
+#else
+    void steer_to_cpu(const tcp_listener &, size_t)
+    {
+    }
+#endif
+}
+
+sharded_listener webcraft::async::io::socket::make_sharded_listener(const connection_info &info, size_t shards, sharded_listener_options options)
+{
+    if (shards == 0)
+    {
+        shards = std::max(1u, std::thread::hardware_concurrency());
+    }
+#if !defined(SO_REUSEPORT)
+    shards = 1; // nothing lets a second socket bind the address
+#endif
+    options.socket.reuse_port = true;
+
+    connection_info address = info;
+    std::vector<tcp_listener> listeners;
+    listeners.reserve(shards);
+    for (size_t i = 0; i < shards; i++)
+    {
+        tcp_listener listener = make_tcp_listener(options.socket);
+        listener.bind(address);
+        listener.listen(options.backlog);
+        if (address.port == 0)
+        {
+            address.port = bound_port(listener);
+        }
+        listeners.push_back(std::move(listener));
+    }
+
+    if (options.steer_to_cpu && shards > 1)
+    {
+        steer_to_cpu(listeners.front(), shards);
+    }
+    return sharded_listener(std::move(listeners));
+}
@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include <webcraft/async/io/socket.hpp>
+#include <webcraft/net/util.hpp>
+#include <cstring>
+
+using namespace webcraft::async::io::socket;
+
+static_assert(sizeof(sockaddr_storage) <= socket_address::capacity(), "socket_address must hold a sockaddr_storage");
+
+socket_address::socket_address(const ::sockaddr *addr, size_t length)
+{
+    resize(length);
+    std::memcpy(storage.data(), addr, length);
+}
+
+std::optional<socket_address> socket_address::parse(std::string_view host, uint16_t port)
+{
+    struct addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM; // one result per address rather than one per socket type
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+
+    struct addrinfo *res;
+    if (getaddrinfo(std::string(host).c_str(), std::to_string(port).c_str(), &hints, &res) != 0)
+    {
+        return std::nullopt;
+    }
+
+    socket_address address(res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+    return address;
+}
+
+std::vector<socket_address> socket_address::resolve_all(const connection_info &info)
+{
+    struct addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *res;
+    int ret = getaddrinfo(info.host.c_str(), std::to_string(info.port).c_str(), &hints, &res);
+    if (ret != 0)
+    {
+        throw webcraft::net::util::get_addr_info_error(ret);
+    }
+
+    std::vector<socket_address> addresses;
+    for (auto *rp = res; rp; rp = rp->ai_next)
+    {
+        addresses.emplace_back(rp->ai_addr, rp->ai_addrlen);
+    }
+    freeaddrinfo(res);
+    return addresses;
+}
+
+socket_address socket_address::resolve(const connection_info &info)
+{
+    return resolve_all(info).front(); // getaddrinfo fails rather than return no results
+}
+
+int socket_address::family() const noexcept
+{
+    return length == 0 ? AF_UNSPEC : data()->sa_family;
+}
+
+uint16_t socket_address::port() const noexcept
+{
+    switch (family())
+    {
+    case AF_INET:
+        return ntohs(reinterpret_cast<const sockaddr_in *>(storage.data())->sin_port);
+    case AF_INET6:
+        return ntohs(reinterpret_cast<const sockaddr_in6 *>(storage.data())->sin6_port);
+    default:
+        return 0;
+    }
+}
+
+std::string socket_address::host() const
+{
+    char host[NI_MAXHOST];
+    if (length == 0 || getnameinfo(data(), static_cast<socklen_t>(length), host, sizeof(host), nullptr, 0, NI_NUMERICHOST) != 0)
+    {
+        return "";
+    }
+    return host;
+}
+
+std::string socket_address::to_string() const
+{
+    if (family() == AF_INET6)
+    {
+        return "[" + host() + "]:" + std::to_string(port());
+    }
+    return host() + ":" + std::to_string(port());
+}
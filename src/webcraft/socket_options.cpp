@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#include "socket_options_decl.hpp"
+#include <string>
+#include <system_error>
+
+#if defined(_WIN32)
+
+#include <WS2tcpip.h>
+
+#else
+
+#include <cerrno>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#endif
+
+using namespace webcraft::async::io::socket;
+using namespace webcraft::async::io::socket::detail;
+
+namespace
+{
+    int last_socket_error() noexcept
+    {
+#if defined(_WIN32)
+        return WSAGetLastError();
+#else
+        return errno;
+#endif
+    }
+
+    void set_option(native_socket fd, int level, int name, int value, const char *what)
+    {
+        if (::setsockopt(fd, level, name, reinterpret_cast<const char *>(&value), sizeof(value)) != 0)
+        {
+            throw std::system_error(last_socket_error(), std::system_category(), std::string("Failed to set ") + what);
+        }
+    }
+
+    void apply_keepalive(native_socket fd, const keepalive_options &keepalive)
+    {
+        set_option(fd, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+#if defined(TCP_KEEPIDLE)
+        set_option(fd, IPPROTO_TCP, TCP_KEEPIDLE, static_cast<int>(keepalive.idle.count()), "TCP_KEEPIDLE");
+#elif defined(TCP_KEEPALIVE)
+        set_option(fd, IPPROTO_TCP, TCP_KEEPALIVE, static_cast<int>(keepalive.idle.count()), "TCP_KEEPALIVE");
+#endif
+#if defined(TCP_KEEPINTVL)
+        set_option(fd, IPPROTO_TCP, TCP_KEEPINTVL, static_cast<int>(keepalive.interval.count()), "TCP_KEEPINTVL");
+#endif
+#if defined(TCP_KEEPCNT)
+        set_option(fd, IPPROTO_TCP, TCP_KEEPCNT, keepalive.probes, "TCP_KEEPCNT");
+#endif
+    }
+}
+
+void webcraft::async::io::socket::detail::apply_socket_options(native_socket fd, const socket_options &options, socket_role role)
+{
+    // accepted sockets inherit their buffer sizes from the listener, which set them before the handshake
+    bool buffers = role != socket_role::accepted;
+    // per-connection behaviour is left off the listener and set on each accepted socket instead
+    bool connection = role == socket_role::connecting || role == socket_role::accepted;
+
+    if (buffers && options.receive_buffer)
+    {
+        set_option(fd, SOL_SOCKET, SO_RCVBUF, *options.receive_buffer, "SO_RCVBUF");
+    }
+    if (buffers && options.send_buffer)
+    {
+        set_option(fd, SOL_SOCKET, SO_SNDBUF, *options.send_buffer, "SO_SNDBUF");
+    }
+
+#if defined(SO_BUSY_POLL)
+    if (options.busy_poll)
+    {
+        set_option(fd, SOL_SOCKET, SO_BUSY_POLL, static_cast<int>(options.busy_poll->count()), "SO_BUSY_POLL");
+    }
+#endif
+
+    if (connection && options.no_delay)
+    {
+        set_option(fd, IPPROTO_TCP, TCP_NODELAY, *options.no_delay ? 1 : 0, "TCP_NODELAY");
+    }
+#if defined(TCP_QUICKACK)
+    if (connection && options.quick_ack)
+    {
+        set_option(fd, IPPROTO_TCP, TCP_QUICKACK, *options.quick_ack ? 1 : 0, "TCP_QUICKACK");
+    }
+#endif
+    if (connection && options.keepalive)
+    {
+        apply_keepalive(fd, *options.keepalive);
+    }
+
+#if defined(TCP_FASTOPEN)
+    if (role == socket_role::listener && options.fast_open)
+    {
+        set_option(fd, IPPROTO_TCP, TCP_FASTOPEN, *options.fast_open, "TCP_FASTOPEN");
+    }
+#endif
+#if defined(TCP_FASTOPEN_CONNECT)
+    if (role == socket_role::connecting && options.fast_open)
+    {
+        set_option(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, 1, "TCP_FASTOPEN_CONNECT");
+    }
+#endif
+#if defined(TCP_DEFER_ACCEPT)
+    if (role == socket_role::listener && options.defer_accept)
+    {
+        set_option(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, static_cast<int>(options.defer_accept->count()), "TCP_DEFER_ACCEPT");
+    }
+#endif
+}
+
+bool webcraft::async::io::socket::detail::apply_bind_options(native_socket fd, const socket_options &options) noexcept
+{
+    int on = 1;
+#if !defined(_WIN32)
+    if (options.reuse_address && ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0)
+    {
+        return false;
+    }
+#endif
+#if defined(SO_REUSEPORT)
+    if (options.reuse_port && ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0)
+    {
+        return false;
+    }
+#endif
+    return true;
+}
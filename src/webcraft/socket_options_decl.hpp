@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <webcraft/async/io/socket.hpp>
+
+#if defined(_WIN32)
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <WinSock2.h>
+
+#endif
+
+namespace webcraft::async::io::socket::detail
+{
+#if defined(_WIN32)
+    using native_socket = SOCKET;
+#else
+    using native_socket = int;
+#endif
+
+    // what a socket is for decides which of the options apply to it
+    enum class socket_role
+    {
+        connecting, // set before connect()
+        listener,   // set between bind() and listen()
+        accepted,   // what an accepted socket does not already inherit from its listener
+        datagram
+    };
+
+    // sets the options of `options` that apply to `role`, except the ones that have to be set before bind(), which are
+    // left to the caller; throws std::system_error naming the option the kernel rejected
+    void apply_socket_options(native_socket fd, const socket_options &options, socket_role role);
+
+    // sets SO_REUSEADDR and SO_REUSEPORT if the options ask for them (never SO_REUSEADDR on Windows, which has no
+    // SO_REUSEPORT); returns false if the kernel rejected either
+    bool apply_bind_options(native_socket fd, const socket_options &options) noexcept;
+}
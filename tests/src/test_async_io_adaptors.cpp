@@ -10,6 +10,7 @@
 #include <webcraft/async/async.hpp>
 #include <webcraft/async/io/core.hpp>
 #include <webcraft/async/io/adaptors.hpp>
+#include <webcraft/async/io/rate_limiter.hpp>
 #include <string>
 #include <vector>
 #include <deque>
@@ -774,4 +775,460 @@ TEST_CASE(TestNegNoneMatchesCollector)
     };
 
     sync_wait(task_fn());
-}
\ No newline at end of file
+}
+
+TEST_CASE(TestTeeAdaptorDeliversEveryValueToEachConsumer)
+{
+    mock_readable_stream<int> rstream({1, 2, 3, 4, 5});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto streams = rstream | tee<int>(3);
+        EXPECT_EQ(streams.size(), 3) << "Should have created three consumers";
+
+        for (auto &stream : streams)
+        {
+            std::vector<int> results;
+            while (auto value = co_await stream.recv())
+            {
+                results.push_back(*value);
+            }
+            EXPECT_EQ(results, std::vector<int>({1, 2, 3, 4, 5})) << "Every consumer should see the whole stream";
+        }
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestBroadcastBlockPolicyWaitsForSlowestConsumer)
+{
+    mock_readable_stream<int> rstream({1, 2, 3, 4, 5});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto streams = rstream | broadcast<int>(2, 2, lag_policy::block);
+
+        EXPECT_EQ(co_await streams[0].recv(), 1);
+        EXPECT_EQ(co_await streams[0].recv(), 2);
+
+        // the buffer is full until the second consumer catches up
+        auto pending = streams[0].recv();
+        EXPECT_FALSE(pending.await_ready()) << "Fast consumer should be blocked by the slow one";
+
+        EXPECT_EQ(co_await streams[1].recv(), 1);
+        EXPECT_TRUE(pending.await_ready()) << "Freeing a slot should unblock the fast consumer";
+        EXPECT_EQ(co_await pending, 3);
+
+        EXPECT_EQ(co_await streams[1].recv(), 2);
+        EXPECT_EQ(co_await streams[1].recv(), 3);
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestBroadcastDropOldestPolicySkipsLaggingConsumer)
+{
+    mock_readable_stream<int> rstream({1, 2, 3, 4, 5});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto streams = rstream | broadcast<int>(2, 2, lag_policy::drop_oldest);
+
+        std::vector<int> fast, slow;
+        while (auto value = co_await streams[0].recv())
+        {
+            fast.push_back(*value);
+        }
+        while (auto value = co_await streams[1].recv())
+        {
+            slow.push_back(*value);
+        }
+
+        EXPECT_EQ(fast, std::vector<int>({1, 2, 3, 4, 5})) << "Fast consumer should see every value";
+        EXPECT_EQ(slow, std::vector<int>({4, 5})) << "Slow consumer should only see what is still buffered";
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestBroadcastDisconnectPolicyEndsLaggingConsumer)
+{
+    mock_readable_stream<int> rstream({1, 2, 3, 4, 5});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto streams = rstream | broadcast<int>(2, 2, lag_policy::disconnect);
+
+        std::vector<int> fast;
+        while (auto value = co_await streams[0].recv())
+        {
+            fast.push_back(*value);
+        }
+
+        EXPECT_EQ(fast, std::vector<int>({1, 2, 3, 4, 5})) << "Fast consumer should see every value";
+        EXPECT_FALSE((co_await streams[1].recv()).has_value()) << "Slow consumer should have been disconnected";
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestBroadcastClosedConsumerDoesNotBlockOthers)
+{
+    mock_readable_stream<int> rstream({1, 2, 3, 4, 5});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto streams = rstream | broadcast<int>(2, 1, lag_policy::block);
+        co_await streams[1].close();
+
+        std::vector<int> results;
+        while (auto value = co_await streams[0].recv())
+        {
+            results.push_back(*value);
+        }
+
+        EXPECT_EQ(results, std::vector<int>({1, 2, 3, 4, 5})) << "Closed consumer should not hold back the buffer";
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestBroadcastClosedConsumerReadsEndOfStream)
+{
+    mock_readable_stream<int> rstream({1, 2, 3});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto streams = rstream | broadcast<int>(2, 4);
+        co_await streams[0].close();
+        auto moved = std::move(streams[1]);
+
+        auto closed = co_await streams[0].recv();
+        auto moved_from = co_await streams[1].recv();
+        auto value = co_await moved.recv();
+
+        EXPECT_FALSE(closed.has_value()) << "A closed consumer should read the end of the stream";
+        EXPECT_FALSE(moved_from.has_value()) << "A moved-from consumer should read the end of the stream";
+        EXPECT_EQ(value, std::optional<int>(1));
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestBroadcastSourceErrorReachesEveryConsumer)
+{
+    mock_readable_stream<int> rstream({1, 2, 3, 4, 5});
+
+    auto failing = [](int value) -> int
+    {
+        if (value == 3)
+        {
+            throw std::runtime_error("source failed");
+        }
+        return value;
+    };
+
+    // the values a consumer got before the error, and whether it saw the error
+    auto drain = [](broadcast_rstream<int> &stream) -> task<std::pair<std::vector<int>, bool>>
+    {
+        std::vector<int> values;
+        try
+        {
+            while (true)
+            {
+                auto value = co_await stream.recv();
+                if (!value)
+                {
+                    break;
+                }
+                values.push_back(*value);
+            }
+        }
+        catch (const std::runtime_error &)
+        {
+            co_return std::pair{values, true};
+        }
+        co_return std::pair{values, false};
+    };
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto streams = (rstream | map<int>(std::move(failing))) | broadcast<int>(2, 4);
+
+        auto [first, first_failed] = co_await drain(streams[0]);
+        auto [second, second_failed] = co_await drain(streams[1]);
+
+        EXPECT_EQ(first, std::vector<int>({1, 2}));
+        EXPECT_TRUE(first_failed) << "The consumer that pulled the failing element should see the error";
+        EXPECT_EQ(second, std::vector<int>({1, 2})) << "Buffered values should still reach the other consumer";
+        EXPECT_TRUE(second_failed) << "Every consumer should see the error, not a clean end of stream";
+    };
+
+    sync_wait(task_fn());
+}
+
+template <typename T>
+class mock_pushed_readable_stream
+{
+private:
+    std::deque<T> values;
+    bool finished{false};
+    std::coroutine_handle<> waiter;
+
+    void wake()
+    {
+        if (auto h = std::exchange(waiter, {}))
+        {
+            h.resume();
+        }
+    }
+
+public:
+    void push(T value)
+    {
+        values.push_back(std::move(value));
+        wake();
+    }
+
+    void finish()
+    {
+        finished = true;
+        wake();
+    }
+
+    task<std::optional<T>> recv()
+    {
+        struct awaitable
+        {
+            mock_pushed_readable_stream &stream;
+
+            bool await_ready() const noexcept { return !stream.values.empty() || stream.finished; }
+            void await_suspend(std::coroutine_handle<> h) noexcept { stream.waiter = h; }
+            void await_resume() const noexcept {}
+        };
+
+        co_await awaitable{*this};
+        if (values.empty())
+        {
+            co_return std::nullopt;
+        }
+        T value = std::move(values.front());
+        values.pop_front();
+        co_return std::make_optional(std::move(value));
+    }
+};
+
+TEST_CASE(TestBroadcastForgetsDroppedWaiter)
+{
+    mock_pushed_readable_stream<int> source;
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto streams = source | broadcast<int>(2, 4);
+
+        // the first recv pulls from the source, so the second one waits on the broadcast's wait list
+        auto fetching = streams[0].recv();
+        {
+            auto dropped = streams[1].recv();
+        }
+
+        source.push(7);
+        auto first = co_await fetching;
+        auto second = co_await streams[1].recv();
+
+        EXPECT_EQ(first, std::optional<int>(7));
+        EXPECT_EQ(second, std::optional<int>(7)) << "A dropped recv should not have consumed the element";
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestMergeInterleavesReadySources)
+{
+    mock_readable_stream<int> first({1, 2, 3});
+    mock_readable_stream<int> second({10, 20, 30, 40});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto merged = merge<int>(first, second);
+
+        std::vector<int> results;
+        while (auto value = co_await merged.recv())
+        {
+            results.push_back(*value);
+        }
+
+        EXPECT_EQ(results, std::vector<int>({1, 10, 2, 20, 3, 30, 40})) << "Ready sources should be served in turn";
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestMergeOnlyResumesWhenASourceHasData)
+{
+    mock_pushed_readable_stream<int> first;
+    mock_pushed_readable_stream<int> second;
+
+    auto merged = merge<int>(first, second);
+
+    auto pending = merged.recv();
+    EXPECT_FALSE(pending.await_ready()) << "Merged stream should wait while every source is idle";
+
+    second.push(7);
+    ASSERT_TRUE(pending.await_ready());
+    EXPECT_EQ(pending.await_resume(), std::optional<int>(7));
+
+    auto last = merged.recv();
+    first.finish();
+    EXPECT_FALSE(last.await_ready()) << "Merged stream should stay open while a source is still open";
+    second.finish();
+    ASSERT_TRUE(last.await_ready());
+    EXPECT_FALSE(last.await_resume().has_value());
+}
+
+TEST_CASE(TestSelectReportsSourceIndex)
+{
+    auto task_fn = [&]() -> task<void>
+    {
+        auto selected = select<std::string>(mock_readable_stream<std::string>({"a", "b"}),
+                                            mock_readable_stream<std::string>({"x"}));
+
+        std::vector<std::pair<size_t, std::string>> results;
+        while (auto value = co_await selected.recv())
+        {
+            results.push_back(*value);
+        }
+
+        std::vector<std::pair<size_t, std::string>> expected = {{0, "a"}, {1, "x"}, {0, "b"}};
+        EXPECT_EQ(results, expected);
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestZipEndsWithShortestSource)
+{
+    mock_readable_stream<int> numbers({1, 2, 3});
+    mock_readable_stream<std::string> letters({"a", "b"});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto zipped = zip<int, std::string>(numbers, letters);
+
+        std::vector<std::tuple<int, std::string>> results;
+        while (auto value = co_await zipped.recv())
+        {
+            results.push_back(*value);
+        }
+
+        std::vector<std::tuple<int, std::string>> expected = {{1, "a"}, {2, "b"}};
+        EXPECT_EQ(results, expected);
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestRateLimiterBurstDoesNotWait)
+{
+    rate_limiter limiter(100, 5);
+
+    for (int i = 0; i < 5; i++)
+    {
+        EXPECT_TRUE(limiter.acquire(1).await_ready()) << "Requests within the burst should not wait";
+    }
+
+    EXPECT_FALSE(limiter.try_acquire(1)) << "Bucket should be empty after the burst";
+    EXPECT_FALSE(limiter.acquire(1).await_ready()) << "Requests beyond the burst should wait";
+    EXPECT_LT(limiter.available(), 0) << "A waiting request should leave the bucket in debt";
+}
+
+TEST_CASE(TestRateLimiterUnusedAcquireLeavesNoDebt)
+{
+    runtime_context context;
+    rate_limiter limiter(10, 1);
+    EXPECT_TRUE(limiter.try_acquire(1));
+
+    {
+        auto dropped = limiter.acquire(5);
+    }
+    EXPECT_GE(limiter.available(), 0) << "An acquire that is never awaited should not take any tokens";
+
+    auto task_fn = [&]() -> task<void>
+    {
+        std::stop_source stop;
+        auto waiter = [&]() -> task<void>
+        {
+            co_await limiter.acquire(5, stop.get_token());
+        };
+
+        auto waiting = waiter();
+        EXPECT_LT(limiter.available(), -4) << "A waiting acquire should hold its tokens";
+
+        stop.request_stop();
+        bool cancelled = false;
+        try
+        {
+            co_await waiting;
+        }
+        catch (const std::system_error &e)
+        {
+            cancelled = e.code() == std::errc::operation_canceled;
+        }
+        EXPECT_TRUE(cancelled) << "A cancelled acquire should not let the caller through";
+        EXPECT_GE(limiter.available(), 0) << "A cancelled acquire should give its tokens back";
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestPaceAdaptorSpacesElements)
+{
+    runtime_context context;
+    mock_readable_stream<int> rstream({1, 2, 3, 4, 5, 6});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto paced = rstream | pace<int>(50);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<int> results;
+        while (auto value = co_await paced.recv())
+        {
+            results.push_back(*value);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        EXPECT_EQ(results, std::vector<int>({1, 2, 3, 4, 5, 6}));
+        EXPECT_GE(elapsed, 100ms - test_adjustment_factor) << "Six elements at 50 per second should take at least 100ms";
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestRateLimiterSharedBetweenStreams)
+{
+    runtime_context context;
+    mock_writable_stream<int> first;
+    mock_writable_stream<int> second;
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto limiter = std::make_shared<rate_limiter>(50, 2);
+        auto limited_first = rate_limit<int>(first, limiter);
+        auto limited_second = rate_limit<int>(second, limiter);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 3; i++)
+        {
+            EXPECT_TRUE(co_await limited_first.send(i));
+            EXPECT_TRUE(co_await limited_second.send(i));
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        EXPECT_GE(elapsed, 80ms - test_adjustment_factor) << "Both streams should draw from the same bucket";
+        EXPECT_TRUE(first.received(0));
+        EXPECT_TRUE(second.received(0));
+    };
+
+    sync_wait(task_fn());
+}
@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#define TEST_SUITE_NAME AsyncIOChecksumTestSuite
+
+#include "test_suite.hpp"
+#include <webcraft/async/async.hpp>
+#include <webcraft/async/io/core.hpp>
+#include <webcraft/async/io/adaptors.hpp>
+#include <webcraft/async/io/checksum.hpp>
+#include <string>
+#include <vector>
+#include <span>
+
+using namespace webcraft::async;
+using namespace webcraft::async::io;
+using namespace webcraft::async::io::adaptors;
+
+template <typename T>
+class mock_chunk_stream
+{
+public:
+    explicit mock_chunk_stream(std::vector<T> values) : values(std::move(values)) {}
+
+    task<std::optional<T>> recv()
+    {
+        if (values.empty())
+        {
+            co_return std::nullopt;
+        }
+        T value = std::move(values.front());
+        values.erase(values.begin());
+        co_return std::make_optional(std::move(value));
+    }
+
+private:
+    std::vector<T> values;
+};
+
+template <digest_algorithm A>
+static typename A::value_type digest_of(std::string_view data, size_t step, A algorithm = A{})
+{
+    for (size_t i = 0; i < data.size(); i += step)
+    {
+        std::string_view part = data.substr(i, step);
+        algorithm.update(std::as_bytes(std::span(part.data(), part.size())));
+    }
+    return algorithm.digest();
+}
+
+static std::vector<std::vector<char>> split_into_chunks(const std::string &data, size_t chunk_size)
+{
+    std::vector<std::vector<char>> chunks;
+    for (size_t i = 0; i < data.size(); i += chunk_size)
+    {
+        chunks.emplace_back(data.begin() + i, data.begin() + std::min(data.size(), i + chunk_size));
+    }
+    return chunks;
+}
+
+static std::string make_test_payload(size_t size)
+{
+    std::string payload(size, '\0');
+    for (size_t i = 0; i < size; i++)
+    {
+        payload[i] = static_cast<char>(i * 31 + i / 7);
+    }
+    return payload;
+}
+
+TEST_CASE(TestCrc32cKnownValues)
+{
+    EXPECT_EQ(digest_of<crc32c>("", 1), 0x00000000u);
+    EXPECT_EQ(digest_of<crc32c>("123456789", 1), 0xE3069283u);
+    EXPECT_EQ(digest_of<crc32c>("123456789", 4), 0xE3069283u);
+    EXPECT_EQ(digest_of<crc32c>(std::string(32, '\0'), 32), 0x8A9136AAu);
+    EXPECT_EQ(digest_of<crc32c>(std::string(32, '\xFF'), 5), 0x62A8AB43u);
+}
+
+TEST_CASE(TestXxh64KnownValues)
+{
+    EXPECT_EQ(digest_of<xxh64>("", 1), 0xEF46DB3751D8E999ull);
+    EXPECT_EQ(digest_of<xxh64>("a", 1), 0xD24EC4F1A98C6E5Bull);
+    EXPECT_EQ(digest_of<xxh64>("abc", 1), 0x44BC2CF5AD770999ull);
+
+    const std::string spam = "Nobody inspects the spammish repetition";
+    for (size_t step : {1, 3, 8, 31, 32, 33, 64})
+    {
+        EXPECT_EQ(digest_of<xxh64>(spam, step), 0xFBCEA83C8A378BF1ull) << "Digest must not depend on how the input is split, step " << step;
+    }
+
+    EXPECT_NE(digest_of<xxh64>(spam, 1, xxh64(1)), digest_of<xxh64>(spam, 1)) << "The seed should change the digest";
+}
+
+TEST_CASE(TestChecksumAdaptorPassesDataThrough)
+{
+    auto payload = make_test_payload(100'000);
+    mock_chunk_stream<std::vector<char>> source(split_into_chunks(payload, 4093));
+    crc32c digest;
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto verified = source | checksum(digest);
+        std::string received;
+        while (auto chunk = co_await verified.recv())
+        {
+            received.append(chunk->begin(), chunk->end());
+        }
+        EXPECT_EQ(received, payload) << "Chunks should pass through unchanged";
+    };
+
+    sync_wait(task_fn());
+    EXPECT_EQ(digest.digest(), digest_of<crc32c>(payload, payload.size()));
+}
+
+TEST_CASE(TestHashAdaptorResolvesToDigest)
+{
+    auto payload = make_test_payload(100'000);
+    mock_chunk_stream<std::vector<char>> chunked(split_into_chunks(payload, 1000));
+    mock_chunk_stream<char> bytes(std::vector<char>(payload.begin(), payload.begin() + 100));
+
+    auto task_fn = [&]() -> task<void>
+    {
+        uint64_t chunked_hash = co_await (chunked | hash<xxh64>());
+        EXPECT_EQ(chunked_hash, digest_of<xxh64>(payload, payload.size()));
+
+        uint32_t byte_crc = co_await (bytes | hash<crc32c, char>());
+        EXPECT_EQ(byte_crc, digest_of<crc32c>(std::string_view(payload).substr(0, 100), 100));
+    };
+
+    sync_wait(task_fn());
+}
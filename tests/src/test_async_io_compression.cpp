@@ -0,0 +1,293 @@
+///////////////////////////////////////////////////////////////////////////////
+// Copyright (c) Aditya Rao
+// Licenced under MIT license. See LICENSE.txt for details.
+///////////////////////////////////////////////////////////////////////////////
+
+
+#define TEST_SUITE_NAME AsyncIOCompressionTestSuite
+
+#include "test_suite.hpp"
+#include <webcraft/async/async.hpp>
+#include <webcraft/async/io/core.hpp>
+#include <webcraft/async/io/adaptors.hpp>
+#include <webcraft/async/io/compression.hpp>
+#include <string>
+#include <vector>
+#include <span>
+
+using namespace webcraft::async;
+using namespace webcraft::async::io;
+using namespace webcraft::async::io::adaptors;
+using namespace webcraft::async::io::compression;
+
+template <typename T>
+class mock_chunk_stream
+{
+public:
+    explicit mock_chunk_stream(std::vector<T> values) : values(std::move(values)) {}
+
+    task<std::optional<T>> recv()
+    {
+        if (values.empty())
+        {
+            co_return std::nullopt;
+        }
+        T value = std::move(values.front());
+        values.erase(values.begin());
+        co_return std::make_optional(std::move(value));
+    }
+
+private:
+    std::vector<T> values;
+};
+
+class mock_byte_stream
+{
+private:
+    std::vector<char> data;
+    size_t position{0};
+    size_t max_write;
+
+public:
+    explicit mock_byte_stream(std::vector<char> data = {}, size_t max_write = SIZE_MAX) : data(std::move(data)), max_write(max_write) {}
+
+    task<std::optional<char>> recv()
+    {
+        if (position == data.size())
+        {
+            co_return std::nullopt;
+        }
+        co_return data[position++];
+    }
+
+    task<size_t> recv(std::span<char> buffer)
+    {
+        size_t count = std::min(buffer.size(), data.size() - position);
+        std::copy_n(data.begin() + position, count, buffer.begin());
+        position += count;
+        co_return count;
+    }
+
+    task<bool> send(char value)
+    {
+        data.push_back(value);
+        co_return true;
+    }
+
+    task<size_t> send(std::span<char> buffer)
+    {
+        size_t count = std::min(buffer.size(), max_write);
+        data.insert(data.end(), buffer.begin(), buffer.begin() + count);
+        co_return count;
+    }
+
+    const std::vector<char> &contents() const { return data; }
+};
+
+static_assert(async_buffered_readable_stream<mock_byte_stream, char>);
+static_assert(async_buffered_writable_stream<mock_byte_stream, char>);
+
+static std::vector<char> make_test_payload(size_t size)
+{
+    std::string words = "the quick brown fox jumps over the lazy dog ";
+    std::vector<char> payload(size);
+    for (size_t i = 0; i < size; i++)
+    {
+        payload[i] = words[(i * 7 + i / 13) % words.size()];
+    }
+    return payload;
+}
+
+static std::vector<std::vector<char>> split_into_chunks(const std::vector<char> &data, size_t chunk_size)
+{
+    std::vector<std::vector<char>> chunks;
+    for (size_t i = 0; i < data.size(); i += chunk_size)
+    {
+        chunks.emplace_back(data.begin() + i, data.begin() + std::min(data.size(), i + chunk_size));
+    }
+    return chunks;
+}
+
+static void expect_round_trip(codec c)
+{
+    auto payload = make_test_payload(200'000);
+    mock_chunk_stream<std::vector<char>> source(split_into_chunks(payload, 4096));
+
+    auto task_fn = [&]() -> task<void>
+    {
+        std::vector<char> compressed;
+        auto compressed_stream = source | compress(c);
+        while (auto chunk = co_await compressed_stream.recv())
+        {
+            compressed.insert(compressed.end(), chunk->begin(), chunk->end());
+        }
+
+        EXPECT_LT(compressed.size(), payload.size()) << "Repetitive text should compress";
+
+        mock_chunk_stream<std::vector<char>> compressed_source(split_into_chunks(compressed, 1000));
+        auto restored_stream = compressed_source | decompress(c);
+
+        std::vector<char> restored;
+        while (auto chunk = co_await restored_stream.recv())
+        {
+            restored.insert(restored.end(), chunk->begin(), chunk->end());
+        }
+
+        EXPECT_EQ(restored, payload);
+    };
+
+    sync_wait(task_fn());
+}
+
+static void expect_flushed_chunks_decodable(codec c)
+{
+    auto payload = make_test_payload(10'000);
+    mock_chunk_stream<std::vector<char>> source(split_into_chunks(payload, 2500));
+
+    auto task_fn = [&]() -> task<void>
+    {
+        compression_options options;
+        options.flush_every_chunk = true;
+        auto compressed_stream = source | compress(c, options);
+
+        auto decompressor = make_decompressor(c);
+        std::vector<char> restored;
+        for (size_t i = 0; i < 4; i++)
+        {
+            auto chunk = co_await compressed_stream.recv();
+            EXPECT_TRUE(chunk.has_value());
+            if (!chunk.has_value())
+            {
+                co_return;
+            }
+            decompressor->process(*chunk, restored, flush_mode::none);
+            EXPECT_EQ(restored.size(), (i + 1) * 2500) << "Each flushed chunk should decode on its own";
+        }
+    };
+
+    sync_wait(task_fn());
+}
+
+static void expect_truncation_rejected(codec c)
+{
+    auto payload = make_test_payload(50'000);
+    auto compressor = make_compressor(c);
+    std::vector<char> compressed;
+    compressor->process(payload, compressed, flush_mode::finish);
+
+    auto decompressor = make_decompressor(c);
+    std::vector<char> restored;
+    EXPECT_THROW(decompressor->process(std::span<const char>(compressed).first(compressed.size() / 2), restored, flush_mode::finish),
+                 compression_error);
+}
+
+#define CODEC_TEST_CASE(name, c)                                    \
+    TEST_CASE(name)                                                 \
+    {                                                               \
+        if (!is_supported(c))                                       \
+        {                                                           \
+            GTEST_SKIP() << "codec not compiled into this build";   \
+        }                                                           \
+        expect_round_trip(c);                                       \
+        expect_flushed_chunks_decodable(c);                         \
+        expect_truncation_rejected(c);                              \
+    }
+
+CODEC_TEST_CASE(TestDeflateCodec, codec::deflate)
+CODEC_TEST_CASE(TestGzipCodec, codec::gzip)
+CODEC_TEST_CASE(TestZstdCodec, codec::zstd)
+CODEC_TEST_CASE(TestLz4Codec, codec::lz4)
+
+TEST_CASE(TestContextPoolReusesContexts)
+{
+    if (!is_supported(codec::deflate))
+    {
+        GTEST_SKIP() << "codec not compiled into this build";
+    }
+
+    context_pool pool;
+    codec_context *first;
+    {
+        auto context = pool.acquire_compressor(codec::deflate, 6);
+        first = &*context;
+    }
+
+    auto reused = pool.acquire_compressor(codec::deflate, 6);
+    EXPECT_EQ(&*reused, first) << "A released context should be handed out again";
+
+    auto other_level = pool.acquire_compressor(codec::deflate, 1);
+    EXPECT_NE(&*other_level, first) << "Contexts are only shared between identical settings";
+}
+
+TEST_CASE(TestCompressionOffloadsLargeChunks)
+{
+    if (!is_supported(codec::zstd))
+    {
+        GTEST_SKIP() << "codec not compiled into this build";
+    }
+
+    runtime_context context;
+    thread_pool pool(1, 2);
+
+    auto payload = make_test_payload(1'000'000);
+    mock_chunk_stream<std::vector<char>> source({payload});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        compression_options options;
+        options.offload_pool = &pool;
+        options.offload_threshold = 64 * 1024;
+
+        std::vector<char> compressed;
+        auto compressed_stream = source | compress(codec::zstd, options);
+        while (auto chunk = co_await compressed_stream.recv())
+        {
+            compressed.insert(compressed.end(), chunk->begin(), chunk->end());
+        }
+
+        auto decompressor = make_decompressor(codec::zstd);
+        std::vector<char> restored;
+        decompressor->process(compressed, restored, flush_mode::finish);
+        EXPECT_EQ(restored, payload);
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestChunksAndForwardChunksToPipeline)
+{
+    auto payload = make_test_payload(10'000);
+    mock_byte_stream source(payload);
+    mock_byte_stream destination({}, 1000);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto chunked = source | chunks(4096);
+        size_t written = co_await (chunked | forward_chunks_to<char>(destination));
+
+        EXPECT_EQ(written, payload.size());
+        EXPECT_EQ(destination.contents(), payload) << "Partial writes should be resumed";
+    };
+
+    sync_wait(task_fn());
+}
+
+TEST_CASE(TestChunksOwnsTemporaryStream)
+{
+    auto payload = make_test_payload(10'000);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        // the source is gone once this statement ends, so the chunks stream has to hold on to it
+        auto chunked = mock_byte_stream(payload) | chunks(4096);
+
+        std::vector<char> received;
+        while (auto chunk = co_await chunked.recv())
+        {
+            received.insert(received.end(), chunk->begin(), chunk->end());
+        }
+        EXPECT_EQ(received, payload);
+    };
+
+    sync_wait(task_fn());
+}
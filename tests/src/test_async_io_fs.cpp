@@ -10,7 +10,10 @@
 #include <webcraft/async/async.hpp>
 #include <webcraft/async/io/io.hpp>
 #include <webcraft/async/runtime.hpp>
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <set>
 #include <sstream>
 
 using namespace webcraft::async;
@@ -202,4 +205,908 @@ TEST_CASE(TestFileWriteAll)
     EXPECT_EQ(content, test_data) << "File contents should be the same";
 
     cleanup_test_file();
-}
\ No newline at end of file
+}
+TEST_CASE(TestFileWritableStreamWritesSequentially)
+{
+    runtime_context context;
+
+    auto f = make_file(test_file_path);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto stream = co_await f.open_writable_stream();
+        std::string first = "Hello, ";
+        std::string second = "World!";
+        co_await stream.send(first);
+        co_await stream.send(second);
+        co_await stream.close();
+    };
+
+    sync_wait(task_fn());
+
+    EXPECT_EQ(get_test_file_contents(), "Hello, World!") << "Each write should continue where the previous one ended";
+
+    cleanup_test_file();
+}
+
+TEST_CASE(TestRandomAccessFileReadAndWriteAt)
+{
+    runtime_context context;
+
+    create_and_populate_test_file();
+
+    auto f = make_file(test_file_path);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto file = co_await f.open_random_access(true);
+
+        std::string patch = "JELLO";
+        size_t written = co_await file.write_at(0, patch);
+        EXPECT_EQ(written, patch.size());
+
+        std::array<char, 5> head;
+        std::array<char, 5> world;
+        std::array<char, 64> tail;
+        std::vector<read_range> ranges = {
+            {7, world},
+            {0, head},
+            {test_data.size() - 10, tail},
+        };
+
+        // all three reads are in flight at once, each with its own offset
+        auto sizes = co_await file.read_at_many(ranges);
+        EXPECT_EQ(sizes, (std::vector<size_t>{5, 5, 10})) << "Only the range past the end of the file should come back short";
+        EXPECT_EQ(std::string(head.data(), 5), "JELLO");
+        EXPECT_EQ(std::string(world.data(), 5), "World");
+        EXPECT_EQ(std::string(tail.data(), 10), test_data.substr(test_data.size() - 10));
+
+        co_await file.close();
+    };
+
+    sync_wait(task_fn());
+
+    EXPECT_EQ(get_test_file_contents(), "JELLO" + test_data.substr(5)) << "write_at should overwrite in place without truncating";
+
+    cleanup_test_file();
+}
+
+TEST_CASE(TestAlignedBufferPoolReusesBuffers)
+{
+    aligned_buffer_pool pool({4096, 4096}, 10000);
+    EXPECT_EQ(pool.buffer_size(), 12288u) << "Buffer sizes should be rounded up to whole blocks";
+
+    char *first;
+    {
+        auto buffer = pool.acquire();
+        first = buffer.data();
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % 4096, 0u) << "Buffers should be aligned for direct I/O";
+    }
+
+    auto again = pool.acquire();
+    EXPECT_EQ(again.data(), first) << "A released buffer should be handed out again";
+}
+
+TEST_CASE(TestDirectStreamsHandleUnalignedHeadAndTail)
+{
+    runtime_context context;
+
+    std::string payload(3 * 4096 + 123, '\0');
+    for (size_t i = 0; i < payload.size(); i++)
+    {
+        payload[i] = static_cast<char>(i * 31 + i / 7);
+    }
+
+    auto f = make_file(test_file_path);
+    // 4096 satisfies the direct I/O alignment of every common file system and forces partial blocks at both ends
+    aligned_buffer_pool pool({4096, 4096}, 8192);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto writer = co_await open_direct_writable_stream(f, pool);
+        for (size_t i = 0; i < payload.size(); i += 1000)
+        {
+            std::string part = payload.substr(i, 1000);
+            co_await writer.send(part);
+        }
+        co_await writer.close();
+        EXPECT_EQ(get_test_file_contents(), payload) << "The padded tail block should be truncated to the real length";
+
+        auto appender = co_await open_direct_writable_stream(f, pool, true);
+        std::string tail = "tail!";
+        co_await appender.send(tail);
+        co_await appender.close();
+        EXPECT_EQ(get_test_file_contents(), payload + tail) << "Appending should keep the partial last block";
+
+        auto reader = co_await open_direct_readable_stream(f, pool, 5000);
+        std::string received;
+        std::array<char, 777> buffer;
+        while (true)
+        {
+            size_t count = co_await reader.recv(buffer);
+            if (count == 0)
+            {
+                break;
+            }
+            received.append(buffer.data(), count);
+        }
+        co_await reader.close();
+        EXPECT_EQ(received, (payload + tail).substr(5000)) << "Reading should start at the unaligned offset";
+    };
+
+    sync_wait(task_fn());
+
+    cleanup_test_file();
+}
+
+TEST_CASE(TestMappedStreamYieldsWindows)
+{
+    create_and_populate_test_file();
+
+    auto f = make_file(test_file_path);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto stream = co_await f.open_mapped({.window_size = 16});
+
+        std::string received;
+        while (true)
+        {
+            auto window = co_await stream.recv();
+            if (!window)
+            {
+                break;
+            }
+            EXPECT_LE(window->size(), 16u) << "Windows should not exceed the requested size";
+            received.append(window->data(), window->size());
+        }
+        EXPECT_EQ(received, test_data) << "The windows should cover the whole file in order";
+
+        stream.seek(7);
+        auto window = co_await stream.recv();
+        EXPECT_EQ(std::string(window->data(), window->size()), test_data.substr(7, 16)) << "Reading should continue from the new position";
+        EXPECT_EQ(stream.contents().size(), test_data.size());
+
+        co_await stream.close();
+
+        // nothing is left to prefetch from once the mapping is gone
+        stream.seek(0);
+        auto after_close = co_await stream.recv();
+        EXPECT_FALSE(after_close.has_value()) << "A closed stream should have nothing left to read";
+    };
+
+    sync_wait(task_fn());
+
+    cleanup_test_file();
+}
+
+TEST_CASE(TestReadAheadStreamReturnsChunksInOrder)
+{
+    runtime_context context;
+
+    std::string payload;
+    for (int i = 0; i < 2000; i++)
+    {
+        payload += test_data;
+    }
+    {
+        std::ofstream ofs(test_file_path, std::ios::binary);
+        ofs << payload;
+    }
+
+    auto f = make_file(test_file_path);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto stream = co_await open_read_ahead_stream(f, {.chunk_size = 4096, .depth = 2, .max_depth = 16});
+
+        std::string received;
+        while (true)
+        {
+            auto chunk = co_await stream.recv();
+            if (!chunk)
+            {
+                break;
+            }
+            EXPECT_LE(chunk->size(), 4096u);
+            received.append(chunk->begin(), chunk->end());
+        }
+        EXPECT_EQ(received, payload) << "Chunks should come back in file order even with several reads in flight";
+        EXPECT_GE(stream.depth(), 2u);
+        EXPECT_LE(stream.depth(), 16u) << "The depth should stay within its bounds";
+
+        co_await stream.close();
+    };
+
+    sync_wait(task_fn());
+
+    cleanup_test_file();
+}
+
+TEST_CASE(TestFileWritableStreamSyncAndAllocate)
+{
+    runtime_context context;
+
+    auto f = make_file(test_file_path);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto stream = co_await f.open_writable_stream();
+
+        std::string first = "Hello, ";
+        size_t written = co_await stream.send_and_sync(first);
+        EXPECT_EQ(written, first.size()) << "The linked write should report its own result";
+
+        std::string second = "World!";
+        written = co_await stream.send_and_sync(second, true);
+        EXPECT_EQ(written, second.size());
+
+        co_await stream.sync();
+        co_await stream.data_sync();
+        co_await stream.sync_range(0, 0);
+
+        co_await stream.allocate(0, 64 * 1024);
+        co_await stream.close();
+    };
+
+    sync_wait(task_fn());
+
+    auto content = get_test_file_contents();
+    EXPECT_EQ(content.size(), 64u * 1024) << "allocate should extend the file to the end of the range";
+    EXPECT_EQ(content.substr(0, 13), "Hello, World!") << "allocate should not touch existing data";
+
+    cleanup_test_file();
+}
+
+TEST_CASE(TestAppendLogGroupCommitAndReplay)
+{
+    runtime_context context;
+
+    const std::filesystem::path log_directory = "test_append_log";
+    std::filesystem::remove_all(log_directory);
+
+    constexpr int appenders = 32;
+    constexpr int records_per_appender = 16;
+
+    auto record_for = [](int appender, int index)
+    {
+        return std::to_string(appender) + ":" + std::to_string(index) + ":" + std::string(appender * 97 % 700, 'x');
+    };
+
+    auto task_fn = [&]() -> task<void>
+    {
+        // small segments so the appenders run through several of them
+        auto log = co_await append_log::open(log_directory, {.segment_size = 64 * 1024});
+
+        auto appender = [&](int id) -> task<void>
+        {
+            log_position last{0, 0};
+            for (int i = 0; i < records_per_appender; i++)
+            {
+                std::string record = record_for(id, i);
+                log_position position = co_await log.append(record);
+                EXPECT_LT(last, position) << "Records of one appender should land in the order they were appended";
+                last = position;
+            }
+        };
+
+        std::vector<task<void>> tasks;
+        for (int id = 0; id < appenders; id++)
+        {
+            tasks.emplace_back(appender(id));
+        }
+        co_await when_all(tasks);
+        co_await log.close();
+
+        bool rejected = false;
+        try
+        {
+            co_await log.append(std::string_view("late"));
+        }
+        catch (const std::logic_error &)
+        {
+            rejected = true;
+        }
+        EXPECT_TRUE(rejected) << "A closed log should refuse new records";
+    };
+
+    sync_wait(task_fn());
+    EXPECT_GT(std::distance(std::filesystem::directory_iterator(log_directory), {}), 1) << "The log should have rotated";
+
+    auto replay_fn = [&]() -> task<std::vector<std::string>>
+    {
+        auto records = append_log::replay(log_directory);
+        std::vector<std::string> replayed;
+        for_each_async(record, records,
+                       {
+                           replayed.emplace_back(record.begin(), record.end());
+                       });
+        co_return replayed;
+    };
+
+    auto replayed = sync_wait(replay_fn());
+    ASSERT_EQ(replayed.size(), static_cast<size_t>(appenders * records_per_appender));
+
+    std::vector<int> next(appenders, 0);
+    for (const auto &record : replayed)
+    {
+        int id = std::stoi(record.substr(0, record.find(':')));
+        EXPECT_EQ(record, record_for(id, next[id]++)) << "Replay should return every record intact and in append order";
+    }
+
+    std::filesystem::remove_all(log_directory);
+}
+
+TEST_CASE(TestAppendLogReplayPastTornTail)
+{
+    runtime_context context;
+
+    const std::filesystem::path log_directory = "test_append_log_torn";
+    std::filesystem::remove_all(log_directory);
+
+    auto append_all = [&](std::vector<std::string> records) -> task<void>
+    {
+        auto log = co_await append_log::open(log_directory, {.segment_size = 64 * 1024});
+        for (const auto &record : records)
+        {
+            co_await log.append(record);
+        }
+        co_await log.close();
+    };
+
+    sync_wait(append_all({"first", "second", "torn by the crash"}));
+
+    // flip a byte of the last record, as if the process died while it was being written
+    auto segments = std::vector<std::filesystem::path>(std::filesystem::directory_iterator(log_directory), {});
+    ASSERT_EQ(segments.size(), 1u);
+    {
+        std::fstream segment(segments.front(), std::ios::in | std::ios::out | std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(segment)), std::istreambuf_iterator<char>());
+        size_t at = contents.find("torn by the crash");
+        ASSERT_NE(at, std::string::npos);
+        segment.seekp(static_cast<std::streamoff>(at));
+        segment.put('T');
+    }
+
+    sync_wait(append_all({"after the restart"}));
+
+    auto replay_fn = [&]() -> task<std::vector<std::string>>
+    {
+        auto records = append_log::replay(log_directory);
+        std::vector<std::string> replayed;
+        for_each_async(record, records,
+                       {
+                           replayed.emplace_back(record.begin(), record.end());
+                       });
+        co_return replayed;
+    };
+
+    auto replayed = sync_wait(replay_fn());
+    EXPECT_EQ(replayed, (std::vector<std::string>{"first", "second", "after the restart"}))
+        << "Replay should skip the torn record and still return what was appended after the restart";
+
+    std::filesystem::remove_all(log_directory);
+}
+
+TEST_CASE(TestFilesystemMetadataOperations)
+{
+    runtime_context context;
+
+    const std::filesystem::path directory = "test_fs_metadata";
+    std::filesystem::remove_all(directory);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        co_await webcraft::async::io::fs::mkdir(directory);
+        {
+            std::ofstream(directory / "a") << "Hello, World!";
+        }
+
+        file_status status = co_await webcraft::async::io::fs::stat(directory / "a");
+        EXPECT_EQ(status.type, std::filesystem::file_type::regular);
+        EXPECT_EQ(status.size, 13u);
+        EXPECT_EQ(status.hard_links, 1u);
+
+        status = co_await webcraft::async::io::fs::stat(directory);
+        EXPECT_EQ(status.type, std::filesystem::file_type::directory);
+
+        co_await webcraft::async::io::fs::link(directory / "a", directory / "b");
+        status = co_await webcraft::async::io::fs::stat(directory / "a");
+        EXPECT_EQ(status.hard_links, 2u) << "link should add a second name for the same file";
+
+        co_await webcraft::async::io::fs::rename(directory / "b", directory / "c");
+        EXPECT_FALSE(std::filesystem::exists(directory / "b"));
+        EXPECT_TRUE(std::filesystem::exists(directory / "c"));
+
+        std::vector<std::filesystem::path> paths = {directory / "a", directory / "missing", directory / "c"};
+        auto statuses = co_await stat_many(paths);
+        EXPECT_EQ(statuses.size(), 3u);
+        EXPECT_TRUE(statuses[0].has_value());
+        EXPECT_FALSE(statuses[1].has_value()) << "A missing path should come back empty instead of failing the batch";
+        EXPECT_TRUE(statuses[2].has_value());
+
+        auto errors = co_await unlink_many(paths);
+        EXPECT_EQ(errors.size(), 3u);
+        EXPECT_FALSE(errors[0]);
+        EXPECT_EQ(errors[1], std::errc::no_such_file_or_directory);
+        EXPECT_FALSE(errors[2]);
+
+        co_await webcraft::async::io::fs::rmdir(directory);
+
+        bool missing = false;
+        try
+        {
+            co_await webcraft::async::io::fs::stat(directory);
+        }
+        catch (const std::filesystem::filesystem_error &e)
+        {
+            missing = e.code() == std::errc::no_such_file_or_directory && e.path1() == directory;
+        }
+        EXPECT_TRUE(missing) << "stat of a removed directory should report the path and ENOENT";
+    };
+
+    sync_wait(task_fn());
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE(TestWalkListsTheWholeTree)
+{
+    runtime_context context;
+
+    const std::filesystem::path root = "test_walk";
+    std::filesystem::remove_all(root);
+
+    std::set<std::filesystem::path> expected;
+    for (int i = 0; i < 8; i++)
+    {
+        auto directory = root / ("dir" + std::to_string(i));
+        std::filesystem::create_directories(directory / "nested");
+        expected.insert(directory);
+        expected.insert(directory / "nested");
+        for (int j = 0; j < 40; j++)
+        {
+            auto file = (j % 2 ? directory : directory / "nested") / ("file" + std::to_string(j));
+            std::ofstream(file) << std::string(j, 'x');
+            expected.insert(file);
+        }
+    }
+
+    auto task_fn = [&]() -> task<void>
+    {
+        // small batches so directories are read in several pieces, interleaved with each other
+        auto entries = walk(root, {.stat = true, .max_parallel = 3, .batch_size = 16});
+        std::set<std::filesystem::path> seen;
+        for_each_async(entry, entries,
+                       {
+                           EXPECT_TRUE(entry.path.parent_path() == root || seen.contains(entry.path.parent_path()))
+                               << "A directory should come before its contents: " << entry.path;
+                           EXPECT_EQ(entry.depth, entry.path.parent_path() == root ? 0u : entry.path.parent_path().parent_path() == root ? 1u : 2u);
+                           EXPECT_TRUE(entry.status.has_value());
+                           if (entry.type == std::filesystem::file_type::regular && entry.status)
+                           {
+                               EXPECT_EQ(entry.status->size, std::filesystem::file_size(entry.path));
+                           }
+                           seen.insert(entry.path);
+                       });
+        EXPECT_EQ(seen, expected) << "walk should find every entry exactly once";
+
+        {
+            auto top = walk(root, {.recursive = false});
+            size_t count = 0;
+            for_each_async(entry, top,
+                           {
+                               EXPECT_EQ(entry.type, std::filesystem::file_type::directory);
+                               count++;
+                           });
+            EXPECT_EQ(count, 8u) << "A flat walk should stop at the root's own entries";
+        }
+
+        bool missing = false;
+        try
+        {
+            auto nothing = walk(root / "missing");
+            co_await nothing.begin();
+        }
+        catch (const std::filesystem::filesystem_error &e)
+        {
+            missing = e.code() == std::errc::no_such_file_or_directory;
+        }
+        EXPECT_TRUE(missing) << "A missing root should fail the walk";
+    };
+
+    sync_wait(task_fn());
+    std::filesystem::remove_all(root);
+}
+
+TEST_CASE(TestBlockCacheServesRepeatedReadsFromMemory)
+{
+    runtime_context context;
+
+    const std::filesystem::path path = "test_block_cache.bin";
+    std::string contents;
+    for (int i = 0; contents.size() < 300 * 1024; i++)
+    {
+        contents += std::to_string(i) + ",";
+    }
+    std::ofstream(path, std::ios::binary) << contents;
+
+    constexpr size_t block = 4096;
+    block_cache cache({.block_size = block, .capacity = 64 * 1024, .shards = 4});
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto f = co_await cache.open(make_file(path));
+        auto read = [&](uint64_t offset, size_t size) -> task<std::string>
+        {
+            std::string buffer(size, '\0');
+            size_t received = co_await f.read_at(offset, buffer);
+            buffer.resize(received);
+            co_return buffer;
+        };
+
+        std::string first = co_await read(100, 3 * block);
+        EXPECT_EQ(first, contents.substr(100, 3 * block));
+        EXPECT_EQ(cache.stats().misses, 4u) << "An unaligned range should read every block it touches";
+
+        std::string again = co_await read(block, block);
+        EXPECT_EQ(again, contents.substr(block, block));
+        EXPECT_EQ(cache.stats().hits, 1u) << "A block read before should come from memory";
+        EXPECT_EQ(cache.stats().misses, 4u);
+
+        std::string tail = co_await read(contents.size() - 10, block);
+        EXPECT_EQ(tail, contents.substr(contents.size() - 10)) << "A read past the end should stop at the end";
+
+        // two reads of the same cold block at once should share one read
+        auto before = cache.stats();
+        std::string a(block, '\0'), b(block, '\0');
+        std::vector<task<size_t>> reads;
+        reads.push_back(f.read_at(40 * block, a));
+        reads.push_back(f.read_at(40 * block, b));
+        co_await when_all(reads);
+        auto after = cache.stats();
+        EXPECT_EQ(after.misses - before.misses, 1u);
+        EXPECT_EQ(after.hits + after.coalesced - before.hits - before.coalesced, 1u);
+        EXPECT_EQ(a, contents.substr(40 * block, block));
+        EXPECT_EQ(a, b);
+
+        for (uint64_t offset = 0; offset < contents.size(); offset += block)
+        {
+            std::string chunk = co_await read(offset, block);
+            EXPECT_EQ(chunk, contents.substr(offset, block));
+        }
+        EXPECT_GT(cache.stats().evictions, 0u) << "Reading more than the budget should evict";
+        EXPECT_LE(cache.stats().bytes, 64u * 1024) << "The cache should stay within its budget";
+
+        co_await f.close();
+
+        auto stream = co_await cache.open_readable_stream(make_file(path), contents.size() - 5);
+        std::string rest;
+        while (true)
+        {
+            auto c = co_await stream.recv();
+            if (!c)
+            {
+                break;
+            }
+            rest += *c;
+        }
+        EXPECT_EQ(rest, contents.substr(contents.size() - 5));
+        co_await stream.close();
+    };
+
+    sync_wait(task_fn());
+    std::filesystem::remove(path);
+}
+
+TEST_CASE(TestOpenFileCacheReusesDescriptorsUntilFilesChange)
+{
+    runtime_context context;
+
+    const std::filesystem::path root = "test_open_file_cache";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    for (int i = 0; i < 4; i++)
+    {
+        std::ofstream(root / ("page" + std::to_string(i))) << "page " << i;
+    }
+
+    auto read_whole = [](open_file_handle &handle) -> task<std::string>
+    {
+        std::string contents(handle.status().size, '\0');
+        size_t received = co_await handle.read_at(0, contents);
+        contents.resize(received);
+        co_return contents;
+    };
+
+    auto task_fn = [&]() -> task<void>
+    {
+        open_file_cache cache({.max_entries = 3});
+
+        auto first = co_await cache.acquire(root / "page0");
+        auto again = co_await cache.acquire(root / "page0");
+        EXPECT_EQ(first.get_descriptor(), again.get_descriptor()) << "A cached file should not be opened again";
+        EXPECT_EQ(cache.stats().hits, 1u);
+        EXPECT_EQ(cache.stats().misses, 1u);
+        EXPECT_EQ(first.status().type, std::filesystem::file_type::regular);
+        std::string contents = co_await read_whole(first);
+        EXPECT_EQ(contents, "page 0");
+
+        for (int i = 1; i < 4; i++)
+        {
+            co_await cache.acquire(root / ("page" + std::to_string(i)));
+        }
+        EXPECT_EQ(cache.stats().entries, 3u);
+        EXPECT_EQ(cache.stats().evictions, 1u) << "The least recently used file should be closed";
+        contents = co_await read_whole(first);
+        EXPECT_EQ(contents, "page 0") << "A handle should outlive its eviction";
+
+        std::ofstream(root / "page3", std::ios::app) << " changed";
+#ifdef __linux__
+        // the watcher drops the entry once the change is seen
+        for (int attempt = 0; attempt < 100 && cache.stats().invalidations == 0; attempt++)
+        {
+            co_await sleep_for(std::chrono::milliseconds(10));
+        }
+#else
+        cache.invalidate(root / "page3");
+#endif
+        auto changed = co_await cache.acquire(root / "page3");
+        contents = co_await read_whole(changed);
+        EXPECT_EQ(contents, "page 3 changed");
+
+        bool missing = false;
+        try
+        {
+            co_await cache.acquire(root / "missing");
+        }
+        catch (const std::system_error &)
+        {
+            missing = true;
+        }
+        EXPECT_TRUE(missing);
+
+        cache.clear();
+        EXPECT_EQ(cache.stats().entries, 0u);
+    };
+
+    sync_wait(task_fn());
+    std::filesystem::remove_all(root);
+}
+
+TEST_CASE(TestReadAllLoadsWholeFiles)
+{
+    runtime_context context;
+
+    const std::filesystem::path root = "test_read_all";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    std::string small = "name = webcraft\nthreads = 4\n";
+    std::string large(256 * 1024, '\0');
+    for (size_t i = 0; i < large.size(); i++)
+    {
+        large[i] = static_cast<char>('a' + i % 26);
+    }
+    std::ofstream(root / "small.conf") << small;
+    std::ofstream(root / "large.bin", std::ios::binary) << large;
+    std::ofstream(root / "empty");
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto config = co_await read_all(root / "small.conf");
+        EXPECT_EQ(config.view(), small);
+        EXPECT_FALSE(config.mapped());
+
+        auto read = co_await read_all(root / "large.bin");
+        EXPECT_EQ(read.view(), large);
+        EXPECT_FALSE(read.mapped()) << "Files below the threshold should be read";
+
+        auto mapped = co_await read_all(root / "large.bin", {.mmap_threshold = 64 * 1024});
+        EXPECT_EQ(mapped.view(), large);
+        EXPECT_TRUE(mapped.mapped()) << "Files above the threshold should be mapped";
+
+        auto empty = co_await read_all(root / "empty");
+        EXPECT_EQ(empty.size(), 0u);
+
+        bool missing = false;
+        try
+        {
+            co_await read_all(root / "missing");
+        }
+        catch (const std::system_error &e)
+        {
+            missing = e.code() == std::errc::no_such_file_or_directory;
+        }
+        EXPECT_TRUE(missing);
+
+        std::vector<std::filesystem::path> paths{root / "small.conf", root / "missing", root / "large.bin"};
+        auto loaded = co_await read_all_many(paths);
+        EXPECT_EQ(loaded.size(), 3u);
+        EXPECT_TRUE(loaded[0].has_value() && loaded[0]->view() == small);
+        EXPECT_FALSE(loaded[1].has_value()) << "A file that cannot be read should not stop the others";
+        EXPECT_TRUE(loaded[2].has_value() && loaded[2]->view() == large);
+    };
+
+    sync_wait(task_fn());
+    std::filesystem::remove_all(root);
+}
+
+#ifdef __linux__
+
+#include <sys/resource.h>
+
+TEST_CASE(TestReadAllManyBeyondRingDepth)
+{
+    // every load queues two linked SQEs at each step, so this many fill the ring several times over
+    constexpr size_t file_count = 1500;
+
+    // and every one of them holds a descriptor open between its two steps
+    struct rlimit limit{};
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < file_count + 64)
+    {
+        limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, file_count + 64);
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur < file_count + 64)
+    {
+        GTEST_SKIP() << "Not allowed to open " << file_count << " files at once";
+    }
+
+    runtime_context context;
+
+    const std::filesystem::path root = "test_read_all_many";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    std::vector<std::filesystem::path> paths;
+    for (size_t i = 0; i < file_count; i++)
+    {
+        paths.push_back(root / ("file" + std::to_string(i)));
+        std::ofstream(paths.back()) << "contents of " << i;
+    }
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto loaded = co_await read_all_many(paths);
+        EXPECT_EQ(loaded.size(), file_count);
+        for (size_t i = 0; i < loaded.size(); i++)
+        {
+            EXPECT_TRUE(loaded[i].has_value() && loaded[i]->view() == "contents of " + std::to_string(i)) << "File " << i;
+        }
+    };
+
+    sync_wait(task_fn());
+    std::filesystem::remove_all(root);
+}
+
+#endif
+
+TEST_CASE(TestCopySplitsFileIntoParallelRanges)
+{
+    runtime_context context;
+
+    const std::filesystem::path root = "test_copy";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+
+    std::string contents(1024 * 1024 + 517, '\0');
+    for (size_t i = 0; i < contents.size(); i++)
+    {
+        contents[i] = static_cast<char>(i * 131 % 251);
+    }
+    std::ofstream(root / "source.bin", std::ios::binary) << contents;
+    // longer than the source, so a copy that does not cut it to size leaves a tail behind
+    std::ofstream(root / "stale.bin", std::ios::binary) << std::string(2 * contents.size(), 'x');
+
+    auto read_back = [](const std::filesystem::path &p)
+    {
+        std::ifstream in(p, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    auto task_fn = [&]() -> task<void>
+    {
+        std::vector<uint64_t> reported;
+        uint64_t total = 0;
+        copy_options options{.range_size = 64 * 1024, .parallelism = 4};
+        options.progress = [&](uint64_t done, uint64_t size)
+        {
+            reported.push_back(done);
+            total = size;
+        };
+
+        uint64_t copied = co_await io::fs::copy(root / "source.bin", root / "stale.bin", std::move(options));
+        EXPECT_EQ(copied, contents.size());
+        EXPECT_EQ(read_back(root / "stale.bin"), contents);
+
+        EXPECT_GT(reported.size(), 1u) << "Progress should be reported per range";
+        EXPECT_TRUE(std::is_sorted(reported.begin(), reported.end()));
+        EXPECT_EQ(reported.back(), contents.size());
+        EXPECT_EQ(total, contents.size());
+
+        uint64_t sequential = co_await io::fs::copy(root / "source.bin", root / "sequential.bin", {.parallelism = 1, .sync = true});
+        EXPECT_EQ(sequential, contents.size());
+        EXPECT_EQ(read_back(root / "sequential.bin"), contents);
+
+        uint64_t onto_itself = co_await io::fs::copy(root / "source.bin", root / "source.bin");
+        EXPECT_EQ(onto_itself, contents.size());
+        EXPECT_EQ(read_back(root / "source.bin"), contents) << "Copying a file onto itself should leave it intact";
+
+        bool missing = false;
+        try
+        {
+            co_await io::fs::copy(root / "missing.bin", root / "copy.bin");
+        }
+        catch (const std::system_error &)
+        {
+            missing = true;
+        }
+        EXPECT_TRUE(missing);
+    };
+
+    sync_wait(task_fn());
+    std::filesystem::remove_all(root);
+}
+
+TEST_CASE(TestIdlePriorityReadsCompleteBehindForegroundReads)
+{
+    runtime_context context;
+
+    const std::filesystem::path path = "test_io_priority.bin";
+    std::string contents(64 * 1024, '\0');
+    for (size_t i = 0; i < contents.size(); i++)
+    {
+        contents[i] = static_cast<char>(i % 253);
+    }
+    std::ofstream(path, std::ios::binary) << contents;
+
+    // a small limit, so that most of the idle reads have to wait in the runtime
+    set_background_io_limit(2);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        auto background = co_await make_file(path).open_random_access();
+        auto foreground = co_await make_file(path).open_random_access();
+        EXPECT_EQ(background.get_priority(), io_priority{});
+
+        background.set_priority(io_priority::idle());
+        EXPECT_EQ(background.get_priority(), io_priority::idle());
+
+        constexpr size_t chunk = 4096;
+        std::vector<std::vector<char>> idle_buffers(16, std::vector<char>(chunk));
+        std::vector<std::vector<char>> foreground_buffers(4, std::vector<char>(chunk));
+
+        std::vector<task<size_t>> reads;
+        for (size_t i = 0; i < idle_buffers.size(); i++)
+        {
+            reads.push_back(background.read_at(i * chunk, idle_buffers[i]));
+        }
+        for (size_t i = 0; i < foreground_buffers.size(); i++)
+        {
+            reads.push_back(foreground.read_at(i * chunk, foreground_buffers[i]));
+        }
+
+        for (auto &read : reads)
+        {
+            size_t received = co_await read;
+            EXPECT_EQ(received, chunk);
+        }
+
+        for (size_t i = 0; i < idle_buffers.size(); i++)
+        {
+            EXPECT_EQ(std::string(idle_buffers[i].begin(), idle_buffers[i].end()), contents.substr(i * chunk, chunk));
+        }
+        for (size_t i = 0; i < foreground_buffers.size(); i++)
+        {
+            EXPECT_EQ(std::string(foreground_buffers[i].begin(), foreground_buffers[i].end()), contents.substr(i * chunk, chunk));
+        }
+
+        co_await background.close();
+        co_await foreground.close();
+    };
+
+    sync_wait(task_fn());
+    set_background_io_limit(16);
+    std::filesystem::remove(path);
+}
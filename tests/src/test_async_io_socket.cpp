@@ -7,6 +7,11 @@
 
 #include "test_suite.hpp"
 #include <webcraft/async/async.hpp>
+#include <webcraft/async/io/io.hpp>
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <fstream>
 #include "mock_io.hpp"
 
 using namespace webcraft::async;
@@ -267,6 +272,754 @@ TEST_CASE(TestAsyncTcpServerWithAsyncClient)
     sync_wait(server_task);
 }
 
+TEST_CASE(TestFileTransferToSocket)
+{
+    runtime_context context;
+
+    const std::filesystem::path path = "transfer_test_file.bin";
+    std::string contents(300'000, '\0');
+    for (size_t i = 0; i < contents.size(); i++)
+    {
+        contents[i] = static_cast<char>(i * 7 + i / 251);
+    }
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        ofs << contents;
+    }
+
+    tcp_listener listener = make_tcp_listener();
+    listener.bind(info);
+    listener.listen(1);
+
+    auto server_fn = [&]() -> task<size_t>
+    {
+        tcp_socket peer = co_await listener.accept();
+        auto file = co_await webcraft::async::io::fs::make_file(path).open_readable_stream();
+        auto &writer = peer.get_writable_stream();
+
+        // a positional transfer leaves the file position alone, so forward_to sends the whole file afterwards
+        size_t ranged = co_await webcraft::async::io::transfer(file, writer, 1000, 200'000);
+        size_t whole = co_await (file | webcraft::async::io::adaptors::forward_to(writer));
+
+        // an rvalue stream is handed over to forward_to rather than borrowed
+        auto reopened = co_await webcraft::async::io::fs::make_file(path).open_readable_stream();
+        size_t handed_over = co_await (std::move(reopened) | webcraft::async::io::adaptors::forward_to(writer));
+
+        co_await file.close();
+        co_await peer.close();
+        co_return ranged + whole + handed_over;
+    };
+
+    auto client_fn = [&]() -> task<std::string>
+    {
+        tcp_socket socket = make_tcp_socket();
+        co_await socket.connect(info);
+        auto &reader = socket.get_readable_stream();
+
+        std::string received;
+        std::vector<char> buffer(64 * 1024);
+        while (true)
+        {
+            size_t bytes_received = co_await reader.recv(std::span<char>(buffer.data(), buffer.size()));
+            if (bytes_received == 0)
+            {
+                break;
+            }
+            received.append(buffer.data(), bytes_received);
+        }
+        co_await socket.close();
+        co_return received;
+    };
+
+    auto server_task = server_fn();
+    std::string received = sync_wait(client_fn());
+    size_t sent = sync_wait(server_task);
+    sync_wait(listener.close());
+
+    EXPECT_EQ(sent, 200'000 + 2 * contents.size());
+    EXPECT_EQ(received.size(), sent);
+    EXPECT_TRUE(received == contents.substr(1000, 200'000) + contents + contents) << "Bytes should arrive unchanged and in order";
+
+    std::filesystem::remove(path);
+}
+
+static task<std::string> recv_exactly(tcp_rstream &reader, size_t size)
+{
+    std::string received;
+    std::vector<char> buffer(64 * 1024);
+    while (received.size() < size)
+    {
+        size_t bytes_received = co_await reader.recv(std::span<char>(buffer.data(), std::min(buffer.size(), size - received.size())));
+        if (bytes_received == 0)
+        {
+            break;
+        }
+        received.append(buffer.data(), bytes_received);
+    }
+    co_return received;
+}
+
+static task<void> send_all(tcp_wstream &writer, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        size_t bytes_sent = co_await writer.send(std::span<const char>(data.data() + sent, data.size() - sent));
+        if (bytes_sent == 0)
+        {
+            break;
+        }
+        sent += bytes_sent;
+    }
+}
+
+TEST_CASE(TestBidirectionalSplicePropagatesHalfClose)
+{
+    runtime_context context;
+
+    tcp_listener listener = make_tcp_listener();
+    listener.bind(info);
+    listener.listen(2);
+
+    auto relay_fn = [&]() -> task<webcraft::async::io::splice_result>
+    {
+        tcp_socket a = co_await listener.accept();
+        tcp_socket b = co_await listener.accept();
+        auto result = co_await webcraft::async::io::bidirectional_splice(a, b);
+        co_await a.close();
+        co_await b.close();
+        co_return result;
+    };
+
+    const std::string request(100'000, 'q');
+    const std::string response(200'000, 'r');
+
+    auto clients_fn = [&]() -> task<void>
+    {
+        tcp_socket first = make_tcp_socket();
+        co_await first.connect(info);
+        tcp_socket second = make_tcp_socket();
+        co_await second.connect(info);
+
+        co_await send_all(first.get_writable_stream(), request);
+        first.shutdown_channel(socket_stream_mode::WRITE);
+
+        std::string forwarded = co_await recv_exactly(second.get_readable_stream(), request.size() + 1);
+        EXPECT_EQ(forwarded, request) << "The relay should forward the request and then pass on the half-close";
+
+        // the other direction keeps working after the half-close
+        co_await send_all(second.get_writable_stream(), response);
+        second.shutdown_channel(socket_stream_mode::WRITE);
+
+        std::string returned = co_await recv_exactly(first.get_readable_stream(), response.size() + 1);
+        EXPECT_EQ(returned, response);
+
+        co_await first.close();
+        co_await second.close();
+    };
+
+    auto relay_task = relay_fn();
+    sync_wait(clients_fn());
+    auto result = sync_wait(relay_task);
+    sync_wait(listener.close());
+
+    EXPECT_EQ(result.a_to_b, request.size());
+    EXPECT_EQ(result.b_to_a, response.size());
+}
+
+TEST_CASE(TestSocketAddressParsesNumericHosts)
+{
+    auto v4 = socket_address::parse("192.0.2.7", 8080);
+    ASSERT_TRUE(v4.has_value());
+    EXPECT_EQ(v4->host(), "192.0.2.7");
+    EXPECT_EQ(v4->port(), 8080);
+    EXPECT_EQ(v4->to_string(), "192.0.2.7:8080");
+
+    auto v6 = socket_address::parse("2001:db8::1", 443);
+    ASSERT_TRUE(v6.has_value());
+    EXPECT_EQ(v6->host(), "2001:db8::1");
+    EXPECT_EQ(v6->to_string(), "[2001:db8::1]:443");
+    EXPECT_NE(v6->family(), v4->family());
+
+    EXPECT_FALSE(socket_address::parse("localhost", 80).has_value()) << "parse() should never go to the name service";
+    EXPECT_EQ(socket_address::parse("192.0.2.7", 8080), v4);
+    EXPECT_TRUE(socket_address{}.empty());
+}
+
+#if defined(__linux__)
+
+#include <webcraft/net/util.hpp>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+static int get_int_option(int fd, int level, int name)
+{
+    int value = -1;
+    socklen_t length = sizeof(value);
+    ::getsockopt(fd, level, name, &value, &length);
+    return value;
+}
+
+TEST_CASE(TestSocketOptionsReachConnectedAndAcceptedSockets)
+{
+    runtime_context context;
+
+    socket_options server_options;
+    server_options.no_delay = true;
+    server_options.receive_buffer = 256 * 1024;
+    server_options.keepalive = keepalive_options{std::chrono::seconds(30), std::chrono::seconds(5), 3};
+
+    tcp_listener listener = make_tcp_listener(server_options);
+    listener.bind(info);
+    listener.listen(1);
+
+    auto run_fn = [&]() -> task<void>
+    {
+        auto accepting = listener.accept();
+
+        socket_options client_options;
+        client_options.no_delay = true;
+        client_options.send_buffer = 128 * 1024;
+        tcp_socket client = make_tcp_socket(client_options);
+        co_await client.connect(info);
+        tcp_socket server = co_await accepting;
+
+        int client_fd = client.get_readable_stream().get_descriptor()->native_handle();
+        int server_fd = server.get_readable_stream().get_descriptor()->native_handle();
+
+        EXPECT_EQ(get_int_option(client_fd, IPPROTO_TCP, TCP_NODELAY), 1);
+        EXPECT_GE(get_int_option(client_fd, SOL_SOCKET, SO_SNDBUF), 128 * 1024) << "Linux reports twice the size it was given";
+
+        EXPECT_EQ(get_int_option(server_fd, IPPROTO_TCP, TCP_NODELAY), 1) << "Accepted sockets should get the listener's options";
+        EXPECT_EQ(get_int_option(server_fd, SOL_SOCKET, SO_KEEPALIVE), 1);
+        EXPECT_EQ(get_int_option(server_fd, IPPROTO_TCP, TCP_KEEPIDLE), 30);
+        EXPECT_EQ(get_int_option(server_fd, IPPROTO_TCP, TCP_KEEPINTVL), 5);
+        EXPECT_EQ(get_int_option(server_fd, IPPROTO_TCP, TCP_KEEPCNT), 3);
+        EXPECT_GE(get_int_option(server_fd, SOL_SOCKET, SO_RCVBUF), 256 * 1024) << "The listener's buffer size should carry over";
+
+        co_await client.close();
+        co_await server.close();
+    };
+
+    sync_wait(run_fn());
+    sync_wait(listener.close());
+}
+
+TEST_CASE(TestRejectedSocketOptionFailsConnect)
+{
+    runtime_context context;
+
+    socket_options options;
+    options.keepalive = keepalive_options{std::chrono::seconds(30), std::chrono::seconds(5), 0}; // TCP_KEEPCNT must be at least 1
+
+    tcp_socket socket = make_tcp_socket(options);
+    EXPECT_THROW(sync_wait(socket.connect(info)), std::system_error);
+}
+
+TEST_CASE(TestIdleSocketReadDoesNotHoldBackgroundSlot)
+{
+    runtime_context context;
+
+    const std::filesystem::path path = "test_idle_socket_read.bin";
+    std::ofstream(path, std::ios::binary) << "Hello, World!";
+
+    // a single slot, which a socket read waiting on a quiet peer would otherwise keep for good
+    set_background_io_limit(1);
+
+    tcp_listener listener = make_tcp_listener();
+    listener.bind(info);
+    listener.listen(1);
+
+    auto run_fn = [&]() -> task<void>
+    {
+        auto accepting = listener.accept();
+        tcp_socket client = make_tcp_socket();
+        co_await client.connect(info);
+        tcp_socket server = co_await accepting;
+
+        auto &reader = client.get_readable_stream();
+        reader.set_priority(io_priority::idle());
+        std::vector<char> received(16);
+        auto pending = reader.recv(std::span<char>(received));
+
+        auto file = co_await webcraft::async::io::fs::make_file(path).open_random_access();
+        file.set_priority(io_priority::idle());
+        std::vector<char> contents(13);
+        size_t read = co_await file.read_at(0, contents);
+        EXPECT_EQ(read, 13u) << "An idle file read should not wait behind an idle socket read";
+        co_await file.close();
+
+        const std::string message = "ping";
+        co_await server.get_writable_stream().send(std::span<const char>(message.data(), message.size()));
+        size_t bytes_received = co_await pending;
+        EXPECT_EQ(std::string(received.data(), bytes_received), message);
+
+        co_await client.close();
+        co_await server.close();
+    };
+
+    sync_wait(run_fn());
+    set_background_io_limit(16);
+    sync_wait(listener.close());
+    std::filesystem::remove(path);
+}
+
+static uint16_t local_port(const tcp_listener &listener)
+{
+    struct sockaddr_storage addr{};
+    socklen_t length = sizeof(addr);
+    ::getsockname(listener.get_descriptor()->native_handle(), reinterpret_cast<sockaddr *>(&addr), &length);
+    return webcraft::net::util::addr_to_host_port(addr).second;
+}
+
+TEST_CASE(TestShardedListenerSpreadsConnectionsOverShards)
+{
+    runtime_context context;
+
+    sharded_listener listener = make_sharded_listener({"127.0.0.1", 0}, 4);
+    EXPECT_EQ(listener.size(), 4u);
+
+    uint16_t port = local_port(listener.shard(0));
+    for (size_t i = 1; i < listener.size(); i++)
+    {
+        EXPECT_EQ(local_port(listener.shard(i)), port) << "Every shard should join the port the first one picked";
+    }
+
+    auto run_fn = [&]() -> task<void>
+    {
+        std::vector<task<tcp_socket>> accepting;
+        for (size_t i = 0; i < listener.size(); i++)
+        {
+            accepting.push_back(listener.accept(i));
+        }
+        auto all_accepted = [&]()
+        {
+            return std::all_of(accepting.begin(), accepting.end(), [](const task<tcp_socket> &t)
+                               { return t.await_ready(); });
+        };
+
+        // the kernel picks the shard by hashing the client's port, so it takes a few connections to reach them all
+        std::vector<tcp_socket> clients;
+        for (size_t attempt = 0; attempt < 256 && !all_accepted(); attempt++)
+        {
+            tcp_socket client = make_tcp_socket();
+            co_await client.connect({"127.0.0.1", port});
+            clients.push_back(std::move(client));
+            co_await yield();
+        }
+        EXPECT_TRUE(all_accepted()) << "Every shard should be handed some of the connections";
+
+        for (auto &accept : accepting)
+        {
+            tcp_socket accepted = co_await accept;
+            co_await accepted.close();
+        }
+        for (auto &client : clients)
+        {
+            co_await client.close();
+        }
+    };
+
+    sync_wait(run_fn());
+    sync_wait(listener.close());
+}
+
+TEST_CASE(TestShardedListenerSteersConnectionsByCpu)
+{
+    runtime_context context;
+
+    sharded_listener_options options;
+    options.steer_to_cpu = true;
+    sharded_listener listener = make_sharded_listener({"127.0.0.1", 0}, 2, options);
+    uint16_t port = local_port(listener.shard(0));
+
+    auto run_fn = [&]() -> task<size_t>
+    {
+        std::vector<task<tcp_socket>> accepting;
+        for (size_t i = 0; i < listener.size(); i++)
+        {
+            accepting.push_back(listener.accept(i));
+        }
+
+        tcp_socket client = make_tcp_socket();
+        co_await client.connect({"127.0.0.1", port});
+        for (size_t i = 0; i < 1000 && std::none_of(accepting.begin(), accepting.end(), [](const task<tcp_socket> &t)
+                                                    { return t.await_ready(); });
+             i++)
+        {
+            co_await yield();
+        }
+
+        // shutting a listener down fails the accept still waiting on it
+        for (size_t i = 0; i < listener.size(); i++)
+        {
+            ::shutdown(listener.shard(i).get_descriptor()->native_handle(), SHUT_RDWR);
+        }
+
+        size_t accepted_count = 0;
+        for (auto &accept : accepting)
+        {
+            try
+            {
+                tcp_socket accepted = co_await accept;
+                accepted_count++;
+                co_await accepted.close();
+            }
+            catch (const std::system_error &)
+            {
+            }
+        }
+        co_await client.close();
+        co_return accepted_count;
+    };
+
+    EXPECT_EQ(sync_wait(run_fn()), 1u) << "The steering program should hand the connection to exactly one shard";
+    sync_wait(listener.close());
+}
+
+TEST_CASE(TestAcceptedSocketKeepsPeerAddress)
+{
+    runtime_context context;
+
+    tcp_listener listener = make_tcp_listener();
+    listener.bind(*socket_address::parse("127.0.0.1", 0));
+    listener.listen(1);
+    socket_address server_address = *socket_address::parse("127.0.0.1", local_port(listener));
+
+    auto run_fn = [&]() -> task<void>
+    {
+        auto accepting = listener.accept();
+        tcp_socket client = make_tcp_socket();
+        co_await client.connect(server_address);
+        tcp_socket server = co_await accepting;
+
+        struct sockaddr_storage local{};
+        socklen_t length = sizeof(local);
+        ::getsockname(client.get_readable_stream().get_descriptor()->native_handle(), reinterpret_cast<sockaddr *>(&local), &length);
+        socket_address client_address(reinterpret_cast<sockaddr *>(&local), length);
+
+        EXPECT_EQ(server.get_remote_address(), client_address) << "accept() should keep the address the kernel reported";
+        EXPECT_EQ(server.get_remote_host(), "127.0.0.1");
+        EXPECT_EQ(server.get_remote_port(), client_address.port());
+        EXPECT_EQ(client.get_remote_address(), server_address);
+
+        co_await client.close();
+        co_await server.close();
+    };
+
+    sync_wait(run_fn());
+    sync_wait(listener.close());
+}
+
+TEST_CASE(TestUdpSocketAddressRoundTrip)
+{
+    runtime_context context;
+
+    socket_address server_address = *socket_address::parse("127.0.0.1", 12347);
+    udp_socket server = make_udp_socket(version);
+    server.bind(server_address);
+    udp_socket client = make_udp_socket(version);
+
+    auto run_fn = [&]() -> task<void>
+    {
+        std::string request = "ping";
+        co_await client.sendto(std::span<const char>(request.data(), request.size()), server_address);
+
+        std::array<char, 64> buffer{};
+        socket_address from;
+        size_t received = co_await server.recvfrom(std::span<char>(buffer.data(), buffer.size()), from);
+        EXPECT_EQ(std::string(buffer.data(), received), request);
+        EXPECT_EQ(from.host(), "127.0.0.1");
+        EXPECT_NE(from.port(), 0);
+
+        std::string reply = "pong";
+        co_await server.sendto(std::span<const char>(reply.data(), reply.size()), from);
+
+        socket_address replied_from;
+        received = co_await client.recvfrom(std::span<char>(buffer.data(), buffer.size()), replied_from);
+        EXPECT_EQ(std::string(buffer.data(), received), reply);
+        EXPECT_EQ(replied_from, server_address) << "The reply should come from the address the request was sent to";
+    };
+
+    sync_wait(run_fn());
+    sync_wait(client.close());
+    sync_wait(server.close());
+}
+
+// a listener with a backlog of 0 queues one connection; once that is taken the kernel drops further SYNs, so connecting
+// to it stalls like connecting to a blackholed address
+static tcp_listener make_stalled_listener(const connection_info &address, tcp_socket &queued)
+{
+    tcp_listener listener = make_tcp_listener();
+    listener.bind(address);
+    listener.listen(0);
+    queued = make_tcp_socket();
+    sync_wait(queued.connect({address.host, local_port(listener)}));
+    return listener;
+}
+
+TEST_CASE(TestConnectTimeoutBoundsStalledConnect)
+{
+    runtime_context context;
+
+    tcp_socket queued = make_tcp_socket();
+    tcp_listener listener = make_stalled_listener({"127.0.0.1", 0}, queued);
+
+    socket_options options;
+    options.connect_timeout = std::chrono::milliseconds(200);
+    tcp_socket client = make_tcp_socket(options);
+
+    auto started = std::chrono::steady_clock::now();
+    try
+    {
+        sync_wait(client.connect({"127.0.0.1", local_port(listener)}));
+        ADD_FAILURE() << "Connecting to a listener that drops SYNs should time out";
+    }
+    catch (const std::system_error &e)
+    {
+        EXPECT_EQ(e.code(), std::make_error_code(std::errc::timed_out));
+    }
+    EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(1)) << "connect_timeout should bound the wait, not the SYN retries";
+
+    sync_wait(queued.close());
+    sync_wait(listener.close());
+}
+
+TEST_CASE(TestHappyEyeballsSkipsStalledAddress)
+{
+    runtime_context context;
+
+    struct addrinfo hints{};
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo *res;
+    if (::getaddrinfo("localhost", nullptr, &hints, &res) != 0)
+    {
+        GTEST_SKIP() << "localhost does not resolve";
+    }
+    std::vector<std::string> hosts;
+    for (auto *rp = res; rp; rp = rp->ai_next)
+    {
+        struct sockaddr_storage addr{};
+        std::memcpy(&addr, rp->ai_addr, rp->ai_addrlen);
+        auto host = webcraft::net::util::addr_to_host_port(addr).first;
+        if (rp->ai_family != res->ai_family)
+        {
+            hosts.push_back(host);
+            break;
+        }
+        if (hosts.empty())
+        {
+            hosts.push_back(host);
+        }
+    }
+    ::freeaddrinfo(res);
+    if (hosts.size() < 2)
+    {
+        GTEST_SKIP() << "localhost has addresses of a single family here";
+    }
+
+    // the address connect() tries first stalls, the other one accepts
+    tcp_socket queued = make_tcp_socket();
+    tcp_listener stalled = make_stalled_listener({hosts[0], 0}, queued);
+    uint16_t port = local_port(stalled);
+    tcp_listener listener = make_tcp_listener();
+    listener.bind({hosts[1], port});
+    listener.listen(8);
+
+    auto run_fn = [&]() -> task<void>
+    {
+        auto accepting = listener.accept();
+
+        socket_options options;
+        options.connect_attempt_delay = std::chrono::milliseconds(100);
+        options.connect_timeout = std::chrono::seconds(5);
+        tcp_socket client = make_tcp_socket(options);
+
+        auto started = std::chrono::steady_clock::now();
+        co_await client.connect({"localhost", port});
+        EXPECT_LT(std::chrono::steady_clock::now() - started, std::chrono::seconds(1)) << "The second address should be tried while the first one stalls";
+
+        tcp_socket server = co_await accepting;
+        co_await client.close();
+        co_await server.close();
+    };
+
+    sync_wait(run_fn());
+    sync_wait(queued.close());
+    sync_wait(stalled.close());
+    sync_wait(listener.close());
+}
+
+TEST_CASE(TestConnectionPoolReusesAndWaitsForConnections)
+{
+    runtime_context context;
+
+    tcp_listener listener = make_tcp_listener();
+    listener.bind({"127.0.0.1", 0});
+    listener.listen(8);
+    connection_info endpoint{"127.0.0.1", local_port(listener)};
+
+    connection_pool_options options;
+    options.max_per_endpoint = 1;
+    connection_pool pool(options);
+
+    auto run_fn = [&]() -> task<void>
+    {
+        auto accepting = listener.accept();
+        pooled_connection first = co_await pool.acquire(endpoint);
+        tcp_socket server = co_await accepting;
+        EXPECT_FALSE(first.reused());
+
+        auto second = pool.acquire(endpoint);
+        co_await yield();
+        EXPECT_FALSE(second.await_ready()) << "The endpoint is at max_per_endpoint, so acquire() should wait";
+
+        first.release();
+        EXPECT_TRUE(second.await_ready()) << "Releasing the connection should hand it to the waiting acquire()";
+        pooled_connection reused = co_await second;
+        EXPECT_TRUE(reused.reused());
+
+        auto stats = pool.stats();
+        EXPECT_EQ(stats.misses, 1u);
+        EXPECT_EQ(stats.hits, 1u);
+        EXPECT_EQ(stats.waits, 1u);
+        EXPECT_EQ(stats.open, 1u);
+        EXPECT_EQ(stats.idle, 0u);
+
+        reused.release();
+        EXPECT_EQ(pool.stats().idle, 1u);
+        pool.clear();
+        EXPECT_EQ(pool.stats().open, 0u);
+
+        co_await server.close();
+    };
+
+    sync_wait(run_fn());
+    sync_wait(listener.close());
+}
+
+TEST_CASE(TestConnectionPoolForgetsDroppedWaiter)
+{
+    runtime_context context;
+
+    tcp_listener listener = make_tcp_listener();
+    listener.bind({"127.0.0.1", 0});
+    listener.listen(8);
+    connection_info endpoint{"127.0.0.1", local_port(listener)};
+
+    connection_pool_options options;
+    options.max_per_endpoint = 1;
+    connection_pool pool(options);
+
+    auto run_fn = [&]() -> task<void>
+    {
+        auto accepting = listener.accept();
+        pooled_connection first = co_await pool.acquire(endpoint);
+        tcp_socket server = co_await accepting;
+
+        {
+            auto dropped = pool.acquire(endpoint);
+            co_await yield();
+            EXPECT_FALSE(dropped.await_ready()) << "The endpoint is at max_per_endpoint, so acquire() should wait";
+        }
+
+        // with the dropped acquire still queued, this would resume its destroyed frame
+        first.release();
+        EXPECT_EQ(pool.stats().idle, 1u) << "Nobody is waiting any more, so the connection should go back to the pool";
+
+        pooled_connection again = co_await pool.acquire(endpoint);
+        EXPECT_TRUE(again.reused());
+
+        again.release();
+        pool.clear();
+        co_await server.close();
+    };
+
+    sync_wait(run_fn());
+    sync_wait(listener.close());
+}
+
+TEST_CASE(TestConnectionPoolDropsConnectionsClosedByPeer)
+{
+    runtime_context context;
+
+    tcp_listener listener = make_tcp_listener();
+    listener.bind({"127.0.0.1", 0});
+    listener.listen(8);
+    connection_info endpoint{"127.0.0.1", local_port(listener)};
+
+    connection_pool pool;
+
+    auto run_fn = [&]() -> task<void>
+    {
+        auto accepting = listener.accept();
+        pooled_connection first = co_await pool.acquire(endpoint);
+        tcp_socket server = co_await accepting;
+        first.release();
+
+        co_await server.close();
+        co_await sleep_for(std::chrono::milliseconds(50)); // let the FIN arrive
+
+        auto accepting_again = listener.accept();
+        pooled_connection second = co_await pool.acquire(endpoint);
+        tcp_socket server_again = co_await accepting_again;
+        EXPECT_FALSE(second.reused()) << "A connection the peer closed should not be handed out";
+
+        auto stats = pool.stats();
+        EXPECT_EQ(stats.stale, 1u);
+        EXPECT_EQ(stats.misses, 2u);
+        EXPECT_EQ(stats.hits, 0u);
+        EXPECT_EQ(stats.open, 1u);
+
+        second.discard();
+        EXPECT_EQ(pool.stats().open, 0u);
+        co_await server_again.close();
+    };
+
+    sync_wait(run_fn());
+    sync_wait(listener.close());
+}
+
+TEST_CASE(TestConnectionPoolEvictsIdleConnections)
+{
+    runtime_context context;
+
+    tcp_listener listener = make_tcp_listener();
+    listener.bind({"127.0.0.1", 0});
+    listener.listen(8);
+    connection_info endpoint{"127.0.0.1", local_port(listener)};
+
+    connection_pool_options options;
+    options.idle_timeout = std::chrono::milliseconds(100);
+    connection_pool pool(options);
+
+    auto run_fn = [&]() -> task<void>
+    {
+        auto accepting = listener.accept();
+        pooled_connection connection = co_await pool.acquire(endpoint);
+        tcp_socket server = co_await accepting;
+        connection.release();
+        EXPECT_EQ(pool.stats().idle, 1u);
+
+        co_await sleep_for(std::chrono::milliseconds(300));
+
+        auto stats = pool.stats();
+        EXPECT_EQ(stats.evictions, 1u) << "The idle connection should be closed once it outlives idle_timeout";
+        EXPECT_EQ(stats.idle, 0u);
+        EXPECT_EQ(stats.open, 0u);
+
+        co_await server.close();
+    };
+
+    sync_wait(run_fn());
+    sync_wait(listener.close());
+}
+
+#endif
+
 class async_udp_echo_client
 {
 private:
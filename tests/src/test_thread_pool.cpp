@@ -8,6 +8,8 @@
 
 #include "test_suite.hpp"
 #include <webcraft/async/thread_pool.hpp>
+#include <webcraft/async/task.hpp>
+#include <webcraft/async/sync_wait.hpp>
 #include <future>
 #include <vector>
 #include <set>
@@ -149,3 +151,36 @@ TEST_CASE(RunMoreThanMaxTasks)
     EXPECT_EQ(thpr.get_workers_size(), min_workers) << "After idle timeout: Should have " << min_workers << " workers";
     EXPECT_EQ(thpr.get_available_workers(), min_workers) << "After idle timeout: Should have " << min_workers << " available workers";
 }
+
+TEST_CASE(AsyncSubmitResumesWithResult)
+{
+    thread_pool thpr(1);
+
+    auto caller = std::this_thread::get_id();
+    std::thread::id worker;
+
+    auto task_fn = [&]() -> task<int>
+    {
+        int value = co_await thpr.async_submit([&worker]
+                                               {
+            worker = std::this_thread::get_id();
+            return 42; });
+        co_return value;
+    };
+
+    EXPECT_EQ(sync_wait(task_fn()), 42);
+    EXPECT_NE(worker, caller) << "The job should run on a pool thread";
+}
+
+TEST_CASE(AsyncSubmitPropagatesExceptions)
+{
+    thread_pool thpr(1);
+
+    auto task_fn = [&]() -> task<void>
+    {
+        co_await thpr.async_submit([]
+                                   { throw std::runtime_error("job failed"); });
+    };
+
+    EXPECT_THROW(sync_wait(task_fn()), std::runtime_error);
+}